@@ -0,0 +1,170 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+Authors: agent
+-/
+prelude
+import Init.Data.Array.Basic
+import Init.Data.Option.Basic
+universe u
+
+/--
+An array of booleans. The runtime packs the bits into 64-bit words, instead of storing one boxed
+`Bool` per element as `Array Bool` does, and implements the logical operations, `popcount` and
+`findFirstSet?` a word at a time.
+-/
+structure BitArray where
+  data : Array Bool
+
+attribute [extern "lean_bit_array_mk"] BitArray.mk
+attribute [extern "lean_bit_array_data"] BitArray.data
+
+namespace BitArray
+@[extern "lean_mk_empty_bit_array"]
+def mkEmpty (c : @& Nat) : BitArray :=
+  { data := #[] }
+
+def empty : BitArray :=
+  mkEmpty 0
+
+instance : Inhabited BitArray where
+  default := empty
+
+instance : EmptyCollection BitArray where
+  emptyCollection := BitArray.empty
+
+/-- The bit array of size `n` with all bits set to `v`. -/
+@[extern "lean_mk_bit_array"]
+def replicate (n : @& Nat) (v : Bool) : BitArray :=
+  ⟨mkArray n v⟩
+
+@[extern "lean_bit_array_push"]
+def push : BitArray → Bool → BitArray
+  | ⟨bs⟩, b => ⟨bs.push b⟩
+
+@[extern "lean_bit_array_size"]
+def size : (@& BitArray) → Nat
+  | ⟨bs⟩ => bs.size
+
+@[extern "lean_sarray_size", simp]
+def usize (a : @& BitArray) : USize :=
+  a.size.toUSize
+
+@[extern "lean_bit_array_uget"]
+def uget : (a : @& BitArray) → (i : USize) → i.toNat < a.size → Bool
+  | ⟨bs⟩, i, h => bs[i]
+
+@[extern "lean_bit_array_fget"]
+def get : (bs : @& BitArray) → (@& Fin bs.size) → Bool
+  | ⟨bs⟩, i => bs.get i
+
+@[extern "lean_bit_array_get"]
+def get! : (@& BitArray) → (@& Nat) → Bool
+  | ⟨bs⟩, i => bs.get! i
+
+def get? (bs : BitArray) (i : Nat) : Option Bool :=
+  if h : i < bs.size then
+    bs.get ⟨i, h⟩
+  else
+    none
+
+instance : GetElem BitArray Nat Bool fun xs i => i < xs.size where
+  getElem xs i h := xs.get ⟨i, h⟩
+
+instance : GetElem BitArray USize Bool fun xs i => i.val < xs.size where
+  getElem xs i h := xs.uget i h
+
+@[extern "lean_bit_array_uset"]
+def uset : (a : BitArray) → (i : USize) → Bool → i.toNat < a.size → BitArray
+  | ⟨bs⟩, i, v, h => ⟨bs.uset i v h⟩
+
+@[extern "lean_bit_array_fset"]
+def set : (bs : BitArray) → (@& Fin bs.size) → Bool → BitArray
+  | ⟨bs⟩, i, b => ⟨bs.set i b⟩
+
+@[extern "lean_bit_array_set"]
+def set! : BitArray → (@& Nat) → Bool → BitArray
+  | ⟨bs⟩, i, b => ⟨bs.set! i b⟩
+
+def isEmpty (s : BitArray) : Bool :=
+  s.size == 0
+
+/-- Number of bits that are set. -/
+@[extern "lean_bit_array_popcount"]
+def popcount (a : @& BitArray) : Nat :=
+  a.data.foldl (fun n b => if b then n + 1 else n) 0
+
+/-- Index of the first set bit at or after `start`, or `a.size` if there is none. -/
+@[extern "lean_bit_array_find_first_set"]
+def findFirstSetCore (a : @& BitArray) (start : @& Nat) : Nat :=
+  ((List.range a.size).find? fun i => start ≤ i && a.data[i]!).getD a.size
+
+/-- Index of the first set bit at or after `start`. -/
+@[inline] def findFirstSet? (a : BitArray) (start := 0) : Option Nat :=
+  let i := a.findFirstSetCore start
+  if i < a.size then some i else none
+
+/-!
+The binary operations below return an array of the size of `a`, reading the bits of `b` past its size
+as `false`, and update `a` in place when it is not shared.
+-/
+
+@[extern "lean_bit_array_and"]
+protected def and (a : BitArray) (b : @& BitArray) : BitArray :=
+  ⟨a.data.mapIdx fun i x => x && b.data.getD i.val false⟩
+
+@[extern "lean_bit_array_or"]
+protected def or (a : BitArray) (b : @& BitArray) : BitArray :=
+  ⟨a.data.mapIdx fun i x => x || b.data.getD i.val false⟩
+
+@[extern "lean_bit_array_xor"]
+protected def xor (a : BitArray) (b : @& BitArray) : BitArray :=
+  ⟨a.data.mapIdx fun i x => x != b.data.getD i.val false⟩
+
+@[extern "lean_bit_array_not"]
+protected def not (a : BitArray) : BitArray :=
+  ⟨a.data.map (!·)⟩
+
+/-- Move bit `i` to `i + k`, keeping the size. The first `k` bits become `false`. -/
+@[extern "lean_bit_array_shift_left"]
+def shiftLeft (a : BitArray) (k : @& Nat) : BitArray :=
+  ⟨a.data.mapIdx fun i _ => if k ≤ i.val then a.data[i.val - k]! else false⟩
+
+/-- Move bit `i` to `i - k`, keeping the size. The last `k` bits become `false`. -/
+@[extern "lean_bit_array_shift_right"]
+def shiftRight (a : BitArray) (k : @& Nat) : BitArray :=
+  ⟨a.data.mapIdx fun i _ => a.data.getD (i.val + k) false⟩
+
+instance : AndOp BitArray := ⟨BitArray.and⟩
+instance : OrOp BitArray := ⟨BitArray.or⟩
+instance : Xor BitArray := ⟨BitArray.xor⟩
+instance : Complement BitArray := ⟨BitArray.not⟩
+instance : HShiftLeft BitArray Nat BitArray := ⟨shiftLeft⟩
+instance : HShiftRight BitArray Nat BitArray := ⟨shiftRight⟩
+
+@[extern "lean_bit_array_beq"]
+protected def beq (a b : @& BitArray) : Bool :=
+  a.data == b.data
+
+instance : BEq BitArray := ⟨BitArray.beq⟩
+
+def toList (bs : BitArray) : List Bool :=
+  bs.data.toList
+
+/-- Indices of the set bits, in increasing order. -/
+partial def toIndices (bs : BitArray) : Array Nat :=
+  let rec loop (i : Nat) (r : Array Nat) :=
+    match bs.findFirstSet? i with
+    | some j => loop (j + 1) (r.push j)
+    | none   => r
+  loop 0 #[]
+
+end BitArray
+
+def List.toBitArray (bs : List Bool) : BitArray :=
+  let rec loop
+    | [],    r => r
+    | b::bs, r => loop bs (r.push b)
+  loop bs BitArray.empty
+
+instance : ToString BitArray := ⟨fun bs => bs.toList.toString⟩
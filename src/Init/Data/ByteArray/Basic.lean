@@ -77,6 +77,10 @@ protected opaque hash (a : @& ByteArray) : UInt64
 instance : Hashable ByteArray where
   hash := ByteArray.hash
 
+/-- A fast hash function keyed by `seed`, see `String.hashWithSeed`. -/
+@[extern "lean_byte_array_hash_with_seed"]
+opaque hashWithSeed (a : @& ByteArray) (seed : UInt64) : UInt64
+
 def isEmpty (s : ByteArray) : Bool :=
   s.size == 0
 
@@ -116,6 +120,46 @@ def toList (bs : ByteArray) : List UInt8 :=
     decreasing_by decreasing_trivial_pre_omega
   loop start
 
+/-- Set the bytes in `[off, off + len)` to `v`. The range is truncated to the size of `a`. -/
+@[extern "lean_byte_array_fill"]
+def fill (a : ByteArray) (off len : @& Nat) (v : UInt8) : ByteArray :=
+  ⟨a.data.mapIdx fun i b => if off ≤ i.val && i.val < off + len then v else b⟩
+
+/-- Index of the first occurrence of `v` at or after `start`, or `a.size` if there is none. -/
+@[extern "lean_byte_array_index_of"]
+def indexOfCore (a : @& ByteArray) (v : UInt8) (start : @& Nat) : Nat :=
+  (a.findIdx? (· == v) start).getD a.size
+
+/-- Index of the first occurrence of `v` at or after `start`. This uses `memchr`. -/
+@[inline] def indexOf? (a : ByteArray) (v : UInt8) (start := 0) : Option Nat :=
+  let i := a.indexOfCore v start
+  if i < a.size then some i else none
+
+/-- Lexicographic comparison of byte arrays. -/
+@[extern "lean_byte_array_compare"]
+protected def compare (a b : @& ByteArray) : Ordering :=
+  let rec loop (i : Nat) : Ordering :=
+    if i < a.size then
+      if i < b.size then
+        let x := a.get! i
+        let y := b.get! i
+        if x < y then .lt else if y < x then .gt else loop (i+1)
+      else
+        .gt
+    else
+      if i < b.size then .lt else .eq
+    termination_by a.size - i
+    decreasing_by decreasing_trivial_pre_omega
+  loop 0
+
+instance : Ord ByteArray := ⟨ByteArray.compare⟩
+
+@[extern "lean_byte_array_beq"]
+protected def beq (a b : @& ByteArray) : Bool :=
+  a.data == b.data
+
+instance : BEq ByteArray := ⟨ByteArray.beq⟩
+
 /--
   We claim this unsafe implementation is correct because an array cannot have more than `usizeSz` elements in our runtime.
   This is similar to the `Array` version.
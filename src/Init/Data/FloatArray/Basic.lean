@@ -80,6 +80,73 @@ def set! : FloatArray → (@& Nat) → Float → FloatArray
 def isEmpty (s : FloatArray) : Bool :=
   s.size == 0
 
+/--
+  Copy the slice at `[srcOff, srcOff + len)` in `src` to `[destOff, destOff + len)` in `dest`, growing `dest` if necessary.
+  If `exact` is `false`, the capacity will be doubled when grown. -/
+@[extern "lean_float_array_copy_slice"]
+def copySlice (src : @& FloatArray) (srcOff : Nat) (dest : FloatArray) (destOff len : Nat) (exact : Bool := true) : FloatArray :=
+  ⟨dest.data.extract 0 destOff ++ src.data.extract srcOff (srcOff + len) ++ dest.data.extract (destOff + min len (src.data.size - srcOff)) dest.data.size⟩
+
+def extract (a : FloatArray) (b e : Nat) : FloatArray :=
+  a.copySlice b empty 0 (e - b)
+
+protected def append (a : FloatArray) (b : FloatArray) : FloatArray :=
+  b.copySlice 0 a a.size b.size false
+
+instance : Append FloatArray := ⟨FloatArray.append⟩
+
+/-- Set the elements in `[off, off + len)` to `v`. The range is truncated to the size of `a`. -/
+@[extern "lean_float_array_fill"]
+def fill (a : FloatArray) (off len : @& Nat) (v : Float) : FloatArray :=
+  ⟨a.data.mapIdx fun i x => if off ≤ i.val && i.val < off + len then v else x⟩
+
+/-!
+The element-wise operations below truncate to the shortest operand, and update `a` in place when it is
+not shared.
+-/
+
+/-- Element-wise sum `a[i] + b[i]`. -/
+@[extern "lean_float_array_add"]
+def add (a : FloatArray) (b : @& FloatArray) : FloatArray :=
+  ⟨a.data.zipWith b.data (· + ·)⟩
+
+/-- Element-wise product `a[i] * b[i]`. -/
+@[extern "lean_float_array_mul"]
+def mul (a : FloatArray) (b : @& FloatArray) : FloatArray :=
+  ⟨a.data.zipWith b.data (· * ·)⟩
+
+/--
+Element-wise `a[i] * b[i] + c[i]`. The compiled code may contract this into a fused multiply-add
+when the target has one, in which case the result is only rounded once.
+-/
+@[extern "lean_float_array_fma"]
+def fma (a : FloatArray) (b c : @& FloatArray) : FloatArray :=
+  ⟨(a.data.zipWith b.data (· * ·)).zipWith c.data (· + ·)⟩
+
+/-!
+The reductions below are vectorized in the runtime and add elements in a different order than a left
+fold, so `sum` and `dot` can differ from `foldl (· + ·) 0` by rounding.
+-/
+
+/-- Dot product of the common prefix of `a` and `b`. -/
+@[extern "lean_float_array_dot"]
+def dot (a b : @& FloatArray) : Float :=
+  (a.data.zipWith b.data (· * ·)).foldl (· + ·) 0
+
+@[extern "lean_float_array_sum"]
+def sum (a : @& FloatArray) : Float :=
+  a.data.foldl (· + ·) 0
+
+/-- Smallest element of `a`, ignoring `NaN`s. Returns `inf` if there is no such element. -/
+@[extern "lean_float_array_min"]
+def min (a : @& FloatArray) : Float :=
+  a.data.foldl (fun m x => if x < m then x else m) (1/0)
+
+/-- Largest element of `a`, ignoring `NaN`s. Returns `-inf` if there is no such element. -/
+@[extern "lean_float_array_max"]
+def max (a : @& FloatArray) : Float :=
+  a.data.foldl (fun m x => if x > m then x else m) (-1/0)
+
 partial def toList (ds : FloatArray) : List Float :=
   let rec loop (i r) :=
     if h : i < ds.size then
@@ -7,6 +7,7 @@ prelude
 import Init.Control.State
 import Init.Data.Int.Basic
 import Init.Data.String.Basic
+import Init.Data.String.Builder
 
 namespace Std
 
@@ -289,13 +290,13 @@ def indentD (f : Format) : Format :=
 
 /-- State for formatting a pretty string. -/
 private structure State where
-  out    : String := ""
-  column : Nat    := 0
+  out    : StringBuilder := {}
+  column : Nat           := 0
 
 instance : MonadPrettyFormat (StateM State) where
   -- We avoid a structure instance update, and write these functions using pattern matching because of issue #316
   pushOutput s       := modify fun ⟨out, col⟩ => ⟨out ++ s, col + s.length⟩
-  pushNewline indent := modify fun ⟨out, _⟩ => ⟨out ++ "\n".pushn ' ' indent, indent⟩
+  pushNewline indent := modify fun ⟨out, _⟩ => ⟨(out.push '\n').pushn ' ' indent, indent⟩
   currColumn         := return (← get).column
   startTag _         := return ()
   endTags _          := return ()
@@ -311,7 +312,7 @@ Renders a `Format` to a string.
 @[export lean_format_pretty]
 def pretty (f : Format) (width : Nat := defWidth) (indent : Nat := 0) (column := 0) : String :=
   let act : StateM State Unit := prettyM f width indent
-  State.out <| act (State.mk "" column) |>.snd
+  State.out (act (State.mk {} column)).snd |>.toString
 
 end Format
 
@@ -59,6 +59,23 @@ instance : Hashable Int where
 instance (P : Prop) : Hashable P where
   hash _ := 0
 
+/--
+A fast string hash function keyed by `seed`. Unlike `String.hash`, which is used for hash codes stored in
+`.olean` files, its values are not stable across Lean versions. Use it with `IO.hashSeed` for hash tables
+keyed by untrusted input.
+-/
+@[extern "lean_string_hash_with_seed"]
+opaque String.hashWithSeed (s : @& String) (seed : UInt64) : UInt64
+
+/--
+`Hashable String` using `String.hashWithSeed` with the given seed. It is not an instance, so the default
+`String.hash` instance stays in effect; opt in for a particular hash table with, for example,
+`letI := String.seededHashable (← IO.hashSeed)` before creating a `Std.HashMap String α`. The seed then
+becomes part of the map's type class arguments, so all operations on the map use the same seed.
+-/
+@[reducible] def String.seededHashable (seed : UInt64) : Hashable String where
+  hash s := s.hashWithSeed seed
+
 /-- An opaque (low-level) hash operation used to implement hashing for pointers. -/
 @[always_inline, inline] def hash64 (u : UInt64) : UInt64 :=
   mixHash u 11
@@ -515,7 +515,9 @@ instance : Append String := ⟨String.append⟩
 @[deprecated push (since := "2024-04-06")]
 def str : String → Char → String := push
 
-@[inline] def pushn (s : String) (c : Char) (n : Nat) : String :=
+/-- Appends `n` copies of `c`. This reserves space for all of them at once. -/
+@[extern "lean_string_pushn"]
+def pushn (s : String) (c : Char) (n : @& Nat) : String :=
   n.repeat (fun s => s.push c) s
 
 @[inline] def isEmpty (s : String) : Bool :=
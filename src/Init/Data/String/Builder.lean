@@ -0,0 +1,64 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+Authors: agent
+-/
+prelude
+import Init.Data.String.Basic
+
+/--
+A buffer for building a string by repeated appending.
+
+At runtime a `StringBuilder` is the `String` it wraps, so `toString` returns the buffer without
+copying it. The buffer grows geometrically and the character count is kept up to date by every
+append, so building a string of size `n` from many fragments takes `O(n)` time, as long as the
+builder is used linearly. Unlike `String.append`, the operations below do not allocate the fragment
+being appended.
+-/
+structure StringBuilder where
+  /-- The string built so far. -/
+  toString : String
+  deriving Inhabited
+
+namespace StringBuilder
+
+/-- An empty builder with room for `capacity` bytes. -/
+@[extern "lean_mk_empty_string_with_capacity"]
+def mkEmpty (capacity : @& Nat) : StringBuilder :=
+  ⟨""⟩
+
+def empty : StringBuilder :=
+  mkEmpty 0
+
+instance : EmptyCollection StringBuilder := ⟨empty⟩
+
+@[inline] def push (b : StringBuilder) (c : Char) : StringBuilder :=
+  ⟨b.toString.push c⟩
+
+/-- Appends `n` copies of `c`. -/
+@[inline] def pushn (b : StringBuilder) (c : Char) (n : Nat) : StringBuilder :=
+  ⟨b.toString.pushn c n⟩
+
+@[inline] def append (b : StringBuilder) (s : String) : StringBuilder :=
+  ⟨b.toString ++ s⟩
+
+instance : HAppend StringBuilder String StringBuilder := ⟨append⟩
+
+/-- Appends `s.extract start stop`. -/
+@[extern "lean_string_append_extract"]
+def appendExtract (b : StringBuilder) (s : @& String) (start stop : @& String.Pos) : StringBuilder :=
+  ⟨b.toString ++ s.extract start stop⟩
+
+@[inline] def appendSubstring (b : StringBuilder) (s : Substring) : StringBuilder :=
+  b.appendExtract s.str s.startPos s.stopPos
+
+/-- Number of characters appended so far. This is `O(1)`. -/
+@[inline] def length (b : StringBuilder) : Nat :=
+  b.toString.length
+
+@[inline] def utf8ByteSize (b : StringBuilder) : Nat :=
+  b.toString.utf8ByteSize
+
+end StringBuilder
+
+instance : ToString StringBuilder := ⟨StringBuilder.toString⟩
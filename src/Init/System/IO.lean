@@ -181,6 +181,13 @@ def lazyPure (fn : Unit → α) : IO α :=
 If `nBytes = 0`, return immediately with an empty buffer. -/
 @[extern "lean_io_get_random_bytes"] opaque getRandomBytes (nBytes : USize) : IO ByteArray
 
+/--
+A seed for `String.hashWithSeed` and `ByteArray.hashWithSeed` that is chosen at random once per process,
+so that hash tables keyed by untrusted input are not vulnerable to collision attacks. Setting the
+environment variable `LEAN_HASH_SEED` to a number fixes the seed, for example to reproduce a run.
+-/
+@[extern "lean_io_hash_seed"] opaque hashSeed : BaseIO UInt64
+
 def sleep (ms : UInt32) : BaseIO Unit :=
   -- TODO: add a proper primitive for IO.sleep
   fun s => dbgSleep ms fun _ => EStateM.Result.ok () s
@@ -376,6 +383,19 @@ open FS
 
 namespace FS
 
+/-- The expected access pattern of a region of a file, see `Handle.advise`. -/
+inductive AccessAdvice where
+  /-- No particular pattern. This is the default. -/
+  | normal
+  /-- The region will be read sequentially, so the kernel may read ahead aggressively. -/
+  | sequential
+  /-- The region will be read in random order, so reading ahead is wasted. -/
+  | random
+  /-- The region will be read soon, so the kernel may start loading it now. -/
+  | willNeed
+  /-- The region will not be read soon, so the kernel may drop it from the page cache. -/
+  | dontNeed
+
 namespace Handle
 
 @[extern "lean_io_prim_handle_mk"] opaque mk (fn : @& FilePath) (mode : FS.Mode) : IO Handle
@@ -431,6 +451,60 @@ If the returned string is empty, an end-of-file marker has been reached.
 Note that EOF does not actually close a handle, so further reads may block and return more data.
 -/
 @[extern "lean_io_prim_handle_get_line"] opaque getLine (h : @& Handle) : IO String
+
+/-!
+The positional operations below access the file at an explicit byte offset through its file descriptor.
+They bypass the buffer of the handle, so `flush` the handle before mixing them with `write`. On Unix they
+neither use nor move the read/write cursor, so tasks can use them concurrently on disjoint regions of the
+same handle. On Windows they move the cursor.
+-/
+
+/--
+Reads up to `bytes` bytes at `offset`. The result is only shorter than `bytes` if the end of the file
+was reached.
+-/
+@[extern "lean_io_prim_handle_read_at"] opaque readAt (h : @& Handle) (offset : UInt64) (bytes : USize) : IO ByteArray
+/-- Writes `buffer` at `offset`, extending the file if necessary. -/
+@[extern "lean_io_prim_handle_write_at"] opaque writeAt (h : @& Handle) (offset : UInt64) (buffer : @& ByteArray) : IO Unit
+/--
+Reads consecutive regions of `sizes[i]` bytes starting at `offset` into one array each, using as few
+system calls as possible. Only the regions past the end of the file are shorter than requested.
+-/
+@[extern "lean_io_prim_handle_readv_at"] opaque readvAt (h : @& Handle) (offset : UInt64) (sizes : @& Array USize) : IO (Array ByteArray)
+/-- Writes the concatenation of `buffers` at `offset`, using as few system calls as possible. -/
+@[extern "lean_io_prim_handle_writev_at"] opaque writevAt (h : @& Handle) (offset : UInt64) (buffers : @& Array ByteArray) : IO Unit
+/--
+Announces how the `len` bytes at `offset` will be accessed, where `len = 0` extends to the end of the file.
+This is a hint (`posix_fadvise`), and does nothing on platforms other than Linux.
+-/
+@[extern "lean_io_prim_handle_advise"] opaque advise (h : @& Handle) (offset len : UInt64) (advice : AccessAdvice) : IO Unit
+/--
+Ensures that the file covers the `len` bytes at `offset`, so that later writes there do not fail for lack of
+disk space. On Linux this reserves the disk blocks (`posix_fallocate`); elsewhere it only extends the file.
+-/
+@[extern "lean_io_prim_handle_allocate"] opaque allocate (h : @& Handle) (offset len : UInt64) : IO Unit
+
+/--
+Reads up to `maxLines` lines (which should be positive) with their `\n` or `\r\n` terminators removed.
+The result is only shorter than `maxLines` if the end of the file was reached, and empty if there was
+nothing left to read. This is faster than repeated `getLine` as it reuses one buffer for all lines.
+-/
+@[extern "lean_io_prim_handle_read_lines"] opaque readLines (h : @& Handle) (maxLines : USize) : IO (Array String)
+
+@[extern "lean_io_prim_handle_read_any"]
+opaque readAnyCore (hs : @& Array Handle) (timeoutMs : UInt32) : IO (Array (Nat × ByteArray))
+
+/--
+Waits until at least one of the handles `hs` (usually pipes) has data, for at most `timeoutMs?`
+milliseconds, and reads the available data of each ready handle, up to 64 KiB per handle. The result
+contains an `(i, data)` pair per ready handle `hs[i]`, where empty `data` signals the end of the file. It is
+empty on timeout.
+
+The data is read from the file descriptors directly, so the handles should not be read through their
+buffered functions such as `read` or `getLine` as well.
+-/
+def readAny (hs : Array Handle) (timeoutMs? : Option Nat := none) : IO (Array (Nat × ByteArray)) :=
+  readAnyCore hs (timeoutMs?.map (min · (UInt32.size - 2)) |>.getD (UInt32.size - 1)).toUInt32
 @[extern "lean_io_prim_handle_put_str"] opaque putStr (h : @& Handle) (s : @& String) : IO Unit
 
 end Handle
@@ -447,6 +521,25 @@ see there for more information.
 @[extern "lean_io_remove_dir"] opaque removeDir : @& FilePath → IO Unit
 @[extern "lean_io_create_dir"] opaque createDir : @& FilePath → IO Unit
 
+/--
+Returns the contents of the file `fname`, memory-mapped instead of read. Pages of the file are only
+loaded when they are first accessed, and the contents are never copied, so this is cheaper than
+`readBinFile` for large files, in particular when only a part of them is used. Updating the array
+in place copies the updated pages and never modifies the file. The mapping is released when the
+array is freed.
+
+The array is only a snapshot of the file if no other process modifies it while the array is in use:
+* The mapping is private (`MAP_PRIVATE`), but that only isolates the file from updates of the array.
+  Pages that have not been updated in place yet can show writes made to the file by other processes,
+  even after they have been read, so the array may appear to change.
+* If the file is truncated, accessing pages past its new end raises `SIGBUS` and terminates the
+  process; this cannot be caught as an `IO` error.
+
+Use `readBinFile` for files that may be modified concurrently. Files that cannot be mapped, such as
+pipes, and all files on platforms without `mmap`, are read into memory instead.
+-/
+@[extern "lean_io_mmap_file"] opaque mmapFile (fname : @& FilePath) : IO ByteArray
+
 
 /--
 Moves a file or directory `old` to the new location `new`.
@@ -456,6 +549,30 @@ see there for more information.
 -/
 @[extern "lean_io_rename"] opaque rename (old new : @& FilePath) : IO Unit
 
+/--
+Copies the contents and permission bits of file `src` to `dst`, replacing `dst` if it exists. Fails if `src`
+and `dst` are the same file.
+
+The data does not pass through a Lean buffer: the copy shares the blocks of `src` on filesystems supporting
+it (`FICLONE` on Linux, `clonefile` on macOS) and is otherwise done by the kernel (`copy_file_range` or
+`sendfile` on Linux).
+-/
+@[extern "lean_io_copy_file"] opaque copyFile (src dst : @& FilePath) : IO Unit
+
+/--
+Creates a new hard link `link` to the file `orig`. Fails if `link` exists or is on a different filesystem.
+
+This function coincides with the [POSIX `link` function](https://pubs.opengroup.org/onlinepubs/9699919799/functions/link.html).
+-/
+@[extern "lean_io_hard_link"] opaque hardLink (orig link : @& FilePath) : IO Unit
+
+/--
+Atomically exchanges the files or directories `a` and `b`, which must both exist.
+
+Supported on Linux (`renameat2` with `RENAME_EXCHANGE`) and macOS (`renamex_np` with `RENAME_SWAP`).
+-/
+@[extern "lean_io_rename_exchange"] opaque renameExchange (a b : @& FilePath) : IO Unit
+
 /--
 Creates a temporary file in the most secure manner possible. There are no race conditions in the
 file’s creation. The file is readable and writable only by the creating user ID. Additionally
@@ -494,7 +611,7 @@ def Handle.putStrLn (h : Handle) (s : String) : IO Unit :=
 
 partial def Handle.readBinToEndInto (h : Handle) (buf : ByteArray) : IO ByteArray := do
   let rec loop (acc : ByteArray) : IO ByteArray := do
-    let buf ← h.read 1024
+    let buf ← h.read (64 * 1024)
     if buf.isEmpty then
       return acc
     else
@@ -513,15 +630,11 @@ def Handle.readToEnd (h : Handle) : IO String := do
 partial def lines (fname : FilePath) : IO (Array String) := do
   let h ← Handle.mk fname Mode.read
   let rec read (lines : Array String) := do
-    let line ← h.getLine
-    if line.length == 0 then
-      pure lines
-    else if line.back == '\n' then
-      let line := line.dropRight 1
-      let line := if line.back == '\r' then line.dropRight 1 else line
-      read <| lines.push line
+    let chunk ← h.readLines 4096
+    if chunk.size < 4096 then
+      pure (lines ++ chunk)
     else
-      pure <| lines.push line
+      read (lines ++ chunk)
   read #[]
 
 def writeBinFile (fname : FilePath) (content : ByteArray) : IO Unit := do
@@ -566,6 +679,14 @@ structure Metadata where
   type     : FileType
   deriving Repr
 
+/-- An entry returned by `System.FilePath.walkDirEntries`. -/
+structure WalkEntry where
+  path      : FilePath
+  /-- The metadata of the entry, if requested. -/
+  metadata? : Option Metadata
+  type      : FileType
+  deriving Repr
+
 end FS
 end IO
 
@@ -610,12 +731,50 @@ where
       | .error (.noFileOrDirectory ..) => pure ()
       | .error e => throw e
 
+@[extern "lean_io_walk_dir"]
+opaque walkDirEntriesCore (p : @& FilePath) (metadata followSymlinks : Bool) (threads : USize) : IO (Array IO.FS.WalkEntry)
+
+/--
+  Return all filesystem entries below `p`, sorted by path so that every directory precedes its contents.
+
+  Unlike `walkDir`, the directories are read by up to `threads` native threads (by default, one per core
+  up to 8), the entry types come from the directory listing without a `stat` call where the platform
+  provides them, and the metadata of every entry is only queried if `metadata` is set. With
+  `followSymlinks`, links to directories are entered (except for links back to one of their ancestors), and
+  the types and metadata of links are those of their targets. Entries below a followed link are reported
+  below the link's path, not below the real path of its target; this matches `walkDir`, which enters links
+  to directories at their own path as well because `metadata` follows links. Entries vanishing during the
+  walk are ignored. -/
+def walkDirEntries (p : FilePath) (metadata := false) (followSymlinks := false) (threads : Nat := 0) :
+    IO (Array IO.FS.WalkEntry) :=
+  walkDirEntriesCore p metadata followSymlinks threads.toUSize
+
 end System.FilePath
 
 namespace IO
 
 namespace FS
 
+/--
+Makes `dst` a hard link to `src`, or a copy of `src` if it cannot be linked (e.g. because it is on a
+different filesystem), replacing `dst` if it exists. This materializes files from a local content-addressed
+store without copying their data where possible. As `src` and `dst` may share their contents afterwards,
+neither should be modified in place. Does nothing if `src` and `dst` are the same file.
+-/
+def linkOrCopyFile (src dst : FilePath) : IO Unit := do
+  if (← dst.pathExists) && (← realPath src) == (← realPath dst) then
+    -- removing `dst` would remove `src`
+    return
+  try
+    removeFile dst
+  catch
+    | .noFileOrDirectory .. => pure ()
+    | e => throw e
+  try
+    hardLink src dst
+  catch _ =>
+    copyFile src dst
+
 def readBinFile (fname : FilePath) : IO ByteArray := do
   -- Requires metadata so defined after metadata
   let mdata ← fname.metadata
@@ -752,8 +911,22 @@ structure Child (cfg : StdioConfig) where
   stdout : cfg.stdout.toHandleType
   stderr : cfg.stderr.toHandleType
 
+/--
+Spawns a child process. On Unix, the process is started with `posix_spawn` (or `vfork` where it cannot
+express `cwd` or `setsid`), so this does not copy the memory mappings of the current process. If the
+command cannot be found or executed, an error is thrown.
+-/
 @[extern "lean_io_process_spawn"] opaque spawn (args : SpawnArgs) : IO (Child args.toStdioConfig)
 
+/--
+Spawns a child process for each element of `args`, all with the standard stream configuration `cfg`; the
+stream configurations of `args` are ignored. This saves the per-call overhead of `spawn` when starting
+many processes at once. If one of the processes cannot be spawned, the ones already spawned are killed
+and the error is thrown.
+-/
+@[extern "lean_io_process_spawn_many"]
+opaque spawnMany (cfg : @& StdioConfig) (args : @& Array SpawnArgs) : IO (Array (Child cfg))
+
 /--
 Block until the child process has exited and return its exit code.
 -/
@@ -765,6 +938,17 @@ Check whether the child has exited yet. If it hasn't return none, otherwise its
 @[extern "lean_io_process_child_try_wait"] opaque Child.tryWait {cfg : @& StdioConfig} : @& Child cfg →
     IO (Option UInt32)
 
+@[extern "lean_io_process_child_wait_any"]
+opaque Child.waitAnyCore {cfg : @& StdioConfig} (children : @& Array (Child cfg)) (timeoutMs : UInt32) :
+    IO (Option (Nat × UInt32))
+
+/--
+Blocks until one of `children` has exited, for at most `timeoutMs?` milliseconds, and returns its index
+and exit code, or `none` on timeout. On Unix the child is reaped, so it must not be waited for again.
+-/
+def Child.waitAny {cfg : StdioConfig} (children : Array (Child cfg)) (timeoutMs? : Option Nat := none) : IO (Option (Nat × UInt32)) :=
+  Child.waitAnyCore children (timeoutMs?.map (min · (UInt32.size - 2)) |>.getD (UInt32.size - 1)).toUInt32
+
 /-- Terminates the child process using the SIGTERM signal or a platform analogue.
     If the process was started using `SpawnArgs.setsid`, terminates the entire process group instead. -/
 @[extern "lean_io_process_child_kill"] opaque Child.kill {cfg : @& StdioConfig} : @& Child cfg → IO Unit
@@ -783,17 +967,71 @@ structure Output where
   stdout   : String
   stderr   : String
 
+/-- The output stream of a child process a chunk passed to the callback of `stream` was read from. -/
+inductive OutputStream where
+  | stdout
+  | stderr
+  deriving Inhabited, BEq
+
+private def remainingMs (deadline? : Option Nat) : BaseIO (Option Nat) := do
+  match deadline? with
+  | none => return none
+  | some deadline => return some (deadline - (← monoMsNow))
+
+/-- Reads `pipes` until all of them are closed. Returns `false` if `deadline?` passed before. -/
+private partial def streamPipes (pipes : Array (FS.Handle × OutputStream)) (deadline? : Option Nat)
+    (onOutput : OutputStream → ByteArray → σ → IO σ) (s : σ) : IO (Bool × σ) := do
+  if pipes.isEmpty then
+    return (true, s)
+  let rem? ← remainingMs deadline?
+  if rem? == some 0 then
+    return (false, s)
+  let mut s := s
+  let mut closed := #[]
+  for (i, chunk) in ← FS.Handle.readAny (pipes.map (·.1)) rem? do
+    if chunk.isEmpty then
+      closed := closed.push i
+    else if let some (_, k) := pipes[i]? then
+      s ← onOutput k chunk s
+  let pipes := pipes.zipWithIndex.filterMap fun (p, i) => if closed.contains i then none else some p
+  streamPipes pipes deadline? onOutput s
+
+/--
+Runs a process to completion, passing the chunks of its stdout and stderr to `onOutput` as they arrive,
+which updates a state starting at `init`. Both pipes are read on the calling thread without blocking on
+either of them, so the process can never get stuck on a full pipe, and no further thread is needed.
+The process does not inherit the standard input of the caller.
+
+If the process is still running after `timeoutMs?` milliseconds, it is killed and `none` is returned
+as its exit code.
+-/
+def stream (args : SpawnArgs) (init : σ) (onOutput : OutputStream → ByteArray → σ → IO σ)
+    (timeoutMs? : Option Nat := none) : IO (Option UInt32 × σ) := do
+  let child ← spawn { args with stdout := .piped, stderr := .piped, stdin := .null }
+  let deadline? := timeoutMs?.map ((· + ·) (← monoMsNow))
+  let (finished, s) ← streamPipes #[(child.stdout, .stdout), (child.stderr, .stderr)] deadline? onOutput init
+  if finished then
+    if let some (_, exitCode) := (← Child.waitAny #[child] (← remainingMs deadline?)) then
+      return (some exitCode, s)
+  child.kill
+  discard child.wait
+  return (none, s)
+
 /--
 Run process to completion and capture output.
 The process does not inherit the standard input of the caller.
 -/
 def output (args : SpawnArgs) : IO Output := do
-  let child ← spawn { args with stdout := .piped, stderr := .piped, stdin := .null }
-  let stdout ← IO.asTask child.stdout.readToEnd Task.Priority.dedicated
-  let stderr ← child.stderr.readToEnd
-  let exitCode ← child.wait
-  let stdout ← IO.ofExcept stdout.get
-  pure { exitCode := exitCode, stdout := stdout, stderr := stderr }
+  let (exitCode?, (stdout, stderr)) ← stream args (#[], #[]) fun
+    | .stdout, chunk, (out, err) => return (out.push chunk, err)
+    | .stderr, chunk, (out, err) => return (out, err.push chunk)
+  let some exitCode := exitCode? | unreachable!
+  let decode (chunks : Array ByteArray) : IO String := do
+    let data := chunks.foldl (· ++ ·) (ByteArray.mkEmpty (chunks.foldl (· + ·.size) 0))
+    match String.fromUTF8? data with
+    | some s => return s
+    | none => throw <| .userError s!"Tried to read from handle containing non UTF-8 data."
+  pure { exitCode := exitCode, stdout := ← decode stdout, stderr := ← decode stderr }
 
 /-- Run process to completion and return stdout on success. -/
 def run (args : SpawnArgs) : IO String := do
@@ -56,3 +56,41 @@ The task blocks until `Promise.resolve` is called.
 opaque Promise.result (promise : Promise α) : Task α :=
   have : Nonempty α := promise.h
   Classical.choice inferInstance
+
+/--
+Resolves a `Promise` with `value` once `ms` milliseconds have passed, unless it has been resolved before.
+
+The pending timer is kept by the runtime and does not occupy a thread while it is waiting.
+-/
+@[extern "lean_io_promise_resolve_after"]
+opaque Promise.resolveAfter (value : α) (promise : @& Promise α) (ms : UInt32) : BaseIO Unit
+
+/--
+Returns a task that finishes after `ms` milliseconds. Unlike running `IO.sleep` in a task, this does not
+occupy a thread while waiting, so it can be used freely for debouncing and timeouts.
+-/
+def sleepAsync (ms : UInt32) : BaseIO (Task Unit) := do
+  let promise : Promise Unit ← Promise.new
+  promise.resolveAfter () ms
+  return promise.result
+
+/--
+Returns a task that finishes with the result of `t`, or with `none` if `t` has not finished after `ms`
+milliseconds. `t` itself is not canceled.
+-/
+def timeout (t : Task α) (ms : UInt32) : BaseIO (Task (Option α)) := do
+  let promise : Promise (Option α) ← Promise.new
+  promise.resolveAfter none ms
+  discard <| BaseIO.mapTask (fun a => promise.resolve (some a)) t (sync := true)
+  return promise.result
+
+/--
+Waits until any of the tasks in the given list has finished, for at most `ms` milliseconds, and returns its
+result, or `none` on timeout.
+-/
+def waitAnyTimeout (tasks : List (Task α)) (ms : UInt32) : BaseIO (Option α) := do
+  let promise : Promise (Option α) ← Promise.new
+  promise.resolveAfter none ms
+  for t in tasks do
+    discard <| BaseIO.mapTask (fun a => promise.resolve (some a)) t (sync := true)
+  wait promise.result
@@ -0,0 +1,104 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+Authors: agent
+-/
+prelude
+import Init.System.IO
+import Init.Data.Channel
+
+set_option linter.missingDocs true
+
+namespace IO.FS
+
+/-- The kind of a `ChangeEvent`. -/
+inductive ChangeKind where
+  /-- The path was created, or moved into a watched directory. -/
+  | created
+  /-- The contents or attributes of the path were changed. -/
+  | modified
+  /-- The path was removed, or moved out of a watched directory. -/
+  | removed
+  /--
+  The operating system dropped events because they were not consumed fast enough. Any watched path may
+  have changed. The `path` of such an event is empty.
+  -/
+  | overflow
+  deriving Repr, BEq, Inhabited
+
+/-- A change to a path below a directory watched by a `Watcher`. -/
+structure ChangeEvent where
+  /-- The changed path, below the path that was passed to `Watcher.add`. -/
+  path : System.FilePath
+  /-- What happened to `path`. When there were several changes to `path` in one batch, this summarizes them. -/
+  kind : ChangeKind
+  deriving Repr, Inhabited
+
+private opaque WatcherImpl : NonemptyType.{0}
+
+/--
+A set of watched files and directories, backed by `inotify` on Linux. Watchers are not supported on other
+platforms yet, where `Watcher.new` throws an error.
+
+Typical usage is as follows:
+1. `let w ← Watcher.new` creates a watcher
+2. `w.add dir` starts watching `dir` and all directories below it
+3. `let ch ← w.changes` returns a channel receiving batches of changes
+4. `w.close` stops watching and closes the channel
+-/
+def Watcher : Type := WatcherImpl.type
+
+instance : Nonempty Watcher := WatcherImpl.property
+
+/-- Creates a new `Watcher` that does not watch any path yet. -/
+@[extern "lean_io_fs_watcher_new"]
+opaque Watcher.new : IO Watcher
+
+/--
+Watches `path`. If `path` is a directory, the changes to its entries are reported. If `recursive` is set,
+the changes below its subdirectories are reported as well, including subdirectories created later on.
+-/
+@[extern "lean_io_fs_watcher_add"]
+opaque Watcher.add (w : @& Watcher) (path : @& System.FilePath) (recursive := true) : IO Unit
+
+/--
+Blocks until a change happens, then collects further changes until none happened for `debounceMs`
+milliseconds, and returns them with one event per changed path. Returns `none` once the watcher is closed.
+
+Only one thread should wait on a watcher at a time; see `Watcher.changes`.
+-/
+@[extern "lean_io_fs_watcher_wait"]
+opaque Watcher.wait (w : @& Watcher) (debounceMs : UInt32 := 50) : IO (Option (Array ChangeEvent))
+
+/-- Stops watching all paths and wakes up a `Watcher.wait` call, which returns `none`. -/
+@[extern "lean_io_fs_watcher_close"]
+opaque Watcher.close (w : @& Watcher) : IO Unit
+
+private partial def Watcher.forward (w : Watcher) (debounceMs : UInt32) (ch : Channel (Array ChangeEvent)) :
+    IO Unit := do
+  if let some events ← w.wait debounceMs then
+    ch.send events
+    w.forward debounceMs ch
+
+/--
+Returns a channel receiving the batches of changes returned by `Watcher.wait` from a dedicated thread.
+The channel is closed when the watcher is closed or fails.
+-/
+def Watcher.changes (w : Watcher) (debounceMs : UInt32 := 50) : BaseIO (Channel (Array ChangeEvent)) := do
+  let ch ← Channel.new
+  discard <| IO.asTask (prio := .dedicated) do
+    try
+      w.forward debounceMs ch
+    finally
+      ch.close
+  return ch
+
+/--
+Returns a task that runs `Watcher.wait` on a dedicated thread: it is resolved with the next batch of changes
+of `w`, with `none` once `w` is closed, or with the error of `Watcher.wait`.
+-/
+def Watcher.next (w : Watcher) (debounceMs : UInt32 := 50) :
+    BaseIO (Task (Except IO.Error (Option (Array ChangeEvent)))) :=
+  IO.asTask (prio := .dedicated) (w.wait debounceMs)
+
+end IO.FS
@@ -8,16 +8,50 @@ import Lean.Environment
 
 namespace Lean
 
+structure ClosedTermCacheEntry where
+  expr   : Expr
+  name   : Name
+  /--
+  `true` if the closed term is exported by the current module, and may be reused by downstream modules.
+  Only shared entries are stored in the `.olean` file. -/
+  shared : Bool
+  deriving Inhabited
+
 structure ClosedTermCache where
-  map        : PHashMap Expr Name := {}
-  constNames : NameSet := {}
+  map         : PHashMap Expr Name := {}
+  /-- Closed terms extracted in the current module. -/
+  constNames  : NameSet := {}
+  /-- Closed terms extracted in the current module that are exported for downstream modules. -/
+  sharedNames : NameSet := {}
   deriving Inhabited
 
-builtin_initialize closedTermCacheExt : EnvExtension ClosedTermCache ← registerEnvExtension (pure {})
+def ClosedTermCache.addEntry (s : ClosedTermCache) (e : ClosedTermCacheEntry) : ClosedTermCache :=
+  { s with
+    map         := s.map.insert e.expr e.name
+    constNames  := s.constNames.insert e.name
+    sharedNames := if e.shared then s.sharedNames.insert e.name else s.sharedNames }
+
+/--
+Closed terms extracted by the code generator. Imported entries only populate `map`: the key is the
+structural hash of the closed term (cached in `Expr.Data`), so an importing module reuses the
+definition (and initialization) of a closed term instead of creating its own copy.
+-/
+builtin_initialize closedTermCacheExt : SimplePersistentEnvExtension ClosedTermCacheEntry ClosedTermCache ←
+  registerSimplePersistentEnvExtension {
+    addEntryFn    := ClosedTermCache.addEntry
+    addImportedFn := fun ess => ess.foldl (init := {}) fun (s : ClosedTermCache) es =>
+      es.foldl (init := s) fun s e => { s with map := s.map.insert e.expr e.name }
+    toArrayFn     := fun es => es.toArray.filter (·.shared)
+  }
 
 @[export lean_cache_closed_term_name]
 def cacheClosedTermName (env : Environment) (e : Expr) (n : Name) : Environment :=
-  closedTermCacheExt.modifyState env fun s => { s with map := s.map.insert e n, constNames := s.constNames.insert n }
+  closedTermCacheExt.addEntry env { expr := e, name := n, shared := false }
+
+/-- Similar to `cacheClosedTermName`, but `n` is exported and can be reused by downstream modules. -/
+@[export lean_cache_shared_closed_term_name]
+def cacheSharedClosedTermName (env : Environment) (e : Expr) (n : Name) : Environment :=
+  closedTermCacheExt.addEntry env { expr := e, name := n, shared := true }
 
 @[export lean_get_closed_term_name]
 def getClosedTermName? (env : Environment) (e : Expr) : Option Name :=
@@ -26,4 +60,8 @@ def getClosedTermName? (env : Environment) (e : Expr) : Option Name :=
 def isClosedTermName (env : Environment) (n : Name) : Bool :=
   (closedTermCacheExt.getState env).constNames.contains n
 
+/-- Return `true` if `n` is a closed term of the current module that must be visible to downstream modules. -/
+def isSharedClosedTermName (env : Environment) (n : Name) : Bool :=
+  (closedTermCacheExt.getState env).sharedNames.contains n
+
 end Lean
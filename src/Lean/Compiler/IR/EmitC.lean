@@ -13,6 +13,7 @@ import Lean.Compiler.IR.EmitUtil
 import Lean.Compiler.IR.NormIds
 import Lean.Compiler.IR.SimpCase
 import Lean.Compiler.IR.Boxing
+import Lean.Util.SCC
 
 namespace Lean.IR.EmitC
 open ExplicitBoxing (requiresBoxedVersion mkBoxedName isBoxedName)
@@ -25,8 +26,12 @@ structure Context where
   jpMap      : JPParamsMap := {}
   mainFn     : FunId := default
   mainParams : Array Param := #[]
+  /-- Closed terms of the current module that are emitted as static data, see `emitStaticClosedTerms`. -/
+  staticClosedTerms : NameMap String := {}
+  /-- When the module is split into several translation units (see `emitCParts`), the declarations defined by the current one. -/
+  ownDecls?  : Option NameSet := none
 
-abbrev M := ReaderT Context (EStateM String String)
+abbrev M := ReaderT Context (EStateM String StringBuilder)
 
 def getEnv : M Environment := Context.env <$> read
 def getModName : M Name := Context.modName <$> read
@@ -37,7 +42,7 @@ def getDecl (n : Name) : M Decl := do
   | none   => throw s!"unknown declaration '{n}'"
 
 @[inline] def emit {α : Type} [ToString α] (a : α) : M Unit :=
-  modify fun out => out ++ toString a
+  modify fun out => out.append (toString a)
 
 @[inline] def emitLn {α : Type} [ToString α] (a : α) : M Unit := do
   emit a; emit "\n"
@@ -91,12 +96,17 @@ def toCInitName (n : Name) : M String := do
 def emitCInitName (n : Name) : M Unit :=
   toCInitName n >>= emit
 
+def isOwnDecl (n : Name) : M Bool :=
+  return (← read).ownDecls?.all (·.contains n)
+
 def emitFnDeclAux (decl : Decl) (cppBaseName : String) (isExternal : Bool) : M Unit := do
   let ps := decl.params
   let env ← getEnv
   if ps.isEmpty then
-    if isClosedTermName env decl.name then emit "static "
-    else if isExternal then emit "extern "
+    if isExternal then emit "extern "
+    else if isClosedTermName env decl.name && !isSharedClosedTermName env decl.name then
+      -- Closed terms are private to the module, but must be visible to all parts of a split module.
+      if (← read).ownDecls?.isNone then emit "static "
     else emit "LEAN_EXPORT "
   else
     if !isExternal then emit "LEAN_EXPORT "
@@ -127,13 +137,18 @@ def emitFnDecls : M Unit := do
   let env ← getEnv
   let decls := getDecls env
   let modDecls  : NameSet := decls.foldl (fun s d => s.insert d.name) {}
-  let usedDecls : NameSet := decls.foldl (fun s d => collectUsedDecls env d (s.insert d.name)) {}
+  let ownDecls? := (← read).ownDecls?
+  -- All declarations of the module are declared, but only the dependencies of the ones we define are collected.
+  let usedDecls : NameSet := decls.foldl (init := {}) fun s d =>
+    if ownDecls?.all (·.contains d.name) then collectUsedDecls env d (s.insert d.name) else s.insert d.name
   let usedDecls := usedDecls.toList
+  let staticClosedTerms := (← read).staticClosedTerms
   usedDecls.forM fun n => do
+    if staticClosedTerms.contains n then return
     let decl ← getDecl n;
     match getExternNameFor env `c decl.name with
     | some cName => emitExternDeclAux decl cName
-    | none       => emitFnDecl decl (!modDecls.contains n)
+    | none       => emitFnDecl decl (!modDecls.contains n || !(← isOwnDecl n))
 
 def emitMainFn : M Unit := do
   let d ← getDecl `main
@@ -639,7 +654,7 @@ def emitDeclAux (d : Decl) : M Unit := do
   let env ← getEnv
   let (_, jpMap) := mkVarJPMaps d
   withReader (fun ctx => { ctx with jpMap := jpMap }) do
-  unless hasInitAttr env d.name do
+  unless hasInitAttr env d.name || (← read).staticClosedTerms.contains d.name do
     match d with
     | .fdecl (f := f) (xs := xs) (type := t) (body := b) .. =>
       let baseName ← toCName f;
@@ -678,10 +693,92 @@ def emitDecl (d : Decl) : M Unit := do
   catch err =>
     throw s!"{err}\ncompiling:\n{d}"
 
+/-! Closed terms as static data.
+
+Closed terms are usually computed by the module initializer, and then marked as persistent. If the body of a closed
+term only builds string literals, small `Nat` literals, and constructor applications without scalar fields, we
+instead emit the persistent object (`m_rc == 0`) as constant data, and initializing it costs nothing at startup. -/
+
+structure StaticObjs where
+  /-- C definitions of the statically allocated objects. -/
+  defs : Array String := #[]
+  /-- C initializer expressions for the variables of the closed term body. -/
+  vals : Array (VarId × String) := #[]
+
+def staticArgToCString (s : StaticObjs) : Arg → Option String
+  | .var x      => s.vals.find? (·.1 == x) |>.map (·.2)
+  | .irrelevant => some "LEAN_STATIC_BOX(0)"
+
+/--
+Return the C initializer for `x : t := v`, and add the definition of the statically allocated object to `s` if needed.
+Return `none` if `v` cannot be computed at compile time. -/
+def toStaticVal (staticDecls : NameMap String) (baseName : String) (s : StaticObjs) (x : VarId) (t : IRType) (v : Expr) :
+    M (Option (StaticObjs × String)) := do
+  if !t.isObj then return none
+  let objName := baseName ++ "_" ++ toString x
+  let objRef  := "(lean_object*)&" ++ objName
+  match v with
+  | .lit (.str str) =>
+    let sz := str.utf8ByteSize + 1
+    let defn := "static const struct { lean_object m_header; size_t m_size; size_t m_capacity; size_t m_length; char m_data[" ++
+      toString sz ++ "]; } " ++ objName ++ " = { LEAN_STATIC_HEADER(1, LeanString, 0), " ++ toString sz ++ ", " ++
+      toString sz ++ ", " ++ toString str.length ++ ", " ++ quoteString str ++ " };"
+    return some ({ s with defs := s.defs.push defn }, objRef)
+  | .lit (.num n) =>
+    -- `LEAN_MAX_SMALL_NAT` on 32-bit platforms
+    if n < 2^31 then return some (s, "LEAN_STATIC_BOX(" ++ toString n ++ ")") else return none
+  | .ctor c ys =>
+    if c.usize != 0 || c.ssize != 0 then return none
+    if c.size == 0 then return some (s, "LEAN_STATIC_BOX(" ++ toString c.cidx ++ ")")
+    let some args := ys.mapM (staticArgToCString s) | return none
+    let defn := "static const struct { lean_object m_header; lean_object* m_objs[" ++ toString ys.size ++ "]; } " ++ objName ++
+      " = { LEAN_STATIC_HEADER(sizeof(lean_ctor_object) + sizeof(void*)*" ++ toString ys.size ++ ", " ++ toString c.cidx ++ ", " ++
+      toString ys.size ++ "), {" ++ ", ".intercalate args.toList ++ "} };"
+    return some ({ s with defs := s.defs.push defn }, objRef)
+  | .fap f ys =>
+    if ys.isEmpty then
+      return staticDecls.find? f |>.map (s, ·)
+    else
+      return none
+  | _ => return none
+
+/-- Return the static objects for the closed term body `b`, and the C initializer for its result. -/
+partial def toStaticObjs (staticDecls : NameMap String) (baseName : String) (s : StaticObjs) : FnBody → M (Option (StaticObjs × String))
+  | .vdecl x t v b => do
+    let some (s, val) ← toStaticVal staticDecls baseName s x t v | return none
+    toStaticObjs staticDecls baseName { s with vals := s.vals.push (x, val) } b
+  -- RC operations on persistent objects are no-ops
+  | .inc _ _ _ _ b | .dec _ _ _ _ b | .mdata _ b => toStaticObjs staticDecls baseName s b
+  | .ret x => return staticArgToCString s x |>.map (s, ·)
+  | _ => return none
+
+def isStaticClosedTermCandidate (d : Decl) : M Bool := do
+  let env ← getEnv
+  return d.params.isEmpty && d.resultType.isObj && isClosedTermName env d.name && !hasInitAttr env d.name
+
+/--
+Emit the closed terms that can be computed at compile time as static data, and return their C initializers.
+Recall that closed terms are defined before their uses. -/
+def emitStaticClosedTerms : M (NameMap String) := do
+  let env ← getEnv
+  let decls := getDecls env
+  decls.reverse.foldlM (init := {}) fun staticDecls d => do
+    let .fdecl (f := f) (body := b) .. := d | return staticDecls
+    unless (← isStaticClosedTermCandidate d) do return staticDecls
+    let baseName := "_static_" ++ (← toCName f)
+    let some (s, val) ← toStaticObjs staticDecls baseName {} b | return staticDecls
+    emitLns s.defs.toList
+    -- `emitFnDecls` skips the declaration of this variable.
+    if isSharedClosedTermName env f then emit "LEAN_EXPORT "
+    else if (← read).ownDecls?.isNone then emit "static "
+    emit "lean_object* "; emitCName f; emitLn (" = " ++ val ++ ";")
+    return staticDecls.insert f val
+
 def emitFns : M Unit := do
   let env ← getEnv;
   let decls := getDecls env;
-  decls.reverse.forM emitDecl
+  decls.reverse.forM fun d => do
+    if (← isOwnDecl d.name) then emitDecl d
 
 def emitMarkPersistent (d : Decl) (n : Name) : M Unit := do
   if d.resultType.isObj then
@@ -692,7 +789,9 @@ def emitMarkPersistent (d : Decl) (n : Name) : M Unit := do
 def emitDeclInit (d : Decl) : M Unit := do
   let env ← getEnv
   let n := d.name
-  if isIOUnitInitFn env n then
+  if (← read).staticClosedTerms.contains n then
+    pure () -- initialized at compile time
+  else if isIOUnitInitFn env n then
     if isIOUnitBuiltinInitFn env n then
       emit "if (builtin) {"
     emit "res = "; emitCName n; emitLn "(lean_io_mk_world());"
@@ -740,18 +839,88 @@ def emitInitFn : M Unit := do
 
 def main : M Unit := do
   emitFileHeader
-  emitFnDecls
-  emitFns
-  emitInitFn
+  let staticClosedTerms ← emitStaticClosedTerms
+  withReader (fun ctx => { ctx with staticClosedTerms }) do
+    emitFnDecls
+    emitFns
+    emitInitFn
   emitMainFnIfNeeded
   emitFileFooter
 
+/-! Splitting a module into several translation units. -/
+
+/-- Rough size of the C code generated for `b`. -/
+partial def codeSize : FnBody → Nat
+  | .case _ _ _ alts => alts.foldl (fun n alt => n + codeSize alt.body) 1
+  | .jdecl _ _ v b   => codeSize v + codeSize b + 1
+  | b                => if b.isTerminal then 1 else codeSize b.body + 1
+
+def declCodeSize : Decl → Nat
+  | .fdecl (body := b) .. => codeSize b
+  | .extern .. => 0
+
+/--
+Assign the declarations of the current module to `numParts` translation units of similar size.
+Constants (and their `static` `_init_` functions) stay in the first part next to the module initializer.
+Functions are distributed by strongly connected component of the call graph, so that mutually recursive
+functions end up in the same translation unit. -/
+def partitionDecls (env : Environment) (numParts : Nat) : Array NameSet := Id.run do
+  let decls := getDecls env
+  let fns := decls.filter (!·.params.isEmpty)
+  let fnMap : NameMap Decl := fns.foldl (fun m d => m.insert d.name d) {}
+  let successors (n : Name) : List Name :=
+    match fnMap.find? n with
+    | some d => (collectUsedDecls env d).toList.filter fnMap.contains
+    | none   => []
+  let mut parts : Array NameSet := mkArray numParts {}
+  let mut sizes : Array Nat := mkArray numParts 0
+  for d in decls do
+    if d.params.isEmpty then
+      parts := parts.modify 0 (·.insert d.name)
+      sizes := sizes.modify 0 (· + declCodeSize d)
+  let sccs := SCC.scc (fns.map (·.name)) successors |>.toArray.map fun c =>
+    (c, c.foldl (fun n f => n + ((fnMap.find? f).map declCodeSize).getD 0) 0)
+  -- Largest components first, each one into the smallest part so far.
+  for (c, w) in sccs.qsort (fun a b => a.2 > b.2) do
+    let mut i := 0
+    for j in [1:numParts] do
+      if sizes[j]! < sizes[i]! then i := j
+    parts := parts.modify i fun s => c.foldl NameSet.insert s
+    sizes := sizes.modify i (· + w)
+  return parts
+
+/-- Emit a translation unit of a split module. Only the first one contains the module initializer. -/
+def emitPart (isFirst : Bool) : M Unit := do
+  if isFirst then
+    main
+  else
+    emitFileHeader
+    emitFnDecls
+    emitFns
+    emitFileFooter
+
 end EmitC
 
+/-- Initial size of the output buffer. Generated files are typically larger, and the buffer grows geometrically. -/
+private def initialCapacity : Nat := 64 * 1024
+
 @[export lean_ir_emit_c]
 def emitC (env : Environment) (modName : Name) : Except String String :=
-  match (EmitC.main { env := env, modName := modName }).run "" with
-  | EStateM.Result.ok    _   s => Except.ok s
+  match (EmitC.main { env := env, modName := modName }).run (.mkEmpty initialCapacity) with
+  | EStateM.Result.ok    _   s => Except.ok s.toString
   | EStateM.Result.error err _ => Except.error err
 
+/--
+Similar to `emitC`, but split the module into at most `numParts` translation units that can be compiled in
+parallel and must be linked together. The first one contains the module initializer. -/
+@[export lean_ir_emit_c_parts]
+def emitCParts (env : Environment) (modName : Name) (numParts : Nat) : Except String (Array String) := do
+  let parts := EmitC.partitionDecls env (max numParts 1)
+  -- The parts are independent, so we also emit them in parallel.
+  let tasks := parts.mapIdx fun i ownDecls => Task.spawn fun _ =>
+    match (EmitC.emitPart (i.val == 0) { env, modName, ownDecls? := some ownDecls }).run (.mkEmpty initialCapacity) with
+    | EStateM.Result.ok    _   s => Except.ok s.toString
+    | EStateM.Result.error err _ => Except.error err
+  tasks.mapM (·.get)
+
 end Lean.IR
@@ -495,7 +495,7 @@ def emitFnDeclAux (mod : LLVM.Module llvmctx)
         LLVM.getOrAddFunction mod cppBaseName fnty
   -- we must now set symbol visibility for global.
   if ps.isEmpty then
-    if isClosedTermName env decl.name then LLVM.setVisibility global LLVM.Visibility.hidden -- static
+    if isClosedTermName env decl.name && !isSharedClosedTermName env decl.name then LLVM.setVisibility global LLVM.Visibility.hidden -- static
     else if isExternal then pure () -- extern (Recall that C/LLVM funcs are extern linkage by default.)
     else LLVM.setDLLStorageClass global LLVM.DLLStorageClass.export  -- LEAN_EXPORT
   else if !isExternal
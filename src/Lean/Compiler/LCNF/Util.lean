@@ -5,6 +5,7 @@ Authors: Leonardo de Moura
 -/
 prelude
 import Init.Data.FloatArray.Basic
+import Init.Data.BitArray.Basic
 import Lean.CoreM
 import Lean.MonadEnv
 import Lean.Util.Recognizers
@@ -82,7 +83,7 @@ def builtinRuntimeTypes : List Name := [
   ``UInt8, ``UInt16, ``UInt32, ``UInt64, ``USize,
   ``Float,
   ``Thunk, ``Task,
-  ``Array, ``ByteArray, ``FloatArray,
+  ``Array, ``ByteArray, ``FloatArray, ``BitArray,
   ``Nat, ``Int
 ]
 
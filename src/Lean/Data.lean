@@ -30,3 +30,4 @@ import Lean.Data.NameTrie
 import Lean.Data.RBTree
 import Lean.Data.RBMap
 import Lean.Data.Rat
+import Lean.Data.Rope
@@ -0,0 +1,24 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+Authors: agent
+-/
+prelude
+import Lean.Data.Json.Basic
+
+namespace Lean.Json
+
+/--
+Encodes `j` in a compact binary format, which is cheaper to produce and to decode than JSON text. Numbers
+and the lengths of strings, arrays and objects are stored as variable-length integers, and strings are
+stored without escaping. The format is specific to this version of Lean and only meant for communication
+between Lean processes, such as between the language server and its file workers.
+-/
+@[extern "lean_json_to_binary"]
+opaque toBinary (j : @& Json) : ByteArray
+
+/-- Decodes a value encoded by `Json.toBinary`, failing on malformed input. -/
+@[extern "lean_json_of_binary"]
+opaque ofBinary (bytes : @& ByteArray) : Except String Json
+
+end Lean.Json
@@ -251,7 +251,13 @@ end Json.Parser
 
 namespace Json
 
-def parse (s : String) : Except String Lean.Json :=
+/--
+Parses a JSON value, accepting the same inputs and reporting the same errors as `Json.Parser.any`.
+Implemented natively; strings are scanned several bytes at a time, and the nesting depth is not limited
+by the stack size.
+-/
+@[extern "lean_json_parse"]
+def parse (s : @& String) : Except String Lean.Json :=
   Parser.run Json.Parser.any s
 
 end Json
@@ -39,7 +39,12 @@ private def escapeAux (acc : String) (c : Char) : String :=
     let d4 := Nat.digitChar (n % 16)
     acc ++ "\\u" |>.push d1 |>.push d2 |>.push d3 |>.push d4
 
-def escape (s : String) (acc : String := "") : String :=
+/--
+Appends the JSON escaping of `s` to `acc`. Implemented natively, scanning for the characters that need
+escaping several bytes at a time.
+-/
+@[extern "lean_json_escape"]
+def escape (s : @& String) (acc : String := "") : String :=
   s.foldl escapeAux acc
 
 def renderString (s : String) (acc : String := "") : String :=
@@ -77,26 +82,32 @@ protected inductive CompressWorkItem
   | comma
 
 open Json.CompressWorkItem in
-partial def compress (j : Json) : String :=
-  go "" [json j]
-where go (acc : String) : List Json.CompressWorkItem → String
+private partial def compressAux (acc : String) : List Json.CompressWorkItem → String
   | []               => acc
   | json j :: is =>
     match j with
-    | null       => go (acc ++ "null") is
-    | bool true  => go (acc ++ "true") is
-    | bool false => go (acc ++ "false") is
-    | num s      => go (acc ++ s.toString) is
-    | str s      => go (renderString s acc) is
-    | arr elems  => go (acc ++ "[") ((elems.map arrayElem).toListAppend (arrayEnd :: is))
-    | obj kvs    => go (acc ++ "{") (kvs.fold (init := []) (fun acc k j => objectField k j :: acc) ++ [objectEnd] ++ is)
-  | arrayElem j :: arrayEnd :: is      => go acc (json j :: arrayEnd :: is)
-  | arrayElem j :: is                  => go acc (json j :: comma :: is)
-  | arrayEnd :: is                     => go (acc ++ "]") is
-  | objectField k j :: objectEnd :: is => go (renderString k acc ++ ":") (json j :: objectEnd :: is)
-  | objectField k j :: is              => go (renderString k acc ++ ":") (json j :: comma :: is)
-  | objectEnd :: is                    => go (acc ++ "}") is
-  | comma :: is                        => go (acc ++ ",") is
+    | null       => compressAux (acc ++ "null") is
+    | bool true  => compressAux (acc ++ "true") is
+    | bool false => compressAux (acc ++ "false") is
+    | num s      => compressAux (acc ++ s.toString) is
+    | str s      => compressAux (renderString s acc) is
+    | arr elems  => compressAux (acc ++ "[") ((elems.map arrayElem).toListAppend (arrayEnd :: is))
+    | obj kvs    => compressAux (acc ++ "{") (kvs.fold (init := []) (fun acc k j => objectField k j :: acc) ++ [objectEnd] ++ is)
+  | arrayElem j :: arrayEnd :: is      => compressAux acc (json j :: arrayEnd :: is)
+  | arrayElem j :: is                  => compressAux acc (json j :: comma :: is)
+  | arrayEnd :: is                     => compressAux (acc ++ "]") is
+  | objectField k j :: objectEnd :: is => compressAux (renderString k acc ++ ":") (json j :: objectEnd :: is)
+  | objectField k j :: is              => compressAux (renderString k acc ++ ":") (json j :: comma :: is)
+  | objectEnd :: is                    => compressAux (acc ++ "}") is
+  | comma :: is                        => compressAux (acc ++ ",") is
+
+/--
+Renders `j` without any whitespace, printing the fields of objects in descending order of their keys.
+Implemented natively; the nesting depth of `j` is not limited by the stack size.
+-/
+@[extern "lean_json_compress"]
+def compress (j : @& Json) : String :=
+  compressAux "" [json j]
 
 instance : ToFormat Json := ⟨render⟩
 instance : ToString Json := ⟨pretty⟩
@@ -8,6 +8,7 @@ prelude
 import Init.System.IO
 import Lean.Data.Json.Parser
 import Lean.Data.Json.Printer
+import Lean.Data.Json.Binary
 import Lean.Data.Json.FromToJson
 
 namespace IO.FS.Stream
@@ -21,6 +22,11 @@ def readJson (h : FS.Stream) (nBytes : Nat) : IO Json := do
   let some s := String.fromUTF8? bytes | throw (IO.userError "invalid UTF-8")
   ofExcept (Json.parse s)
 
+/-- Consumes `nBytes` bytes from the stream and decodes them as a value encoded by `Json.toBinary`. -/
+def readBinaryJson (h : FS.Stream) (nBytes : Nat) : IO Json := do
+  let bytes ← h.read (USize.ofNat nBytes)
+  ofExcept (Json.ofBinary bytes)
+
 def writeJson (h : FS.Stream) (j : Json) : IO Unit := do
   h.putStr j.compress
   h.flush
@@ -276,14 +276,18 @@ open Lean
 open Lean.JsonRpc
 
 section
-  def readMessage (h : FS.Stream) (nBytes : Nat) : IO Message := do
-    let j ← h.readJson nBytes
+  /--
+  Reads a message of `nBytes` bytes, which is JSON text, or encoded by `Json.toBinary` if `binary` is set.
+  -/
+  def readMessage (h : FS.Stream) (nBytes : Nat) (binary := false) : IO Message := do
+    let j ← if binary then h.readBinaryJson nBytes else h.readJson nBytes
     match fromJson? j with
     | Except.ok m => pure m
     | Except.error inner => throw $ userError s!"JSON '{j.compress}' did not have the format of a JSON-RPC message.\n{inner}"
 
-  def readRequestAs (h : FS.Stream) (nBytes : Nat) (expectedMethod : String) (α) [FromJson α] : IO (Request α) := do
-    let m ← h.readMessage nBytes
+  def readRequestAs (h : FS.Stream) (nBytes : Nat) (expectedMethod : String) (α) [FromJson α] (binary := false) :
+      IO (Request α) := do
+    let m ← h.readMessage nBytes binary
     match m with
     | Message.request id method params? =>
       if method = expectedMethod then
@@ -295,8 +299,9 @@ section
         throw $ userError s!"Expected method '{expectedMethod}', got method '{method}'"
     | _ => throw $ userError s!"Expected JSON-RPC request, got: '{(toJson m).compress}'"
 
-  def readNotificationAs (h : FS.Stream) (nBytes : Nat) (expectedMethod : String) (α) [FromJson α] : IO (Notification α) := do
-    let m ← h.readMessage nBytes
+  def readNotificationAs (h : FS.Stream) (nBytes : Nat) (expectedMethod : String) (α) [FromJson α] (binary := false) :
+      IO (Notification α) := do
+    let m ← h.readMessage nBytes binary
     match m with
     | Message.notification method params? =>
       if method = expectedMethod then
@@ -308,8 +313,9 @@ section
         throw $ userError s!"Expected method '{expectedMethod}', got method '{method}'"
     | _ => throw $ userError s!"Expected JSON-RPC notification, got: '{(toJson m).compress}'"
 
-  def readResponseAs (h : FS.Stream) (nBytes : Nat) (expectedID : RequestID) (α) [FromJson α] : IO (Response α) := do
-    let m ← h.readMessage nBytes
+  def readResponseAs (h : FS.Stream) (nBytes : Nat) (expectedID : RequestID) (α) [FromJson α] (binary := false) :
+      IO (Response α) := do
+    let m ← h.readMessage nBytes binary
     match m with
     | Message.response id result =>
       if id == expectedID then
@@ -15,6 +15,13 @@ namespace IO.FS.Stream
 open Lean
 open Lean.JsonRpc
 
+/--
+The `Content-Type` of messages encoded by `Json.toBinary` instead of as JSON text. The language server
+can use this encoding between the watchdog and its file workers; messages with the default content type
+are JSON text.
+-/
+def lspBinaryContentType : String := "application/vnd.lean.json-binary"
+
 section
   private def parseHeaderField (s : String) : Option (String × String) := do
     guard $ s ≠ "" ∧ s.takeRight 2 = "\r\n"
@@ -55,40 +62,41 @@ section
         else
           throw $ userError s!"Invalid header field: {repr l}"
 
-  /-- Returns the Content-Length. -/
-  private def readLspHeader (h : FS.Stream) : IO Nat := do
+  /-- Returns the Content-Length, and whether the Content-Type is `lspBinaryContentType`. -/
+  private def readLspHeader (h : FS.Stream) : IO (Nat × Bool) := do
     let fields ← readHeaderFields h
+    let binary := fields.lookup "Content-Type" == some lspBinaryContentType
     match fields.lookup "Content-Length" with
     | some length => match length.toNat? with
-      | some n => pure n
+      | some n => pure (n, binary)
       | none   => throw $ userError s!"Content-Length header field value '{length}' is not a Nat"
     | none => throw $ userError s!"No Content-Length field in header: {fields}"
 
   def readLspMessage (h : FS.Stream) : IO Message := do
     try
-      let nBytes ← readLspHeader h
-      h.readMessage nBytes
+      let (nBytes, binary) ← readLspHeader h
+      h.readMessage nBytes binary
     catch e =>
       throw $ userError s!"Cannot read LSP message: {e}"
 
   def readLspRequestAs (h : FS.Stream) (expectedMethod : String) (α) [FromJson α] : IO (Request α) := do
     try
-      let nBytes ← readLspHeader h
-      h.readRequestAs nBytes expectedMethod α
+      let (nBytes, binary) ← readLspHeader h
+      h.readRequestAs nBytes expectedMethod α binary
     catch e =>
       throw $ userError s!"Cannot read LSP request: {e}"
 
   def readLspNotificationAs (h : FS.Stream) (expectedMethod : String) (α) [FromJson α] : IO (Notification α) := do
     try
-      let nBytes ← readLspHeader h
-      h.readNotificationAs nBytes expectedMethod α
+      let (nBytes, binary) ← readLspHeader h
+      h.readNotificationAs nBytes expectedMethod α binary
     catch e =>
       throw $ userError s!"Cannot read LSP notification: {e}"
 
   def readLspResponseAs (h : FS.Stream) (expectedID : RequestID) (α) [FromJson α] : IO (Response α) := do
     try
-      let nBytes ← readLspHeader h
-      h.readResponseAs nBytes expectedID α
+      let (nBytes, binary) ← readLspHeader h
+      h.readResponseAs nBytes expectedID α binary
     catch e =>
       throw $ userError s!"Cannot read LSP response: {e}"
 end
@@ -96,22 +104,31 @@ end
 section
   variable [ToJson α]
 
-  def writeLspMessage (h : FS.Stream) (msg : Message) : IO Unit := do
+  /--
+  Writes `msg` as JSON text, or encoded by `Json.toBinary` if `binary` is set. Only Lean processes can read
+  the latter, so it must not be used for messages to the client.
+  -/
+  def writeLspMessage (h : FS.Stream) (msg : Message) (binary := false) : IO Unit := do
     -- inlined implementation instead of using jsonrpc's writeMessage
     -- to maintain the atomicity of putStr
-    let j := (toJson msg).compress
-    let header := s!"Content-Length: {toString j.utf8ByteSize}\r\n\r\n"
-    h.putStr (header ++ j)
+    if binary then
+      let bytes := (toJson msg).toBinary
+      let header := s!"Content-Length: {bytes.size}\r\nContent-Type: {lspBinaryContentType}\r\n\r\n"
+      h.write (header.toUTF8 ++ bytes)
+    else
+      let j := (toJson msg).compress
+      let header := s!"Content-Length: {toString j.utf8ByteSize}\r\n\r\n"
+      h.putStr (header ++ j)
     h.flush
 
-  def writeLspRequest (h : FS.Stream) (r : Request α) : IO Unit :=
-    h.writeLspMessage r
+  def writeLspRequest (h : FS.Stream) (r : Request α) (binary := false) : IO Unit :=
+    h.writeLspMessage r binary
 
-  def writeLspNotification (h : FS.Stream) (n : Notification α) : IO Unit :=
-    h.writeLspMessage n
+  def writeLspNotification (h : FS.Stream) (n : Notification α) (binary := false) : IO Unit :=
+    h.writeLspMessage n binary
 
-  def writeLspResponse (h : FS.Stream) (r : Response α) : IO Unit :=
-    h.writeLspMessage r
+  def writeLspResponse (h : FS.Stream) (r : Response α) (binary := false) : IO Unit :=
+    h.writeLspMessage r binary
 
   def writeLspResponseError (h : FS.Stream) (e : ResponseError Unit) : IO Unit :=
     h.writeLspMessage (Message.responseError e.id e.code e.message none)
@@ -76,12 +76,22 @@ private def lineStartPos (text : FileMap) (line : Nat) : String.Pos :=
 from an LSP-style 0-indexed (ln, col) position. -/
 def lspPosToUtf8Pos (text : FileMap) (pos : Lsp.Position) : String.Pos :=
   let lineStartPos := lineStartPos text pos.line
-  let chr := text.source.utf16PosToCodepointPosFrom pos.character lineStartPos
-  text.source.codepointPosToUtf8PosFrom lineStartPos chr
+  if pos.character ≤ longLineThreshold then
+    let chr := text.source.utf16PosToCodepointPosFrom pos.character lineStartPos
+    text.source.codepointPosToUtf8PosFrom lineStartPos chr
+  else
+    let idx := text.charIndex.get
+    idx.posOfUtf16 text.source ((idx.offsetsOf text.source lineStartPos).2 + pos.character)
 
 def leanPosToLspPos (text : FileMap) : Lean.Position → Lsp.Position
   | ⟨line, col⟩ =>
-    ⟨line - 1, text.source.codepointPosToUtf16PosFrom col (lineStartPos text (line - 1))⟩
+    let lineStartPos := lineStartPos text (line - 1)
+    if col ≤ longLineThreshold then
+      ⟨line - 1, text.source.codepointPosToUtf16PosFrom col lineStartPos⟩
+    else
+      let idx := text.charIndex.get
+      let (cp, utf16) := idx.offsetsOf text.source lineStartPos
+      ⟨line - 1, (idx.posOfCodepoint text.source (cp + col)).2 - utf16⟩
 
 def utf8PosToLspPos (text : FileMap) (pos : String.Pos) : Lsp.Position :=
   text.leanPosToLspPos (text.toPosition pos)
@@ -31,6 +31,95 @@ instance : ToExpr Position where
 
 end Position
 
+/--
+Sparse index of a string that maps every `CharIndex.step`-th codepoint to its UTF-8 and UTF-16 offsets.
+Converting positions within a long line of a `FileMap` starts from the closest entry instead of the start
+of the line.
+-/
+structure CharIndex where
+  /-- `utf8[i]` is the UTF-8 offset of the codepoint `i * step`. -/
+  utf8  : Array String.Pos := #[]
+  /-- `utf16[i]` is the UTF-16 offset of the codepoint `i * step`. -/
+  utf16 : Array Nat := #[]
+  deriving Inhabited
+
+namespace CharIndex
+
+def step : Nat := 64
+
+/-- Number of UTF-16 code units needed to encode `c`. -/
+@[inline] def utf16Size (c : Char) : Nat :=
+  if c.val ≤ 0xFFFF then 1 else 2
+
+partial def ofString (s : String) : CharIndex :=
+  go 0 0 0 {}
+where
+  go (p : String.Pos) (cp utf16 : Nat) (idx : CharIndex) : CharIndex :=
+    let idx := if cp % step == 0 then { utf8 := idx.utf8.push p, utf16 := idx.utf16.push utf16 } else idx
+    if s.atEnd p then idx
+    else go (s.next p) (cp + 1) (utf16 + utf16Size (s.get p)) idx
+
+/-- Largest `i < n` such that `f i ≤ x`, assuming that `f` is monotone and `f 0 ≤ x`. -/
+@[specialize] private partial def findLE (n : Nat) (f : Nat → Nat) (x : Nat) : Nat :=
+  let rec go (lo hi : Nat) : Nat :=
+    if lo + 1 < hi then
+      let mid := (lo + hi) / 2
+      if f mid ≤ x then go mid hi else go lo mid
+    else
+      lo
+  go 0 n
+
+/--
+Returns `(p, cp, utf16)` where `p ≤ pos` is the UTF-8 offset of an indexed codepoint,
+`cp` is its codepoint offset, and `utf16` its UTF-16 offset. -/
+def entryBefore (idx : CharIndex) (pos : String.Pos) : String.Pos × Nat × Nat :=
+  if idx.utf8.isEmpty then (0, 0, 0) else
+  let i := findLE idx.utf8.size (idx.utf8[·]!.byteIdx) pos.byteIdx
+  (idx.utf8[i]!, i * step, idx.utf16[i]!)
+
+/-- Similar to `entryBefore`, but for the UTF-16 offset `utf16`. -/
+def entryBeforeUtf16 (idx : CharIndex) (utf16 : Nat) : String.Pos × Nat × Nat :=
+  if idx.utf16.isEmpty then (0, 0, 0) else
+  let i := findLE idx.utf16.size (idx.utf16[·]!) utf16
+  (idx.utf8[i]!, i * step, idx.utf16[i]!)
+
+/-- Returns the codepoint and UTF-16 offsets of the UTF-8 offset `pos` in `s`, which must be a codepoint boundary. -/
+partial def offsetsOf (idx : CharIndex) (s : String) (pos : String.Pos) : Nat × Nat :=
+  let (p, cp, utf16) := idx.entryBefore pos
+  go p cp utf16
+where
+  go (p : String.Pos) (cp utf16 : Nat) : Nat × Nat :=
+    if p < pos && !s.atEnd p then
+      go (s.next p) (cp + 1) (utf16 + utf16Size (s.get p))
+    else
+      (cp, utf16)
+
+/--
+Returns the UTF-8 and UTF-16 offsets of the codepoint `cp` of `s`. Like `String.next`, codepoints past the end of `s`
+count as one byte. -/
+partial def posOfCodepoint (idx : CharIndex) (s : String) (cp : Nat) : String.Pos × Nat :=
+  let i := min (cp / step) (idx.utf8.size - 1)
+  go idx.utf8[i]! (cp - i * step) idx.utf16[i]!
+where
+  go (p : String.Pos) (n utf16 : Nat) : String.Pos × Nat :=
+    if n == 0 then (p, utf16)
+    else if s.atEnd p then (⟨p.byteIdx + n⟩, utf16 + n)
+    else go (s.next p) (n - 1) (utf16 + utf16Size (s.get p))
+
+/-- Returns the UTF-8 offset of the codepoint at UTF-16 offset `utf16` of `s`. -/
+partial def posOfUtf16 (idx : CharIndex) (s : String) (utf16 : Nat) : String.Pos :=
+  let (p, _, u) := idx.entryBeforeUtf16 utf16
+  go p u
+where
+  go (p : String.Pos) (u : Nat) : String.Pos :=
+    if u ≥ utf16 then p
+    else if s.atEnd p then ⟨p.byteIdx + (utf16 - u)⟩
+    else go (s.next p) (u + utf16Size (s.get p))
+
+end CharIndex
+
+instance : Inhabited (Thunk CharIndex) := ⟨.pure default⟩
+
 /-- Content of a file together with precalculated positions of newlines. -/
 structure FileMap where
   /-- The content of the file. -/
@@ -39,6 +128,8 @@ structure FileMap where
   The first entry is always `0` and the last always the index of the last character.
   In particular, if the last character is a newline, that index will appear twice. -/
   positions : Array String.Pos
+  /-- Index for converting positions in long lines, built on first use. -/
+  charIndex : Thunk CharIndex := .mk fun _ => CharIndex.ofString source
   deriving Inhabited
 
 class MonadFileMap (m : Type → Type) where
@@ -68,30 +159,39 @@ partial def ofString (s : String) : FileMap :=
       else loop i line ps
   loop 0 1 (#[0])
 
+/-- Lines longer than this many bytes use `FileMap.charIndex` to convert positions. -/
+def longLineThreshold : Nat := 1024
+
 partial def toPosition (fmap : FileMap) (pos : String.Pos) : Position :=
-  match fmap with
-  | { source := str, positions := ps } =>
-    if ps.size >= 2 && pos <= ps.back then
-      let rec toColumn (i : String.Pos) (c : Nat) : Nat :=
-        if i == pos || str.atEnd i then c
-        else toColumn (str.next i) (c+1)
-      let rec loop (b e : Nat) :=
-        let posB := ps[b]!
-        if e == b + 1 then { line := fmap.getLine b, column := toColumn posB 0 }
-        else
-          let m := (b + e) / 2;
-          let posM := ps.get! m;
-          if pos == posM then { line := fmap.getLine m, column := 0 }
-          else if pos > posM then loop m e
-          else loop b m
-      loop 0 (ps.size -1)
-    else if ps.isEmpty then
-      ⟨0, 0⟩
-    else
-      -- Some systems like the delaborator use synthetic positions without an input file,
-      -- which would violate `toPositionAux`'s invariant.
-      -- Can also happen with EOF errors, which are not strictly inside the file.
-      ⟨fmap.getLastLine, (pos - ps.back).byteIdx⟩
+  let str := fmap.source
+  let ps  := fmap.positions
+  if ps.size >= 2 && pos <= ps.back then
+    let rec toColumn (i : String.Pos) (c : Nat) : Nat :=
+      if i == pos || str.atEnd i then c
+      else toColumn (str.next i) (c+1)
+    let column (lineStart : String.Pos) : Nat :=
+      if pos.byteIdx - lineStart.byteIdx ≤ longLineThreshold then
+        toColumn lineStart 0
+      else
+        let idx := fmap.charIndex.get
+        (idx.offsetsOf str pos).1 - (idx.offsetsOf str lineStart).1
+    let rec loop (b e : Nat) :=
+      let posB := ps[b]!
+      if e == b + 1 then { line := fmap.getLine b, column := column posB }
+      else
+        let m := (b + e) / 2;
+        let posM := ps.get! m;
+        if pos == posM then { line := fmap.getLine m, column := 0 }
+        else if pos > posM then loop m e
+        else loop b m
+    loop 0 (ps.size -1)
+  else if ps.isEmpty then
+    ⟨0, 0⟩
+  else
+    -- Some systems like the delaborator use synthetic positions without an input file,
+    -- which would violate `toPositionAux`'s invariant.
+    -- Can also happen with EOF errors, which are not strictly inside the file.
+    ⟨fmap.getLastLine, (pos - ps.back).byteIdx⟩
 
 /-- Convert a `Lean.Position` to a `String.Pos`. -/
 def ofPosition (text : FileMap) (pos : Position) : String.Pos :=
@@ -102,7 +202,11 @@ def ofPosition (text : FileMap) (pos : Position) : String.Pos :=
       0
     else
       text.positions.back
-  String.Iterator.nextn ⟨text.source, colPos⟩ pos.column |>.pos
+  if pos.column ≤ longLineThreshold then
+    String.Iterator.nextn ⟨text.source, colPos⟩ pos.column |>.pos
+  else
+    let idx := text.charIndex.get
+    (idx.posOfCodepoint text.source ((idx.offsetsOf text.source colPos).1 + pos.column)).1
 
 /--
 Returns the position of the start of (1-based) line `line`.
@@ -0,0 +1,215 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+Authors: agent
+-/
+prelude
+import Init.Data.String.Basic
+import Init.Data.Array.Basic
+
+universe u
+
+namespace Lean
+
+/--
+A rope is a string represented as a height-balanced binary tree of flat `String` chunks.
+Appending, slicing and indexing by codepoint are `O(log n)`, while `String` copies on `++` when the
+left operand is shared, and `String.extract` is linear. Small strings are stored in a single leaf, so
+they cost the same as a `String`. Use `toString` to flatten the rope once editing is done.
+
+The constructors are private so that leaves are only built by the functions below, which keep them at
+about `leafSize` bytes; the bounds above do not hold for arbitrarily large leaves.
+-/
+inductive Rope where
+  | private leaf (s : String)
+  | private node (l r : Rope) (height : Nat) (length : Nat) (utf8ByteSize : Nat) (newlines : Nat)
+  deriving Inhabited
+
+namespace Rope
+
+/-- Leaves are merged when their combined size is at most `leafSize` bytes. -/
+def leafSize : Nat := 512
+
+def empty : Rope := leaf ""
+
+instance : EmptyCollection Rope := ⟨empty⟩
+
+def height : Rope → Nat
+  | leaf _ => 0
+  | node _ _ h _ _ _ => h
+
+/-- Number of unicode scalar values. -/
+def length : Rope → Nat
+  | leaf s => s.length
+  | node _ _ _ n _ _ => n
+
+def utf8ByteSize : Rope → Nat
+  | leaf s => s.utf8ByteSize
+  | node _ _ _ _ sz _ => sz
+
+/-- Number of `'\n'` characters. -/
+def newlines : Rope → Nat
+  | leaf s => s.foldl (fun n c => if c == '\n' then n + 1 else n) 0
+  | node _ _ _ _ _ n => n
+
+def isEmpty (t : Rope) : Bool :=
+  t.utf8ByteSize == 0
+
+private def mkNode (l r : Rope) : Rope :=
+  node l r (max l.height r.height + 1) (l.length + r.length) (l.utf8ByteSize + r.utf8ByteSize)
+    (l.newlines + r.newlines)
+
+/-- Rebalance `mkNode l r`, assuming the heights of `l` and `r` differ by at most 2. -/
+private def balance (l r : Rope) : Rope :=
+  if l.height > r.height + 1 then
+    match l with
+    | node ll lr .. =>
+      if ll.height ≥ lr.height then
+        mkNode ll (mkNode lr r)
+      else match lr with
+        | node lrl lrr .. => mkNode (mkNode ll lrl) (mkNode lrr r)
+        | leaf _          => mkNode l r
+    | leaf _ => mkNode l r
+  else if r.height > l.height + 1 then
+    match r with
+    | node rl rr .. =>
+      if rr.height ≥ rl.height then
+        mkNode (mkNode l rl) rr
+      else match rl with
+        | node rll rlr .. => mkNode (mkNode l rll) (mkNode rlr rr)
+        | leaf _          => mkNode l r
+    | leaf _ => mkNode l r
+  else
+    mkNode l r
+
+private def isSmallLeaf : Rope → Bool
+  | leaf s => s.utf8ByteSize < leafSize
+  | node .. => false
+
+/--
+Concatenate two ropes. This is `O(|height l - height r|)`. Small leaves at the seam are merged so that
+repeatedly appending short strings does not produce a tree of tiny leaves.
+-/
+partial def append (l r : Rope) : Rope :=
+  if l.isEmpty then r
+  else if r.isEmpty then l
+  else match l, r with
+    | leaf a, leaf b =>
+      if a.utf8ByteSize + b.utf8ByteSize ≤ leafSize then leaf (a ++ b) else mkNode l r
+    | node ll lr .., _ =>
+      if l.height > r.height + 1 || isSmallLeaf r then balance ll (append lr r)
+      else if r.height > l.height + 1 then appendRight l r
+      else mkNode l r
+    | leaf _, node .. =>
+      if r.height > 1 || isSmallLeaf l then appendRight l r else mkNode l r
+where
+  appendRight (l r : Rope) : Rope :=
+    match r with
+    | node rl rr .. => balance (append l rl) rr
+    | leaf _        => mkNode l r
+
+instance : Append Rope := ⟨append⟩
+
+/-- Build a balanced rope from the nonempty leaves `ls[lo:hi]`. -/
+private partial def ofLeaves (ls : Array String) (lo hi : Nat) : Rope :=
+  if hi ≤ lo then empty
+  else if hi == lo + 1 then leaf ls[lo]!
+  else
+    let mid := (lo + hi) / 2
+    mkNode (ofLeaves ls lo mid) (ofLeaves ls mid hi)
+
+/-- Convert a string into a rope, splitting it into chunks of about `leafSize` bytes. -/
+partial def ofString (s : String) : Rope :=
+  if s.utf8ByteSize ≤ leafSize then
+    leaf s
+  else
+    let ls := go 0 0 #[]
+    ofLeaves ls 0 ls.size
+where
+  go (start p : String.Pos) (ls : Array String) : Array String :=
+    if s.atEnd p then
+      if p == start then ls else ls.push (s.extract start p)
+    else if p.byteIdx - start.byteIdx ≥ leafSize then
+      go p p (ls.push (s.extract start p))
+    else
+      go start (s.next p) ls
+
+instance : Coe String Rope := ⟨ofString⟩
+
+/-- Append a string to a rope. -/
+def appendString (t : Rope) (s : String) : Rope :=
+  t ++ ofString s
+
+def push (t : Rope) (c : Char) : Rope :=
+  t ++ leaf (String.singleton c)
+
+/-- Byte position of the `i`-th codepoint of `s`. -/
+private def charIdxToPos (s : String) (i : Nat) : String.Pos :=
+  (s.toSubstring.take i).stopPos
+
+/-- Return the `i`-th codepoint, or `default` if `i ≥ t.length`. -/
+def get (t : Rope) (i : Nat) : Char :=
+  match t with
+  | leaf s => s.get (charIdxToPos s i)
+  | node l r .. => if i < l.length then get l i else get r (i - l.length)
+
+/--
+Return the codepoint index at which line `line` (counting from 0) starts, i.e. the index after the
+`line`-th `'\n'`, or `t.length` if there are fewer lines. This is `O(log n)`.
+-/
+def lineStart (t : Rope) (line : Nat) : Nat :=
+  if line == 0 then 0
+  else match t with
+    | leaf s =>
+      let (idx, _, found?) := s.foldl (init := (0, 0, none)) fun (idx, n, found?) c =>
+        if found?.isSome then (idx, n, found?)
+        else if c == '\n' then (idx + 1, n + 1, if n + 1 == line then some (idx + 1) else none)
+        else (idx + 1, n, none)
+      found?.getD idx
+    | node l r .. =>
+      if line ≤ l.newlines then lineStart l line else l.length + lineStart r (line - l.newlines)
+
+/-- Split `t` into the first `i` codepoints and the rest. This is `O(log n)`. -/
+def splitAt (t : Rope) (i : Nat) : Rope × Rope :=
+  match t with
+  | leaf s =>
+    let p := charIdxToPos s i
+    (leaf (s.extract 0 p), leaf (s.extract p s.endPos))
+  | node l r .. =>
+    if i ≤ l.length then
+      let (a, b) := splitAt l i
+      (a, b ++ r)
+    else
+      let (a, b) := splitAt r (i - l.length)
+      (l ++ a, b)
+
+/-- The codepoints of `t` in the range `[start, stop)`. -/
+def extract (t : Rope) (start stop : Nat) : Rope :=
+  if stop ≤ start then empty else (t.splitAt stop).1.splitAt start |>.2
+
+/-- Replace the codepoints in the range `[start, stop)` by `s`. -/
+def replace (t : Rope) (start stop : Nat) (s : Rope) : Rope :=
+  let (pre, rest) := t.splitAt start
+  pre ++ s ++ (rest.splitAt (stop - start)).2
+
+/-- Replace the `i`-th codepoint by `c`. -/
+def set (t : Rope) (i : Nat) (c : Char) : Rope :=
+  t.replace i (i + 1) (leaf (String.singleton c))
+
+@[specialize] def foldlLeaves {α : Type u} (f : α → String → α) (init : α) : Rope → α
+  | leaf s => f init s
+  | node l r .. => foldlLeaves f (foldlLeaves f init l) r
+
+/-- Flatten the rope. This is linear in the size of the rope. -/
+def toString (t : Rope) : String :=
+  match t with
+  | leaf s => s
+  | _ => t.foldlLeaves (· ++ ·) ""
+
+instance : ToString Rope := ⟨toString⟩
+
+instance : BEq Rope := ⟨fun a b => a.length == b.length && a.toString == b.toString⟩
+
+end Rope
+
+end Lean
@@ -175,8 +175,7 @@ This option can only be set on the command line, not in the lakefile or via `set
       sure to empty diagnostics as well eventually) -/
   private partial def reportSnapshots (ctx : WorkerContext) (doc : EditableDocumentCore)
       (cancelTk : CancelToken) : BaseIO (Task Unit) := do
-    let t ← BaseIO.asTask do
-      IO.sleep (server.reportDelayMs.get ctx.cmdlineOpts).toUInt32
+    let t ← IO.sleepAsync (server.reportDelayMs.get ctx.cmdlineOpts).toUInt32
     BaseIO.bindTask t fun _ => do
       BaseIO.bindTask (← go (toSnapshotTree doc.initSnap) {}) fun st => do
         if (← cancelTk.isSet) then
@@ -375,6 +374,7 @@ section Initialization
         elaboration tasks here. -/
     mkLspOutputChannel maxDocVersion chanIsProcessing : IO (IO.Channel JsonRpc.Message) := do
       let chanOut ← IO.Channel.new
+      let binary ← useBinaryWorkerIpc
       let _ ← chanOut.forAsync (prio := .dedicated) fun msg => do
         -- discard outdated notifications; note that in contrast to responses, notifications can
         -- always be silently discarded
@@ -391,7 +391,7 @@ section Initialization
             return
           -- note that because of `server.reportDelayMs`, we cannot simply set `maxDocVersion` here
           -- as that would allow outdated messages to be reported until the delay is over
-        o.writeLspMessage msg |>.catchExceptions (fun _ => pure ())
+        o.writeLspMessage msg binary |>.catchExceptions (fun _ => pure ())
         if let .notification "$/lean/fileProgress" (some params) := msg then
           if let some (params : LeanFileProgressParams) := fromJson? (toJson params) |>.toOption then
             chanIsProcessing.send (! params.processing.isEmpty)
@@ -688,19 +688,30 @@ section MainLoop
     | _ => throwServerError "Got invalid JSON-RPC message"
 end MainLoop
 
-def runRefreshTask : WorkerM (Task (Except IO.Error Unit)) := do
+/--
+Asks the client to refresh semantic tokens while the file is being processed, until the returned token
+is set. Waiting happens on `IO.sleepAsync` timers, so the loop does not occupy a thread while idle.
+-/
+partial def runRefreshTask : WorkerM IO.CancelToken := do
   let ctx ← read
-  IO.asTask do
-    while ! (←IO.checkCanceled) do
+  let cancelTk ← IO.CancelToken.new
+  discard <| loop ctx cancelTk 0
+  return cancelTk
+where
+  loop (ctx : WorkerContext) (cancelTk : IO.CancelToken) (delayMs : UInt32) : BaseIO (Task Unit) := do
+    BaseIO.bindTask (← IO.sleepAsync delayMs) fun _ => do
+      if ← cancelTk.isSet then
+        return .pure ()
       let pastProcessingStates ← ctx.chanIsProcessing.recvAllCurrent
       if pastProcessingStates.isEmpty then
         -- Processing progress has not changed since we last sent out a refresh request
         -- => do not send out another one for now so that we do not make the client spam
         --    semantic token requests while idle and already having received an up-to-date state
-        IO.sleep 1000
-        continue
-      sendServerRequest ctx "workspace/semanticTokens/refresh" (none : Option Nat)
-      IO.sleep 2000
+        loop ctx cancelTk 1000
+      else
+        match ← (sendServerRequest ctx "workspace/semanticTokens/refresh" (none : Option Nat)).toBaseIO with
+        | .ok _    => loop ctx cancelTk 2000
+        | .error _ => return .pure ()
 
 def initAndRunWorker (i o e : FS.Stream) (opts : Options) : IO UInt32 := do
   let i ← maybeTee "fwIn.txt" false i
@@ -720,9 +731,9 @@ def initAndRunWorker (i o e : FS.Stream) (opts : Options) : IO UInt32 := do
     return (1 : UInt32)
   let exitCode ← StateRefT'.run' (s := st) <| ReaderT.run (r := ctx) do
     try
-      let refreshTask ← runRefreshTask
+      let refreshTk ← runRefreshTask
       mainLoop i
-      IO.cancel refreshTask
+      refreshTk.set
       return 0
     catch err =>
       let st ← get
@@ -674,14 +674,14 @@ partial def handleFoldingRange (_ : FoldingRangeParams)
 
 partial def handleWaitForDiagnostics (p : WaitForDiagnosticsParams)
     : RequestM (RequestTask WaitForDiagnostics) := do
-  let rec waitLoop : RequestM EditableDocument := do
+  -- polls the document version on an `IO.sleepAsync` timer instead of blocking a thread
+  let rec waitLoop : RequestM (RequestTask EditableDocument) := do
     let doc ← readDoc
     if p.version ≤ doc.meta.version then
-      return doc
+      return .pure <| .ok doc
     else
-      IO.sleep 50
-      waitLoop
-  let t ← RequestM.asTask waitLoop
+      RequestM.bindTask (← IO.sleepAsync 50) fun _ => waitLoop
+  let t ← waitLoop
   RequestM.bindTask t fun doc? => do
     let doc ← liftExcept doc?
     return doc.reporter.map fun _ => pure WaitForDiagnostics.mk
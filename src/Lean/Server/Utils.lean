@@ -10,6 +10,7 @@ import Lean.Data.Lsp.Communication
 import Lean.Data.Lsp.Diagnostics
 import Lean.Data.Lsp.Extra
 import Lean.Data.Lsp.TextSync
+import Lean.Data.Rope
 import Lean.Server.InfoUtils
 
 namespace IO
@@ -107,6 +108,19 @@ def replaceLspRange (text : FileMap) (r : Lsp.Range) (newText : String) : FileMa
   -- If this is ever a problem, we could store a second unnormalized FileMap, edit it, and normalize it here.
   (pre ++ newText.crlfToLf ++ post).toFileMap
 
+/-- Computes the codepoint index in `text` of an LSP-style 0-indexed (ln, col) position. -/
+private def lspPosToRopeIdx (text : Rope) (pos : Lsp.Position) : Nat :=
+  let start := text.lineStart pos.line
+  let pre := (text.extract start (start + pos.character)).toString
+  if start + pre.length == text.length && pre.utf16Length ≤ pos.character then
+    text.length
+  else
+    min (start + pre.utf16PosToCodepointPos pos.character) text.length
+
+/-- Like `replaceLspRange`, but on a `Rope`, so that the text is not rebuilt for every edit. -/
+private def replaceLspRangeInRope (text : Rope) (r : Lsp.Range) (newText : String) : Rope :=
+  text.replace (lspPosToRopeIdx text r.start) (lspPosToRopeIdx text r.«end») newText.crlfToLf
+
 open IO
 
 /--
@@ -125,6 +139,14 @@ def maybeTee (fName : String) (isOut : Bool) (h : FS.Stream) : IO FS.Stream := d
     else
       h.chainRight hTee true
 
+/--
+Returns whether the watchdog and its file workers should exchange messages in the binary encoding of
+`Json.toBinary` instead of as JSON text, which is the case if LEAN_SERVER_BINARY_IPC is set. Messages from
+and to the client are always JSON text.
+-/
+def useBinaryWorkerIpc : IO Bool :=
+  return (← IO.getEnv "LEAN_SERVER_BINARY_IPC").isSome
+
 open Lsp
 
 /-- Returns the document contents with the change applied. -/
@@ -134,9 +156,19 @@ def applyDocumentChange (oldText : FileMap) : (change : Lsp.TextDocumentContentC
   | TextDocumentContentChangeEvent.fullChange (newText : String) =>
     newText.crlfToLf.toFileMap
 
-/-- Returns the document contents with all changes applied. -/
+/--
+Returns the document contents with all changes applied. Several changes, as sent by editors for
+multi-cursor edits or renames, are applied to a `Rope`, so that the text and its `FileMap` are only
+rebuilt once for the whole batch instead of once per change.
+-/
 def foldDocumentChanges (changes : Array Lsp.TextDocumentContentChangeEvent) (oldText : FileMap) : FileMap :=
-  changes.foldl applyDocumentChange oldText
+  if changes.size ≤ 1 then
+    changes.foldl applyDocumentChange oldText
+  else
+    let text := changes.foldl (init := Rope.ofString oldText.source) fun text
+      | .rangeChange r newText => replaceLspRangeInRope text r newText
+      | .fullChange newText => Rope.ofString newText.crlfToLf
+    text.toString.toFileMap
 
 /-- Constructs a `textDocument/publishDiagnostics` notification. -/
 def mkPublishDiagnosticsNotification (m : DocumentMeta) (diagnostics : Array Lsp.Diagnostic) :
@@ -234,6 +234,8 @@ section ServerM
     /-- We store these to pass them to workers. -/
     initParams          : InitializeParams
     workerPath          : System.FilePath
+    /-- Whether to write messages to file workers in binary, see `useBinaryWorkerIpc`. -/
+    binaryWorkerIpc     : Bool
     srcSearchPath       : System.SearchPath
     references          : IO.Ref References
     serverRequestData   : IO.Ref ServerRequestData
@@ -382,8 +384,8 @@ section ServerM
     }
     let commTask ← forwardMessages fw
     let fw : FileWorker := { fw with commTask := commTask }
-    fw.stdin.writeLspRequest ⟨0, "initialize", st.initParams⟩
-    fw.stdin.writeLspNotification {
+    fw.stdin.writeLspRequest ⟨0, "initialize", st.initParams⟩ st.binaryWorkerIpc
+    fw.stdin.writeLspNotification (binary := st.binaryWorkerIpc) {
       method := "textDocument/didOpen"
       param  := {
         textDocument := {
@@ -402,7 +404,7 @@ section ServerM
     let some fw ← findFileWorker? uri
       | return
     try
-      fw.stdin.writeLspMessage (Message.notification "exit" none)
+      fw.stdin.writeLspMessage (Message.notification "exit" none) (← read).binaryWorkerIpc
     catch _ =>
       /- The file worker must have crashed just when we were about to terminate it!
         That's fine - just forget about it then.
@@ -425,7 +427,7 @@ section ServerM
       -- Try to discharge all queued msgs, tracking the ones that we can't discharge
       for msg in queuedMsgs do
         try
-          fw.stdin.writeLspMessage msg
+          fw.stdin.writeLspMessage msg (← read).binaryWorkerIpc
         catch _ =>
           crashedMsgs := crashedMsgs.push msg
       if ¬ crashedMsgs.isEmpty then
@@ -462,7 +464,7 @@ section ServerM
         else
           #[]
       try
-        fw.stdin.writeLspMessage msg
+        fw.stdin.writeLspMessage msg (← read).binaryWorkerIpc
       catch _ =>
         handleCrash uri initialQueuedMsgs .clientToFileWorkerForwarding
 
@@ -1142,6 +1144,7 @@ def startLoadingReferences (references : IO.Ref References) : IO Unit := do
 
 def initAndRunWatchdog (args : List String) (i o e : FS.Stream) : IO Unit := do
   let workerPath ← findWorkerPath
+  let binaryWorkerIpc ← useBinaryWorkerIpc
   let srcSearchPath ← initSrcSearchPath
   let references ← IO.mkRef .empty
   startLoadingReferences references
@@ -1174,6 +1177,7 @@ def initAndRunWatchdog (args : List String) (i o e : FS.Stream) : IO Unit := do
     fileWorkersRef   := fileWorkersRef
     initParams       := initRequest.param
     workerPath
+    binaryWorkerIpc
     srcSearchPath
     references
     serverRequestData
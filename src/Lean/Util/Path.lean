@@ -19,14 +19,13 @@ Executes `f` with the corresponding module name for each `.lean` file contained
 
 For example, if `dir` contains `A/B/C.lean`, `f` is called with `A.B.C`.
 -/
-partial def forEachModuleInDir [Monad m] [MonadLiftT IO m]
+def forEachModuleInDir [Monad m] [MonadLiftT IO m]
     (dir : FilePath) (f : Lean.Name → m PUnit) : m PUnit := do
-  for entry in (← dir.readDir) do
-    if (← liftM (m := IO) <| entry.path.isDir) then
-      let n := Lean.Name.mkSimple entry.fileName
-      forEachModuleInDir entry.path (f <| n ++ ·)
-    else if entry.path.extension == some "lean" then
-      f <| Lean.Name.mkSimple <| FilePath.withExtension entry.fileName "" |>.toString
+  let root := dir.toString.length
+  for entry in (← liftM (m := IO) <| dir.walkDirEntries (followSymlinks := true)) do
+    if entry.type != .dir && entry.path.extension == some "lean" then
+      let rel := entry.path.toString.drop root |>.dropWhile (FilePath.pathSeparators.contains ·)
+      f <| (FilePath.mk rel).withExtension "" |>.components.foldl Name.str .anonymous
 
 def realPathNormalized (p : FilePath) : IO FilePath :=
   return (← IO.FS.realPath p).normalize
@@ -64,7 +63,9 @@ def findAllWithExt (sp : SearchPath) (ext : String) : IO (Array FilePath) := do
   let mut paths := #[]
   for p in sp do
     if (← p.isDir) then
-      paths := paths ++ (← p.walkDir).filter (·.extension == some ext)
+      for entry in (← p.walkDirEntries (followSymlinks := true)) do
+        if entry.path.extension == some ext then
+          paths := paths.push entry.path
   return paths
 
 end SearchPath
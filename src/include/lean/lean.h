@@ -520,6 +520,12 @@ static inline void lean_set_non_heap_header_for_big(lean_object * o, unsigned ta
     lean_set_non_heap_header(o, 1, tag, other);
 }
 
+/* Static initializers for closed terms that the code generator emits as constant data (see `EmitC.lean`).
+   These objects are persistent (`m_rc == 0`) and are never updated. `LEAN_STATIC_HEADER` is the
+   initializer-list counterpart of `lean_set_non_heap_header`, and `LEAN_STATIC_BOX` of `lean_box`. */
+#define LEAN_STATIC_HEADER(sz, tag, other) {0, (sz), (other), (tag)}
+#define LEAN_STATIC_BOX(n) ((lean_object*)(((size_t)(n) << 1) | 1))
+
 /* Constructor objects */
 
 static inline unsigned lean_ctor_num_objs(lean_object * o) {
@@ -825,20 +831,36 @@ LEAN_EXPORT lean_object * lean_mk_array(lean_obj_arg n, lean_obj_arg v);
 
 /* Array of scalars */
 
+/* Element size of bit arrays. Their size and capacity count bits, which are packed into 64-bit words. */
+#define LEAN_BIT_ARRAY_ELEM_SIZE 0
+
+/* Number of bytes needed to store `n` elements of size `elem_size`. */
+static inline size_t lean_sarray_data_byte_size(unsigned elem_size, size_t n) {
+    return elem_size == LEAN_BIT_ARRAY_ELEM_SIZE ? sizeof(uint64_t)*((n + 63) / 64) : elem_size*n;
+}
+
 static inline lean_obj_res lean_alloc_sarray(unsigned elem_size, size_t size, size_t capacity) {
-    lean_sarray_object * o = (lean_sarray_object*)lean_alloc_object(sizeof(lean_sarray_object) + elem_size*capacity);
+    lean_sarray_object * o = (lean_sarray_object*)lean_alloc_object(sizeof(lean_sarray_object) + lean_sarray_data_byte_size(elem_size, capacity));
     lean_set_st_header((lean_object*)o, LeanScalarArray, elem_size);
     o->m_size = size;
     o->m_capacity = capacity;
     return (lean_object*)o;
 }
+/* Set in the `m_other` field of scalar arrays whose data is a memory-mapped file, see `lean_io_mmap_file`.
+   Such arrays are never resized in place, and they are unmapped instead of deallocated. */
+#define LEAN_SARRAY_MAPPED_FLAG 0x80
+
 static inline unsigned lean_sarray_elem_size(lean_object * o) {
     assert(lean_is_sarray(o));
-    return lean_ptr_other(o);
+    return lean_ptr_other(o) & ~LEAN_SARRAY_MAPPED_FLAG;
+}
+static inline bool lean_sarray_is_mapped(lean_object * o) {
+    assert(lean_is_sarray(o));
+    return (lean_ptr_other(o) & LEAN_SARRAY_MAPPED_FLAG) != 0;
 }
 static inline size_t lean_sarray_capacity(lean_object * o) { return lean_to_sarray(o)->m_capacity; }
 static inline size_t lean_sarray_byte_size(lean_object * o) {
-    return sizeof(lean_sarray_object) + lean_sarray_elem_size(o)*lean_sarray_capacity(o);
+    return sizeof(lean_sarray_object) + lean_sarray_data_byte_size(lean_sarray_elem_size(o), lean_sarray_capacity(o));
 }
 static inline size_t lean_sarray_size(b_lean_obj_arg o) { return lean_to_sarray(o)->m_size; }
 static inline void lean_sarray_set_size(u_lean_obj_arg o, size_t sz) {
@@ -856,6 +878,11 @@ LEAN_EXPORT lean_obj_res lean_byte_array_mk(lean_obj_arg a);
 LEAN_EXPORT lean_obj_res lean_byte_array_data(lean_obj_arg a);
 LEAN_EXPORT lean_obj_res lean_copy_byte_array(lean_obj_arg a);
 LEAN_EXPORT uint64_t lean_byte_array_hash(b_lean_obj_arg a);
+LEAN_EXPORT uint64_t lean_byte_array_hash_with_seed(b_lean_obj_arg a, uint64_t seed);
+LEAN_EXPORT lean_obj_res lean_byte_array_fill(lean_obj_arg a, b_lean_obj_arg off, b_lean_obj_arg len, uint8_t v);
+LEAN_EXPORT lean_obj_res lean_byte_array_index_of(b_lean_obj_arg a, uint8_t v, b_lean_obj_arg start);
+LEAN_EXPORT uint8_t lean_byte_array_compare(b_lean_obj_arg a, b_lean_obj_arg b);
+LEAN_EXPORT bool lean_byte_array_beq(b_lean_obj_arg a, b_lean_obj_arg b);
 
 static inline lean_obj_res lean_mk_empty_byte_array(b_lean_obj_arg capacity) {
     if (!lean_is_scalar(capacity)) lean_internal_panic_out_of_memory();
@@ -948,6 +975,14 @@ static inline double lean_float_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
 }
 
 LEAN_EXPORT lean_obj_res lean_float_array_push(lean_obj_arg a, double d);
+LEAN_EXPORT lean_obj_res lean_float_array_fill(lean_obj_arg a, b_lean_obj_arg off, b_lean_obj_arg len, double v);
+LEAN_EXPORT lean_obj_res lean_float_array_add(lean_obj_arg a, b_lean_obj_arg b);
+LEAN_EXPORT lean_obj_res lean_float_array_mul(lean_obj_arg a, b_lean_obj_arg b);
+LEAN_EXPORT lean_obj_res lean_float_array_fma(lean_obj_arg a, b_lean_obj_arg b, b_lean_obj_arg c);
+LEAN_EXPORT double lean_float_array_dot(b_lean_obj_arg a, b_lean_obj_arg b);
+LEAN_EXPORT double lean_float_array_sum(b_lean_obj_arg a);
+LEAN_EXPORT double lean_float_array_min(b_lean_obj_arg a);
+LEAN_EXPORT double lean_float_array_max(b_lean_obj_arg a);
 
 static inline lean_obj_res lean_float_array_uset(lean_obj_arg a, size_t i, double d) {
     lean_obj_res r;
@@ -975,6 +1010,85 @@ static inline lean_obj_res lean_float_array_set(lean_obj_arg a, b_lean_obj_arg i
     }
 }
 
+/* BitArray (special case of Array of Scalars)
+
+   Bits are stored least significant first in 64-bit words, and the bits of the last word past the size are
+   always zero, so that whole-word operations do not need to mask them. */
+
+LEAN_EXPORT lean_obj_res lean_bit_array_mk(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_bit_array_data(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_copy_bit_array(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_mk_bit_array(b_lean_obj_arg n, uint8_t v);
+
+static inline lean_obj_res lean_mk_empty_bit_array(b_lean_obj_arg capacity) {
+    if (!lean_is_scalar(capacity)) lean_internal_panic_out_of_memory();
+    return lean_alloc_sarray(LEAN_BIT_ARRAY_ELEM_SIZE, 0, lean_unbox(capacity));
+}
+
+static inline lean_obj_res lean_bit_array_size(b_lean_obj_arg a) {
+    return lean_box(lean_sarray_size(a));
+}
+
+static inline uint64_t * lean_bit_array_cptr(b_lean_obj_arg a) {
+    return (uint64_t*)(lean_sarray_cptr(a)); // NOLINT
+}
+
+static inline uint8_t lean_bit_array_uget(b_lean_obj_arg a, size_t i) {
+    return (lean_bit_array_cptr(a)[i / 64] >> (i % 64)) & 1;
+}
+
+static inline uint8_t lean_bit_array_fget(b_lean_obj_arg a, b_lean_obj_arg i) {
+    return lean_bit_array_uget(a, lean_unbox(i));
+}
+
+static inline uint8_t lean_bit_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
+    if (lean_is_scalar(i)) {
+        size_t idx = lean_unbox(i);
+        return idx < lean_sarray_size(a) ? lean_bit_array_uget(a, idx) : 0;
+    } else {
+        /* The index must be out of bounds. Otherwise we would be out of memory. */
+        return 0;
+    }
+}
+
+LEAN_EXPORT lean_obj_res lean_bit_array_push(lean_obj_arg a, uint8_t b);
+LEAN_EXPORT lean_obj_res lean_bit_array_popcount(b_lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_bit_array_find_first_set(b_lean_obj_arg a, b_lean_obj_arg start);
+LEAN_EXPORT lean_obj_res lean_bit_array_and(lean_obj_arg a, b_lean_obj_arg b);
+LEAN_EXPORT lean_obj_res lean_bit_array_or(lean_obj_arg a, b_lean_obj_arg b);
+LEAN_EXPORT lean_obj_res lean_bit_array_xor(lean_obj_arg a, b_lean_obj_arg b);
+LEAN_EXPORT lean_obj_res lean_bit_array_not(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_bit_array_shift_left(lean_obj_arg a, b_lean_obj_arg n);
+LEAN_EXPORT lean_obj_res lean_bit_array_shift_right(lean_obj_arg a, b_lean_obj_arg n);
+LEAN_EXPORT bool lean_bit_array_beq(b_lean_obj_arg a, b_lean_obj_arg b);
+
+static inline lean_obj_res lean_bit_array_uset(lean_obj_arg a, size_t i, uint8_t b) {
+    lean_obj_res r;
+    if (lean_is_exclusive(a)) r = a;
+    else r = lean_copy_bit_array(a);
+    uint64_t * it = lean_bit_array_cptr(r) + i / 64;
+    uint64_t m = (uint64_t)1 << (i % 64);
+    *it = b ? (*it | m) : (*it & ~m);
+    return r;
+}
+
+static inline lean_obj_res lean_bit_array_fset(lean_obj_arg a, b_lean_obj_arg i, uint8_t b) {
+    return lean_bit_array_uset(a, lean_unbox(i), b);
+}
+
+static inline lean_obj_res lean_bit_array_set(lean_obj_arg a, b_lean_obj_arg i, uint8_t b) {
+    if (!lean_is_scalar(i)) {
+        return a;
+    } else {
+        size_t idx = lean_unbox(i);
+        if (idx >= lean_sarray_size(a)) {
+            return a;
+        } else {
+            return lean_bit_array_uset(a, idx, b);
+        }
+    }
+}
+
 /* Strings */
 
 static inline lean_obj_res lean_alloc_string(size_t size, size_t capacity, size_t len) {
@@ -1004,6 +1118,9 @@ static inline size_t lean_string_size(b_lean_obj_arg o) { return lean_to_string(
 static inline size_t lean_string_len(b_lean_obj_arg o) { return lean_to_string(o)->m_length; }
 LEAN_EXPORT lean_obj_res lean_string_push(lean_obj_arg s, uint32_t c);
 LEAN_EXPORT lean_obj_res lean_string_append(lean_obj_arg s1, b_lean_obj_arg s2);
+LEAN_EXPORT lean_obj_res lean_string_pushn(lean_obj_arg s, uint32_t c, b_lean_obj_arg n);
+LEAN_EXPORT lean_obj_res lean_string_append_extract(lean_obj_arg s, b_lean_obj_arg src, b_lean_obj_arg b, b_lean_obj_arg e);
+LEAN_EXPORT lean_obj_res lean_mk_empty_string_with_capacity(b_lean_obj_arg capacity);
 static inline lean_obj_res lean_string_length(b_lean_obj_arg s) { return lean_box(lean_string_len(s)); }
 LEAN_EXPORT lean_obj_res lean_string_mk(lean_obj_arg cs);
 LEAN_EXPORT lean_obj_res lean_string_data(lean_obj_arg s);
@@ -1048,7 +1165,9 @@ LEAN_EXPORT bool lean_string_lt(b_lean_obj_arg s1, b_lean_obj_arg s2);
 static inline uint8_t lean_string_dec_eq(b_lean_obj_arg s1, b_lean_obj_arg s2) { return lean_string_eq(s1, s2); }
 static inline uint8_t lean_string_dec_lt(b_lean_obj_arg s1, b_lean_obj_arg s2) { return lean_string_lt(s1, s2); }
 LEAN_EXPORT uint64_t lean_string_hash(b_lean_obj_arg);
+LEAN_EXPORT uint64_t lean_string_hash_with_seed(b_lean_obj_arg, uint64_t seed);
 LEAN_EXPORT lean_obj_res lean_string_of_usize(size_t);
+LEAN_EXPORT lean_obj_res lean_nat_big_repr(b_lean_obj_arg);
 
 /* Thunks */
 
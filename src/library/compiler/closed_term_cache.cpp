@@ -8,6 +8,7 @@ Author: Leonardo de Moura
 
 namespace lean {
 extern "C" object * lean_cache_closed_term_name(object * env, object * e, object * n);
+extern "C" object * lean_cache_shared_closed_term_name(object * env, object * e, object * n);
 extern "C" object * lean_get_closed_term_name(object * env, object * e);
 
 optional<name> get_closed_term_name(environment const & env, expr const & e) {
@@ -17,4 +18,8 @@ optional<name> get_closed_term_name(environment const & env, expr const & e) {
 environment cache_closed_term_name(environment const & env, expr const & e, name const & n) {
     return environment(lean_cache_closed_term_name(env.to_obj_arg(), e.to_obj_arg(), n.to_obj_arg()));
 }
+
+environment cache_shared_closed_term_name(environment const & env, expr const & e, name const & n) {
+    return environment(lean_cache_shared_closed_term_name(env.to_obj_arg(), e.to_obj_arg(), n.to_obj_arg()));
+}
 }
@@ -9,4 +9,6 @@ Author: Leonardo de Moura
 namespace lean {
 optional<name> get_closed_term_name(environment const & env, expr const & e);
 environment cache_closed_term_name(environment const & env, expr const & e, name const & n);
+/* Similar to `cache_closed_term_name`, but the closed term `n` is exported, and downstream modules reuse it. */
+environment cache_shared_closed_term_name(environment const & env, expr const & e, name const & n);
 }
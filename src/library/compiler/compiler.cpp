@@ -34,8 +34,10 @@ Author: Leonardo de Moura
 
 namespace lean {
 static name * g_extract_closed = nullptr;
+static name * g_share_closed_terms = nullptr;
 
 bool is_extract_closed_enabled(options const & opts) { return opts.get_bool(*g_extract_closed, true); }
+bool is_share_closed_terms_enabled(options const & opts) { return opts.get_bool(*g_share_closed_terms, false); }
 
 static name get_real_name(name const & n) {
     if (optional<name> new_n = is_unsafe_rec_name(n))
@@ -256,7 +258,7 @@ environment compile(environment const & env, options const & opts, names cs) {
     new_env = cache_stage2(new_env, ds);
     trace_compiler(name({"compiler", "stage2"}), ds);
     if (is_extract_closed_enabled(opts)) {
-        std::tie(new_env, ds) = extract_closed(new_env, ds);
+        std::tie(new_env, ds) = extract_closed(new_env, ds, is_share_closed_terms_enabled(opts));
         ds = apply(elim_dead_let, ds);
         ds = apply(esimp, new_env, ds);
         trace_compiler(name({"compiler", "extract_closed"}), ds);
@@ -283,6 +285,9 @@ void initialize_compiler() {
     g_extract_closed = new name{"compiler", "extract_closed"};
     mark_persistent(g_extract_closed->raw());
     register_bool_option(*g_extract_closed, true, "(compiler) enable/disable closed term caching");
+    g_share_closed_terms = new name{"compiler", "share_closed_terms"};
+    mark_persistent(g_share_closed_terms->raw());
+    register_bool_option(*g_share_closed_terms, false, "(compiler) export closed terms so that modules importing the current one reuse them instead of creating their own copies");
     register_trace_class("compiler");
     register_trace_class({"compiler", "input"});
     register_trace_class({"compiler", "inline"});
@@ -325,5 +330,6 @@ void initialize_compiler() {
 
 void finalize_compiler() {
     delete g_extract_closed;
+    delete g_share_closed_terms;
 }
 }
@@ -7,6 +7,7 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include <unordered_set>
 #include <unordered_map>
+#include <vector>
 #include "runtime/flet.h"
 #include "kernel/type_checker.h"
 #include "kernel/for_each_fn.h"
@@ -20,6 +21,7 @@ Author: Leonardo de Moura
 #include "library/constants.h"
 #include "library/class.h"
 #include "library/expr_pair_maps.h"
+#include "library/time_task.h"
 #include "library/compiler/util.h"
 #include "library/compiler/cse.h"
 #include "library/compiler/elim_dead_let.h"
@@ -29,8 +31,9 @@ Author: Leonardo de Moura
 #include "library/compiler/init_attribute.h"
 
 namespace lean {
-csimp_cfg::csimp_cfg(options const &):
+csimp_cfg::csimp_cfg(options const & opts):
     csimp_cfg() {
+    m_opts = opts;
 }
 
 csimp_cfg::csimp_cfg() {
@@ -62,6 +65,71 @@ optional<expr> fold_bin_op(bool before_erasure, expr const & f, expr const & a,
     return to_optional_expr(lean_fold_bin_op(before_erasure, f.raw(), a.raw(), b.raw()));
 }
 
+/* A constant consulted when checking whether an inline candidate is recursive. */
+struct recursive_dep {
+    name                    m_fn;
+    name                    m_aux;
+    optional<constant_info> m_info;
+    bool                    m_inline;
+};
+
+/* Inlining information for a `cstage1`/`cstage2` definition. It only depends on the definition itself,
+   but `csimp_fn` used to recompute it at every call site, and small monadic helpers are inlined
+   in almost every declaration of a module. */
+struct inline_candidate_info {
+    /* The entry is only valid if the environment still maps the auxiliary name to this object. */
+    constant_info     m_info;
+    unsigned          m_lcnf_size;
+    optional<bool>    m_recursive;
+    /* `m_recursive` follows the other inline candidates reachable from the definition, so it also depends on
+       these constants and is recomputed if the environment maps any of them differently. */
+    std::vector<recursive_dep> m_recursive_deps;
+    optional<bool>    m_unsafe_inductive;
+    /* `instantiate_value_lparams` results indexed by the callee (i.e., the name and universe levels). */
+    expr_map<expr>    m_values;
+    inline_candidate_info() {}
+    inline_candidate_info(constant_info const & info, unsigned sz):m_info(info), m_lcnf_size(sz) {}
+};
+
+/* Cache of `inline_candidate_info` shared by all `csimp` invocations for the current module.
+   We reset it when the main module or the inlining threshold changes. */
+struct inline_cache {
+    name                                                           m_module;
+    unsigned                                                       m_inline_threshold{0};
+    std::unordered_map<name, inline_candidate_info, name_hash_fn>  m_infos;
+};
+
+MK_THREAD_LOCAL_GET_DEF(inline_cache, get_inline_cache);
+
+static inline_candidate_info & get_inline_candidate_info(environment const & env, csimp_cfg const & cfg,
+                                                         name const & c, constant_info const & info) {
+    inline_cache & cache = get_inline_cache();
+    name main_module     = env.get_main_module();
+    if (cache.m_module != main_module || cache.m_inline_threshold != cfg.m_inline_threshold) {
+        cache.m_infos.clear();
+        cache.m_module           = main_module;
+        cache.m_inline_threshold = cfg.m_inline_threshold;
+    }
+    auto it = cache.m_infos.find(c);
+    if (it != cache.m_infos.end() && is_eqp(it->second.m_info, info))
+        return it->second;
+    /* Remark: references to elements of `std::unordered_map` are not invalidated by insertions. */
+    inline_candidate_info & r = cache.m_infos[c];
+    r = inline_candidate_info(info, get_lcnf_size(env, info.get_value()));
+    return r;
+}
+
+static bool recursive_deps_unchanged(environment const & env, std::vector<recursive_dep> const & deps) {
+    for (recursive_dep const & d : deps) {
+        optional<constant_info> info = env.find(d.m_aux);
+        if (static_cast<bool>(info) != static_cast<bool>(d.m_info))
+            return false;
+        if (info && (!is_eqp(*info, *d.m_info) || has_inline_attribute(env, d.m_fn) != d.m_inline))
+            return false;
+    }
+    return true;
+}
+
 class csimp_fn {
     typedef expr_pair_struct_map<expr> jp_cache;
     type_checker::state      m_st;
@@ -1629,19 +1697,25 @@ class csimp_fn {
         csimp_cfg const &   m_cfg;
         bool                m_before_erasure;
         name                m_target;
+        std::vector<recursive_dep> & m_deps;
+        name_set            m_recorded;
 
-        is_recursive_fn(environment const & env, csimp_cfg const & cfg, bool before_erasure):
-            m_env(env), m_cfg(cfg), m_before_erasure(before_erasure) {
+        is_recursive_fn(environment const & env, csimp_cfg const & cfg, bool before_erasure, std::vector<recursive_dep> & deps):
+            m_env(env), m_cfg(cfg), m_before_erasure(before_erasure), m_deps(deps) {
         }
 
         optional<constant_info> is_inline_candidate(name const  & f) {
             name c = m_before_erasure ? mk_cstage1_name(f) : mk_cstage2_name(f);
             optional<constant_info> info = m_env.find(c);
+            if (!m_recorded.contains(f)) {
+                m_recorded.insert(f);
+                m_deps.push_back(recursive_dep{f, c, info, info && has_inline_attribute(m_env, f)});
+            }
             if (!info || !info->is_definition()) {
                 return optional<constant_info>();
             } else if (has_inline_attribute(m_env, f)) {
                 return info;
-            } else if (get_lcnf_size(m_env, info->get_value()) <= m_cfg.m_inline_threshold) {
+            } else if (get_inline_candidate_info(m_env, m_cfg, c, *info).m_lcnf_size <= m_cfg.m_inline_threshold) {
                 return info;
             } else {
                 return optional<constant_info>();
@@ -1668,18 +1742,37 @@ class csimp_fn {
     };
 
     /* We don't inline recursive functions. */
-    bool is_recursive(name const & c) {
-        return is_recursive_fn(env(), m_cfg, m_before_erasure)(c);
+    bool is_recursive(name const & c, inline_candidate_info & c_info) {
+        if (!c_info.m_recursive || !recursive_deps_unchanged(env(), c_info.m_recursive_deps)) {
+            c_info.m_recursive_deps.clear();
+            c_info.m_recursive = is_recursive_fn(env(), m_cfg, m_before_erasure, c_info.m_recursive_deps)(c);
+        }
+        return *c_info.m_recursive;
+    }
+
+    bool uses_unsafe_inductive(inline_candidate_info & c_info) {
+        if (!c_info.m_unsafe_inductive) {
+            c_info.m_unsafe_inductive = static_cast<bool>(::lean::find(c_info.m_info.get_value(), [&](expr const & e, unsigned) {
+                        if (!is_constant(e) || !is_cases_on_recursor(env(), const_name(e))) return false;
+                        name const & I = const_name(e).get_prefix();
+                        constant_info I_cinfo = env().get(I);
+                        return I_cinfo.is_unsafe();
+                    }));
+        }
+        return *c_info.m_unsafe_inductive;
     }
 
-    bool uses_unsafe_inductive(name const & c) {
-        constant_info info = env().get(c);
-        return static_cast<bool>(::lean::find(info.get_value(), [&](expr const & e, unsigned) {
-                    if (!is_constant(e) || !is_cases_on_recursor(env(), const_name(e))) return false;
-                    name const & I = const_name(e).get_prefix();
-                    constant_info I_cinfo = env().get(I);
-                    return I_cinfo.is_unsafe();
-                }));
+    /* Return the value of the inline candidate `fn` instantiated with its universe levels. */
+    expr instantiate_inline_value(expr const & fn, inline_candidate_info & c_info) {
+        lean_assert(is_constant(fn));
+        if (is_nil(const_levels(fn)))
+            return c_info.m_info.get_value();
+        auto it = c_info.m_values.find(fn);
+        if (it != c_info.m_values.end())
+            return it->second;
+        expr r = instantiate_value_lparams(c_info.m_info, const_levels(fn));
+        c_info.m_values.insert(mk_pair(fn, r));
+        return r;
     }
 
     bool is_stuck_at_cases(expr e) {
@@ -1738,22 +1831,23 @@ class csimp_fn {
             optional<constant_info> info = env().find(c);
             if (!info || !info->is_definition()) return none_expr();
             if (get_app_num_args(e) < get_num_nested_lambdas(info->get_value())) return none_expr();
+            inline_candidate_info & c_info = get_inline_candidate_info(env(), m_cfg, c, *info);
             bool inline_attr           = has_inline_attribute(env(), const_name(fn));
             bool inline_if_reduce_attr = has_inline_if_reduce_attribute(env(), const_name(fn));
             if (!inline_attr && !inline_if_reduce_attr &&
-                (get_lcnf_size(env(), info->get_value()) > m_cfg.m_inline_threshold ||
+                (c_info.m_lcnf_size > m_cfg.m_inline_threshold ||
                  is_constant(e))) { /* We only inline constants if they are marked with the `[inline]` or `[inline_if_reduce]` attrs */
                 return none_expr();
             }
-            if (!inline_if_reduce_attr && is_recursive(const_name(fn))) return none_expr();
+            if (!inline_if_reduce_attr && is_recursive(const_name(fn), c_info)) return none_expr();
             if (!is_matcher(env(), const_name(fn))) {
                 // Hack for test `inliner_loop`. We don't generate code for auxiliary matcher applications.
                 // However, they are safe to be inline even when they use unsafe inductive types.
                 // REMARK: the to be implemented `[strong_inline]` attribute should not be used in unsafe code.
-                if (uses_unsafe_inductive(c)) return none_expr();
+                if (uses_unsafe_inductive(c_info)) return none_expr();
             }
             lean_trace(name({"compiler", "inline"}), tout() << const_name(fn) << "\n";);
-            expr new_fn = instantiate_value_lparams(*info, const_levels(fn));
+            expr new_fn = instantiate_inline_value(fn, c_info);
             if (inline_if_reduce_attr && !inline_attr) {
                 return beta_reduce_if_not_cases(new_fn, e, is_let_val);
             } else {
@@ -1767,9 +1861,10 @@ class csimp_fn {
             if (!info || !info->is_definition()) return none_expr();
             unsigned arity = get_num_nested_lambdas(info->get_value());
             if (get_app_num_args(e) < arity || arity == 0) return none_expr();
-            if (get_lcnf_size(env(), info->get_value()) > m_cfg.m_inline_threshold) return none_expr();
-            if (is_recursive(const_name(fn))) return none_expr();
-            if (uses_unsafe_inductive(c)) return none_expr();
+            inline_candidate_info & c_info = get_inline_candidate_info(env(), m_cfg, c, *info);
+            if (c_info.m_lcnf_size > m_cfg.m_inline_threshold) return none_expr();
+            if (is_recursive(const_name(fn), c_info)) return none_expr();
+            if (uses_unsafe_inductive(c_info)) return none_expr();
             return some_expr(beta_reduce(info->get_value(), e, is_let_val));
         }
     }
@@ -1793,7 +1888,7 @@ class csimp_fn {
             optional<constant_info> info = env().find(c);
             if (!info || !info->is_definition())
                 return first ? visit(r, is_let_val) : r;
-            expr new_fn = instantiate_value_lparams(*info, const_levels(fn));
+            expr new_fn = instantiate_inline_value(fn, get_inline_candidate_info(env(), m_cfg, c, *info));
             r = beta_reduce(new_fn, new_args.size(), new_args.data(), is_let_val);
             if (!is_app(r)) return r;
             fn = get_app_fn(r);
@@ -2104,6 +2199,7 @@ public:
 };
 
 expr csimp_core(environment const & env, local_ctx const & lctx, expr const & e0, bool before_erasure, csimp_cfg const & cfg) {
+    time_task t(before_erasure ? "compiler simp" : "compiler simp (erased)", cfg.m_opts);
     csimp_fn simp(env, lctx, before_erasure, cfg);
     elim_jp1_fn elim_jp1(env, lctx, before_erasure);
     expr e = e0;
@@ -18,6 +18,8 @@ struct csimp_cfg {
     unsigned m_float_cases_threshold;
     /* We inline join-points that are smaller m_inline_threshold. */
     unsigned m_inline_jp_threshold;
+    /* Options used to report `csimp` timings when `profiler` is set. */
+    options  m_opts;
 public:
     csimp_cfg(options const & opts);
     csimp_cfg();
@@ -33,6 +33,7 @@ class extract_closed_fn {
     name                m_base_name;
     unsigned            m_next_idx{1};
     expr_map<bool>      m_closed;
+    bool                m_share;
 
     environment const & env() const { return m_env; }
     name_generator & ngen() { return m_ngen; }
@@ -239,7 +240,7 @@ class extract_closed_fn {
         }
         name c = next_name();
         m_new_decls.push_back(comp_decl(c, e));
-        m_env = cache_closed_term_name(m_env, e, c);
+        m_env = m_share ? cache_shared_closed_term_name(m_env, e, c) : cache_closed_term_name(m_env, e, c);
         return mk_constant(c);
     }
 
@@ -286,8 +287,8 @@ class extract_closed_fn {
     }
 
 public:
-    extract_closed_fn(environment const & env, comp_decls const & ds):
-        m_env(env), m_input_decls(ds) {
+    extract_closed_fn(environment const & env, comp_decls const & ds, bool share):
+        m_env(env), m_input_decls(ds), m_share(share) {
     }
 
     pair<environment, comp_decls> operator()(comp_decl const & d) {
@@ -308,15 +309,15 @@ public:
     }
 };
 
-pair<environment, comp_decls> extract_closed_core(environment const & env, comp_decls const & input_ds, comp_decl const & d) {
-    return extract_closed_fn(env, input_ds)(d);
+pair<environment, comp_decls> extract_closed_core(environment const & env, comp_decls const & input_ds, comp_decl const & d, bool share) {
+    return extract_closed_fn(env, input_ds, share)(d);
 }
 
-pair<environment, comp_decls> extract_closed(environment env, comp_decls const & ds) {
+pair<environment, comp_decls> extract_closed(environment env, comp_decls const & ds, bool share) {
     comp_decls r;
     for (comp_decl const & d : ds) {
         comp_decls new_ds;
-        std::tie(env, new_ds) = extract_closed_core(env, ds, d);
+        std::tie(env, new_ds) = extract_closed_core(env, ds, d, share);
         r = append(r, new_ds);
     }
     return mk_pair(env, r);
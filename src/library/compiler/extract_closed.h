@@ -9,5 +9,7 @@ Author: Leonardo de Moura
 #include "library/compiler/util.h"
 namespace lean {
 bool is_extract_closed_aux_fn(name const & n);
-pair<environment, comp_decls> extract_closed(environment env, comp_decls const & ds);
+/* Extract closed terms from `ds`. If `share == true`, the new closed terms are exported and recorded in the `.olean` file,
+   and modules importing the current one reuse them instead of creating their own copies. */
+pair<environment, comp_decls> extract_closed(environment env, comp_decls const & ds, bool share = false);
 }
@@ -589,6 +589,24 @@ string_ref emit_c(environment const & env, name const & mod_name) {
     }
 }
 
+extern "C" object * lean_ir_emit_c_parts(object * env, object * mod_name, object * num_parts);
+
+std::vector<string_ref> emit_c_parts(environment const & env, name const & mod_name, unsigned num_parts) {
+    object * r = lean_ir_emit_c_parts(env.to_obj_arg(), mod_name.to_obj_arg(), mk_nat_obj(num_parts));
+    if (cnstr_tag(r) == 0) {
+        string_ref s(cnstr_get(r, 0), true);
+        dec_ref(r);
+        throw exception(s.to_std_string());
+    } else {
+        array_ref<string_ref> parts(cnstr_get(r, 0), true);
+        dec_ref(r);
+        std::vector<string_ref> result;
+        for (string_ref const & part : parts)
+            result.push_back(part);
+        return result;
+    }
+}
+
 /*
 inductive CtorFieldInfo
 | irrelevant
@@ -6,6 +6,7 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <string>
+#include <vector>
 #include "kernel/environment.h"
 #include "library/compiler/util.h"
 namespace lean {
@@ -37,6 +38,8 @@ void test(decl const & d);
 environment compile(environment const & env, options const & opts, comp_decls const & decls);
 environment add_extern(environment const & env, name const & fn);
 LEAN_EXPORT string_ref emit_c(environment const & env, name const & mod_name);
+/* Similar to `emit_c`, but split the module into at most `num_parts` translation units. */
+LEAN_EXPORT std::vector<string_ref> emit_c_parts(environment const & env, name const & mod_name, unsigned num_parts);
 void emit_llvm(environment const & env, name const & mod_name, std::string const &filepath);
 }
 void initialize_ir();
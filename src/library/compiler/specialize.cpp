@@ -11,7 +11,9 @@ Author: Leonardo de Moura
 #include "kernel/abstract.h"
 #include "kernel/inductive.h"
 #include "kernel/trace.h"
+#include "kernel/expr_maps.h"
 #include "library/class.h"
+#include "library/max_sharing.h"
 #include "library/compiler/util.h"
 #include "library/compiler/csimp.h"
 
@@ -374,7 +376,9 @@ class specialize_fn {
     }
 
     struct spec_ctx {
-        typedef rb_expr_map<name> cache;
+        /* Specialization requests are hashed (the hash is cached in each `expr` node), and
+           we only compare keys structurally when their hashes collide. */
+        typedef expr_map<name> cache;
         names                 m_mutual;
         /* `m_params` contains all variables that must be lambda abstracted in the specialization.
            It may contain let-variables that occurs inside of binders.
@@ -839,9 +843,10 @@ class specialize_fn {
         lean_assert(is_constant(fn));
         lean_assert(ctx.in_mutual_decl(const_name(fn)));
         expr key = mk_cache_key(fn, mask);
-        if (name const * r = ctx.m_cache.find(key)) {
-            lean_trace(name({"compiler", "specialize"}), tout() << "spec_preprocess: " << trace_pp_expr(key) << " ==> " << *r << "\n";);
-            return optional<name>(*r);
+        auto it = ctx.m_cache.find(key);
+        if (it != ctx.m_cache.end()) {
+            lean_trace(name({"compiler", "specialize"}), tout() << "spec_preprocess: " << trace_pp_expr(key) << " ==> " << it->second << "\n";);
+            return optional<name>(it->second);
         }
 
         optional<expr> new_code_opt = get_code(fn);
@@ -849,7 +854,7 @@ class specialize_fn {
         expr new_code = *new_code_opt;
 
         name new_name = mk_spec_name(const_name(fn));
-        ctx.m_cache.insert(key, new_name);
+        ctx.m_cache.insert(mk_pair(key, new_name));
         lean_trace(name({"compiler", "specialize"}), tout() << "spec_preprocess update cache: " << trace_pp_expr(key) << " ===> " << new_name << "\n";);
         flet<local_ctx> save_lctx(m_lctx, m_lctx);
         buffer<expr> fvars;
@@ -1114,7 +1119,9 @@ class specialize_fn {
            This file will be deleted. So, it is not worth designing a better caching scheme.
            TODO: when we reimplement this module in Lean, we should have a better caching heuristic. */
         if (gcache_enabled && ctx.m_params.size() == 0) {
-            key = mk_app(fn, gcache_key_args);
+            /* We hash-cons the key: the persistent cache stores it, and equality tests on hash collisions
+               are cheaper on maximally shared terms. */
+            key = max_sharing(mk_app(fn, gcache_key_args));
             if (optional<name> it = get_cached_specialization(env(), key)) {
                 lean_trace(name({"compiler", "specialize"}), tout() << "get_cached_specialization [" << ctx.m_params.size() << "]: " << *it << "\n";
                            unsigned i = 0;
@@ -19,6 +19,8 @@ name const * g_bit1 = nullptr;
 name const * g_has_of_nat_of_nat = nullptr;
 name const * g_byte_array = nullptr;
 name const * g_byte_array_data = nullptr;
+name const * g_bit_array = nullptr;
+name const * g_bit_array_data = nullptr;
 name const * g_bool = nullptr;
 name const * g_bool_false = nullptr;
 name const * g_bool_true = nullptr;
@@ -141,6 +143,10 @@ void initialize_constants() {
     mark_persistent(g_byte_array->raw());
     g_byte_array_data = new name{"ByteArray", "data"};
     mark_persistent(g_byte_array_data->raw());
+    g_bit_array = new name{"BitArray"};
+    mark_persistent(g_bit_array->raw());
+    g_bit_array_data = new name{"BitArray", "data"};
+    mark_persistent(g_bit_array_data->raw());
     g_bool = new name{"Bool"};
     mark_persistent(g_bool->raw());
     g_bool_false = new name{"Bool", "false"};
@@ -337,6 +343,8 @@ void finalize_constants() {
     delete g_has_of_nat_of_nat;
     delete g_byte_array;
     delete g_byte_array_data;
+    delete g_bit_array;
+    delete g_bit_array_data;
     delete g_bool;
     delete g_bool_false;
     delete g_bool_true;
@@ -443,6 +451,8 @@ name const & get_bit1_name() { return *g_bit1; }
 name const & get_has_of_nat_of_nat_name() { return *g_has_of_nat_of_nat; }
 name const & get_byte_array_name() { return *g_byte_array; }
 name const & get_byte_array_data_name() { return *g_byte_array_data; }
+name const & get_bit_array_name() { return *g_bit_array; }
+name const & get_bit_array_data_name() { return *g_bit_array_data; }
 name const & get_bool_name() { return *g_bool; }
 name const & get_bool_false_name() { return *g_bool_false; }
 name const & get_bool_true_name() { return *g_bool_true; }
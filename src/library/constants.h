@@ -21,6 +21,8 @@ name const & get_bit1_name();
 name const & get_has_of_nat_of_nat_name();
 name const & get_byte_array_name();
 name const & get_byte_array_data_name();
+name const & get_bit_array_name();
+name const & get_bit_array_data_name();
 name const & get_bool_name();
 name const & get_bool_false_name();
 name const & get_bool_true_name();
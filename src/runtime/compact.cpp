@@ -142,12 +142,13 @@ object * object_compactor::copy_object(object * o) {
 void object_compactor::insert_sarray(object * o) {
     size_t sz        = lean_sarray_size(o);
     unsigned elem_sz = lean_sarray_elem_size(o);
-    size_t obj_sz = sizeof(lean_sarray_object) + elem_sz*sz;
+    size_t data_sz   = lean_sarray_data_byte_size(elem_sz, sz);
+    size_t obj_sz = sizeof(lean_sarray_object) + data_sz;
     lean_sarray_object * new_o = (lean_sarray_object*)alloc(obj_sz);
     lean_set_non_heap_header_for_big((lean_object*)new_o, LeanScalarArray, elem_sz);
     new_o->m_size     = sz;
     new_o->m_capacity = sz;
-    memcpy(new_o->m_data, lean_to_sarray(o)->m_data, elem_sz*sz);
+    memcpy(new_o->m_data, lean_to_sarray(o)->m_data, data_sz);
     save_max_sharing(o, (lean_object*)new_o, obj_sz);
 }
 
@@ -0,0 +1,299 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+
+Author: agent
+
+Filesystem change notification (`IO.FS.Watcher`).
+*/
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+#if defined(__linux__)
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#endif
+#include "runtime/fswatch.h"
+#include "runtime/io.h"
+#include "runtime/object.h"
+#include "runtime/thread.h"
+
+namespace lean {
+
+/* `IO.FS.ChangeKind` */
+enum class change_kind : uint8 { created, modified, removed, overflow };
+
+#if defined(__linux__)
+
+/*
+  A set of inotify watches. `wait` is usually blocked on a dedicated thread while other threads `add` paths
+  or `close` the watcher, so the watch table is guarded by `m_mutex`, and `close` wakes up `wait` through a
+  pipe instead of closing the inotify descriptor under its feet. */
+struct fs_watcher {
+    struct watch {
+        std::string m_path;
+        bool        m_recursive;
+    };
+
+    int                          m_fd;
+    int                          m_wake[2];
+    mutex                        m_mutex;
+    std::unordered_map<int, watch> m_watches;
+    bool                         m_closed = false;
+
+    /* Pending events of the current batch, coalesced by path. */
+    std::vector<std::pair<std::string, change_kind>> m_events;
+    std::unordered_map<std::string, size_t> m_event_idx;
+
+    fs_watcher(int fd, int wake_r, int wake_w):m_fd(fd) { m_wake[0] = wake_r; m_wake[1] = wake_w; }
+    ~fs_watcher() {
+        close(m_fd);
+        close(m_wake[0]);
+        close(m_wake[1]);
+    }
+
+    static constexpr uint32_t g_mask =
+        IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO |
+        IN_DELETE_SELF | IN_MOVE_SELF;
+
+    /* Watches `path` and, if `recursive`, all directories below it. If `report` is set, the entries found
+       below `path` are reported as created; this is used for directories created while being watched, whose
+       contents may have been created before the new watch was in place. Must be called with `m_mutex` held. */
+    int add(std::string const & path, bool recursive, bool report) {
+        int wd = inotify_add_watch(m_fd, path.c_str(), g_mask);
+        if (wd < 0) return errno;
+        m_watches[wd] = watch{path, recursive};
+        if (!recursive) return 0;
+        DIR * dp = opendir(path.c_str());
+        if (!dp) return 0; // not a directory, or vanished
+        while (dirent * e = readdir(dp)) {
+            if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+            std::string child = path + "/" + e->d_name;
+            if (report) push_event(child, change_kind::created);
+            struct stat st;
+            if (lstat(child.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+                add(child, recursive, report);
+            }
+        }
+        closedir(dp);
+        return 0;
+    }
+
+    /* Stops watching `path` and everything below it, which was moved away, so that its events are not
+       reported under the old path anymore. If it was moved within a recursively watched directory, it is
+       watched again under its new path. Must be called with `m_mutex` held. */
+    void remove(std::string const & path) {
+        for (auto it = m_watches.begin(); it != m_watches.end();) {
+            std::string const & p = it->second.m_path;
+            if (p == path || (p.size() > path.size() && p.compare(0, path.size(), path) == 0 && p[path.size()] == '/')) {
+                inotify_rm_watch(m_fd, it->first);
+                it = m_watches.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    /* Adds an event to the current batch, merging it with an earlier event for the same path. */
+    void push_event(std::string const & path, change_kind k) {
+        auto it = m_event_idx.find(path);
+        if (it == m_event_idx.end()) {
+            m_event_idx.emplace(path, m_events.size());
+            m_events.emplace_back(path, k);
+            return;
+        }
+        change_kind & old = m_events[it->second].second;
+        if (old == change_kind::created && k == change_kind::modified) {
+            // still new
+        } else if (old == change_kind::removed && k == change_kind::created) {
+            old = change_kind::modified; // replaced
+        } else {
+            old = k;
+        }
+    }
+
+    /* Reads all queued inotify events into the current batch. Returns false if there were none. */
+    bool drain() {
+        alignas(inotify_event) char buf[16 * 1024];
+        bool any = false;
+        while (true) {
+            ssize_t n = read(m_fd, buf, sizeof(buf));
+            if (n <= 0) return any;
+            any = true;
+            lock_guard<mutex> lock(m_mutex);
+            for (ssize_t off = 0; off < n;) {
+                inotify_event * ev = reinterpret_cast<inotify_event *>(buf + off);
+                off += sizeof(inotify_event) + ev->len;
+                if (ev->mask & IN_Q_OVERFLOW) {
+                    push_event("", change_kind::overflow);
+                    continue;
+                }
+                auto it = m_watches.find(ev->wd);
+                if (it == m_watches.end()) continue;
+                if (ev->mask & IN_IGNORED) {
+                    m_watches.erase(it);
+                    continue;
+                }
+                std::string path = it->second.m_path;
+                bool recursive = it->second.m_recursive;
+                if (ev->len > 0 && ev->name[0] != 0) {
+                    path += "/";
+                    path += ev->name;
+                }
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    push_event(path, change_kind::created);
+                    if (recursive && (ev->mask & IN_ISDIR)) add(path, true, true);
+                } else if (ev->mask & (IN_MOVED_FROM | IN_MOVE_SELF)) {
+                    push_event(path, change_kind::removed);
+                    remove(path);
+                } else if (ev->mask & (IN_DELETE | IN_DELETE_SELF)) {
+                    push_event(path, change_kind::removed);
+                } else {
+                    push_event(path, change_kind::modified);
+                }
+            }
+        }
+    }
+
+    /* Waits for events for at most `timeout_ms` milliseconds and sets `closed` if the watcher was closed while
+       waiting. Returns an `errno` value on failure. */
+    int poll_events(int timeout_ms, bool & closed) {
+        pollfd fds[2] = {{m_fd, POLLIN, 0}, {m_wake[0], POLLIN, 0}};
+        while (true) {
+            int r = poll(fds, 2, timeout_ms);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                return errno;
+            }
+            closed = fds[1].revents != 0;
+            if (fds[0].revents & (POLLERR | POLLNVAL)) return EIO;
+            return 0;
+        }
+    }
+};
+
+static lean_external_class * g_fs_watcher_external_class = nullptr;
+
+static void fs_watcher_finalizer(void * w) {
+    delete static_cast<fs_watcher *>(w);
+}
+
+static void fs_watcher_foreach(void *, b_obj_arg) {}
+
+static fs_watcher * fs_watcher_get(b_obj_arg w) {
+    return static_cast<fs_watcher *>(lean_get_external_data(w));
+}
+
+/* Watcher.new : IO Watcher */
+extern "C" LEAN_EXPORT obj_res lean_io_fs_watcher_new(obj_arg) {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return io_result_mk_error(decode_io_error(errno, nullptr));
+    int wake[2];
+    if (pipe2(wake, O_CLOEXEC) != 0) {
+        int err = errno;
+        close(fd);
+        return io_result_mk_error(decode_io_error(err, nullptr));
+    }
+    return io_result_mk_ok(lean_alloc_external(g_fs_watcher_external_class, new fs_watcher(fd, wake[0], wake[1])));
+}
+
+/* Watcher.add : (@& Watcher) → (@& FilePath) → (recursive : Bool) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_fs_watcher_add(b_obj_arg w, b_obj_arg path, uint8 recursive, obj_arg) {
+    fs_watcher * fw = fs_watcher_get(w);
+    std::string p(lean_string_cstr(path), lean_string_size(path) - 1);
+    while (p.size() > 1 && p.back() == '/') p.pop_back();
+    lock_guard<mutex> lock(fw->m_mutex);
+    if (fw->m_closed) return io_result_mk_error("watcher is closed");
+    if (int err = fw->add(p, recursive, false)) return io_result_mk_error(decode_io_error(err, path));
+    return io_result_mk_ok(box(0));
+}
+
+static obj_res mk_change_events(std::vector<std::pair<std::string, change_kind>> const & events) {
+    object * arr = lean_alloc_array(0, events.size());
+    for (auto const & e : events) {
+        object * o = lean_alloc_ctor(0, 1, sizeof(uint8));
+        lean_ctor_set(o, 0, mk_string(e.first));
+        lean_ctor_set_uint8(o, sizeof(object *), static_cast<uint8>(e.second));
+        arr = lean_array_push(arr, o);
+    }
+    return arr;
+}
+
+/* Watcher.wait : (@& Watcher) → (debounceMs : UInt32) → IO (Option (Array ChangeEvent)) */
+extern "C" LEAN_EXPORT obj_res lean_io_fs_watcher_wait(b_obj_arg w, uint32 debounce_ms, obj_arg) {
+    fs_watcher * fw = fs_watcher_get(w);
+    {
+        lock_guard<mutex> lock(fw->m_mutex);
+        if (fw->m_closed) return io_result_mk_ok(box(0));
+    }
+    // block until the first event, then collect more until nothing happened for `debounce_ms`
+    bool closed = false;
+    while (fw->m_events.empty()) {
+        if (int err = fw->poll_events(-1, closed)) return io_result_mk_error(decode_io_error(err, nullptr));
+        if (closed) return io_result_mk_ok(box(0));
+        fw->drain();
+    }
+    while (true) {
+        if (int err = fw->poll_events(debounce_ms, closed)) return io_result_mk_error(decode_io_error(err, nullptr));
+        if (closed || !fw->drain()) break;
+    }
+    object * arr = mk_change_events(fw->m_events);
+    fw->m_events.clear();
+    fw->m_event_idx.clear();
+    return io_result_mk_ok(mk_option_some(arr));
+}
+
+/* Watcher.close : (@& Watcher) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_fs_watcher_close(b_obj_arg w, obj_arg) {
+    fs_watcher * fw = fs_watcher_get(w);
+    lock_guard<mutex> lock(fw->m_mutex);
+    if (!fw->m_closed) {
+        fw->m_closed = true;
+        for (auto const & e : fw->m_watches) inotify_rm_watch(fw->m_fd, e.first);
+        fw->m_watches.clear();
+        char c = 0;
+        if (write(fw->m_wake[1], &c, 1) < 0) {}
+    }
+    return io_result_mk_ok(box(0));
+}
+
+void initialize_fswatch() {
+    g_fs_watcher_external_class = lean_register_external_class(fs_watcher_finalizer, fs_watcher_foreach);
+}
+
+#else
+
+static obj_res fs_watcher_unsupported() {
+    return io_result_mk_error(lean_mk_io_error_unsupported_operation(0, mk_string("filesystem watching is only supported on Linux")));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_fs_watcher_new(obj_arg) {
+    return fs_watcher_unsupported();
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_fs_watcher_add(b_obj_arg, b_obj_arg, uint8, obj_arg) {
+    return fs_watcher_unsupported();
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_fs_watcher_wait(b_obj_arg, uint32, obj_arg) {
+    return fs_watcher_unsupported();
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_fs_watcher_close(b_obj_arg, obj_arg) {
+    return fs_watcher_unsupported();
+}
+
+void initialize_fswatch() {
+}
+
+#endif
+
+void finalize_fswatch() {
+}
+
+}
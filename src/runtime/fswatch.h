@@ -0,0 +1,12 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+
+Author: agent
+*/
+#pragma once
+
+namespace lean {
+void initialize_fswatch();
+void finalize_fswatch();
+}
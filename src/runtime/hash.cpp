@@ -4,6 +4,9 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <cstdlib>
+#include <cstring>
+#include <random>
 #include "runtime/hash.h"
 
 namespace lean {
@@ -55,4 +58,84 @@ uint64 hash_str(size_t len, unsigned char const * str, uint64 init_value) {
     return MurmurHash64A(str, len, init_value);
 }
 
+//-----------------------------------------------------------------------------
+// wyhash (final version 4.2), by Wang Yi
+// https://github.com/wangyi-fudan/wyhash
+// Unlike `hash_str`, values of `hash_bytes` are never persisted, so we are free to change the function.
+
+static inline void wymum(uint64 * a, uint64 * b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = static_cast<__uint128_t>(*a) * *b;
+    *a = static_cast<uint64>(r);
+    *b = static_cast<uint64>(r >> 64);
+#else
+    uint64 ha = *a >> 32, hb = *b >> 32, la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+    uint64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+    uint64 c = t < rl;
+    uint64 lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64 hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    *a = lo;
+    *b = hi;
+#endif
+}
+
+static inline uint64 wymix(uint64 a, uint64 b) { wymum(&a, &b); return a ^ b; }
+static inline uint64 wyr8(unsigned char const * p) { uint64 v; memcpy(&v, p, 8); return v; }
+static inline uint64 wyr4(unsigned char const * p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64 wyr3(unsigned char const * p, size_t k) {
+    return (static_cast<uint64>(p[0]) << 16) | (static_cast<uint64>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+static uint64 const g_wyp[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+uint64 hash_bytes(size_t len, unsigned char const * p, uint64 seed) {
+    seed ^= wymix(seed ^ g_wyp[0], g_wyp[1]);
+    uint64 a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64 see1 = seed, see2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ g_wyp[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ g_wyp[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ g_wyp[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ g_wyp[1], wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+    a ^= g_wyp[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ g_wyp[0] ^ len, b ^ g_wyp[1]);
+}
+
+uint64 get_process_hash_seed() {
+    static uint64 seed = []() {
+        if (char const * s = std::getenv("LEAN_HASH_SEED"))
+            return static_cast<uint64>(std::strtoull(s, nullptr, 10));
+        std::random_device rd;
+        return (static_cast<uint64>(rd()) << 32) ^ static_cast<uint64>(rd());
+    }();
+    return seed;
+}
 }
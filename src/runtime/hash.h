@@ -10,8 +10,17 @@ Author: Leonardo de Moura
 
 namespace lean {
 
+/* MurmurHash64A. Its values are persisted (e.g., `String.hash` is used for the hash codes of names stored in
+   .olean files), so it must not be changed. */
 uint64 hash_str(size_t len, unsigned char const * str, uint64 init_value);
 
+/* Faster hash function for byte strings. Its values may change between Lean versions. */
+uint64 hash_bytes(size_t len, unsigned char const * str, uint64 seed);
+
+/* Seed for hash tables that must resist collision attacks. It is chosen at random when it is
+   first requested, unless the environment variable `LEAN_HASH_SEED` is set. */
+uint64 get_process_hash_seed();
+
 inline uint64 hash(uint64 h, uint64 k) {
     uint64 m = 0xc6a4a7935bd1e995;
     uint64 r = 47;
@@ -13,6 +13,8 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #elif defined(__APPLE__)
 #include <mach-o/dyld.h>
 #include <unistd.h>
+#include <stdio.h>
+#include <copyfile.h>
 #else
 #if defined(LEAN_EMSCRIPTEN)
 #include <emscripten.h>
@@ -21,12 +23,20 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include <unistd.h> // NOLINT
 #include <sys/mman.h>
 #include <sys/file.h>
+#include <sys/uio.h>
 #ifndef LEAN_EMSCRIPTEN
 #include <sys/random.h>
 #endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#endif
 #endif
 #ifndef LEAN_WINDOWS
 #include <csignal>
+#include <poll.h>
 #endif
 #include <dirent.h>
 #include <fcntl.h>
@@ -36,6 +46,9 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include <fstream>
 #include <iomanip>
 #include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
 #include <cstdlib>
 #include <cctype>
 #include <sys/stat.h>
@@ -46,6 +59,7 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include "runtime/object.h"
 #include "runtime/thread.h"
 #include "runtime/allocprof.h"
+#include "runtime/hash.h"
 
 #ifdef _MSC_VER
 #define S_ISDIR(mode) ((mode & _S_IFDIR) != 0)
@@ -485,28 +499,386 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write(b_obj_arg h, b_obj_arg
     }
 }
 
-/* Handle.getLine : (@& Handle) → IO Unit */
-extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_get_line(b_obj_arg h, obj_arg /* w */) {
+/* Positional and vectored I/O.
+
+   These functions use the file descriptor of the handle directly: they bypass the `FILE` buffer, and on Unix they do
+   not use or move the position of the handle, so several tasks can access disjoint regions of the same file. */
+
+#ifdef LEAN_WINDOWS
+/* Transfer up to `n` bytes at `offset`. Return the number of bytes transferred, or `-1` on error. Note that Windows
+   moves the position of synchronous handles. */
+static int64 transfer_some_at(FILE * fp, bool write, uint8 * buf, size_t n, uint64 offset) {
+    OVERLAPPED o = {0};
+    o.Offset     = static_cast<DWORD>(offset);
+    o.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD m = static_cast<DWORD>(std::min<size_t>(n, 1u << 30));
+    DWORD k = 0;
+    BOOL ok = write ? WriteFile(win_handle(fp), buf, m, &k, &o) : ReadFile(win_handle(fp), buf, m, &k, &o);
+    if (!ok)
+        return !write && GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    return k;
+}
+
+static obj_res mk_positional_io_error() {
+    return io_result_mk_error((sstream() << GetLastError()).str());
+}
+#else
+static obj_res mk_positional_io_error() {
+    return io_result_mk_error(decode_io_error(errno, nullptr));
+}
+#endif
+
+struct io_chunk {
+    uint8 * m_data;
+    size_t  m_size;
+};
+
+/* Transfer the chunks `cs[0, k)` in order, starting at `offset`. Reading stops early only at the end of the file.
+   Return the number of bytes transferred, or `-1` on error. */
+static int64 transfer_at(FILE * fp, bool write, io_chunk const * cs, size_t k, uint64 offset) {
+    int64 total = 0;
+    size_t i    = 0;
+    size_t done = 0; // bytes of `cs[i]` already transferred
+    while (true) {
+        while (i < k && done == cs[i].m_size) { i++; done = 0; }
+        if (i == k)
+            return total;
+        int64 r;
+#if defined(__linux__)
+        iovec iov[64];
+        size_t m = 0;
+        iov[m++] = iovec{cs[i].m_data + done, cs[i].m_size - done};
+        for (size_t j = i + 1; j < k && m < 64; j++)
+            iov[m++] = iovec{cs[j].m_data, cs[j].m_size};
+        do {
+            r = write ? pwritev(fileno(fp), iov, m, offset) : preadv(fileno(fp), iov, m, offset);
+        } while (r < 0 && errno == EINTR);
+#elif defined(LEAN_WINDOWS)
+        r = transfer_some_at(fp, write, cs[i].m_data + done, cs[i].m_size - done, offset);
+#else
+        do {
+            r = write ? pwrite(fileno(fp), cs[i].m_data + done, cs[i].m_size - done, offset)
+                      : pread(fileno(fp), cs[i].m_data + done, cs[i].m_size - done, offset);
+        } while (r < 0 && errno == EINTR);
+#endif
+        if (r < 0)
+            return -1;
+        if (r == 0) {
+            if (!write)
+                return total;
+#ifndef LEAN_WINDOWS
+            errno = EIO;
+#endif
+            return -1;
+        }
+        total  += r;
+        offset += r;
+        size_t left = r;
+        while (left > 0) {
+            size_t avail = cs[i].m_size - done;
+            if (left < avail) {
+                done += left;
+                left  = 0;
+            } else {
+                left -= avail;
+                i++;
+                done = 0;
+            }
+        }
+    }
+}
+
+/* Handle.readAt : (@& Handle) → UInt64 → USize → IO ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read_at(b_obj_arg h, uint64 offset, usize nbytes, obj_arg /* w */) {
+    obj_res res = lean_alloc_sarray(1, 0, nbytes);
+    io_chunk c{lean_sarray_cptr(res), nbytes};
+    int64 n = transfer_at(io_get_handle(h), false, &c, 1, offset);
+    if (n < 0) {
+        dec_ref(res);
+        return mk_positional_io_error();
+    }
+    lean_sarray_set_size(res, n);
+    return io_result_mk_ok(res);
+}
+
+/* Handle.writeAt : (@& Handle) → UInt64 → (@& ByteArray) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write_at(b_obj_arg h, uint64 offset, b_obj_arg buf, obj_arg /* w */) {
+    io_chunk c{lean_sarray_cptr(buf), lean_sarray_size(buf)};
+    if (transfer_at(io_get_handle(h), true, &c, 1, offset) < 0)
+        return mk_positional_io_error();
+    return io_result_mk_ok(box(0));
+}
+
+/* Handle.readvAt : (@& Handle) → UInt64 → (@& Array USize) → IO (Array ByteArray) */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_readv_at(b_obj_arg h, uint64 offset, b_obj_arg sizes, obj_arg /* w */) {
+    size_t k = array_size(sizes);
+    object * bufs = alloc_array(k, k);
+    std::vector<io_chunk> cs(k);
+    for (size_t i = 0; i < k; i++) {
+        size_t n = lean_unbox_usize(lean_array_get_core(sizes, i));
+        object * b = lean_alloc_sarray(1, 0, n);
+        lean_array_set_core(bufs, i, b);
+        cs[i] = io_chunk{lean_sarray_cptr(b), n};
+    }
+    int64 n = transfer_at(io_get_handle(h), false, cs.data(), k, offset);
+    if (n < 0) {
+        dec_ref(bufs);
+        return mk_positional_io_error();
+    }
+    size_t left = n;
+    for (size_t i = 0; i < k; i++) {
+        size_t m = std::min(left, cs[i].m_size);
+        lean_sarray_set_size(lean_array_get_core(bufs, i), m);
+        left -= m;
+    }
+    return io_result_mk_ok(bufs);
+}
+
+/* Handle.writevAt : (@& Handle) → UInt64 → (@& Array ByteArray) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_writev_at(b_obj_arg h, uint64 offset, b_obj_arg bufs, obj_arg /* w */) {
+    size_t k = array_size(bufs);
+    std::vector<io_chunk> cs(k);
+    for (size_t i = 0; i < k; i++) {
+        object * b = lean_array_get_core(bufs, i);
+        cs[i] = io_chunk{lean_sarray_cptr(b), lean_sarray_size(b)};
+    }
+    if (transfer_at(io_get_handle(h), true, cs.data(), k, offset) < 0)
+        return mk_positional_io_error();
+    return io_result_mk_ok(box(0));
+}
+
+/* Handle.advise : (@& Handle) → UInt64 → UInt64 → AccessAdvice → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_advise(b_obj_arg h, uint64 offset, uint64 len, uint8 advice, obj_arg /* w */) {
+#if defined(__linux__)
+    static int const advices[] = { POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL, POSIX_FADV_RANDOM, POSIX_FADV_WILLNEED, POSIX_FADV_DONTNEED };
+    lean_assert(advice < sizeof(advices) / sizeof(advices[0]));
+    int err = posix_fadvise(fileno(io_get_handle(h)), offset, len, advices[advice]);
+    if (err != 0)
+        return io_result_mk_error(decode_io_error(err, nullptr));
+#else
+    /* Advice is only a hint, and the other platforms do not have an equivalent for all of them. */
+    (void)h; (void)offset; (void)len; (void)advice;
+#endif
+    return io_result_mk_ok(box(0));
+}
+
+/* Handle.allocate : (@& Handle) → UInt64 → UInt64 → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_allocate(b_obj_arg h, uint64 offset, uint64 len, obj_arg /* w */) {
     FILE * fp = io_get_handle(h);
+#if defined(__linux__)
+    int err = posix_fallocate(fileno(fp), offset, len);
+    if (err != 0)
+        return io_result_mk_error(decode_io_error(err, nullptr));
+#elif defined(LEAN_WINDOWS)
+    __int64 sz = _filelengthi64(_fileno(fp));
+    if (sz < 0 || (static_cast<uint64>(sz) < offset + len && _chsize_s(_fileno(fp), offset + len) != 0))
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+#else
+    /* Without `posix_fallocate`, we only extend the file to cover the region, which does not reserve disk blocks. */
+    struct stat st;
+    if (fstat(fileno(fp), &st) != 0 ||
+        (static_cast<uint64>(st.st_size) < offset + len && ftruncate(fileno(fp), offset + len) != 0))
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+#endif
+    return io_result_mk_ok(box(0));
+}
 
-    std::string result;
-    int c; // Note: int, not char, required to handle EOF
-    while ((c = std::fgetc(fp)) != EOF) {
-        result.push_back(c);
-        if (c == '\n') {
-            break;
+/*
+  Reads lines from a `FILE*` into a reusable buffer. On POSIX we use `getline`, which locks the stream once
+  per line and splits on the stdio buffer with `memchr`, so the stream stays usable by the other handle
+  primitives. */
+struct line_reader {
+    FILE *  m_fp;
+    char *  m_buf  = nullptr;
+    size_t  m_cap  = 0;
+    size_t  m_size = 0;
+
+    explicit line_reader(FILE * fp):m_fp(fp) {}
+    ~line_reader() { free(m_buf); }
+
+#if defined(LEAN_WINDOWS)
+    void push(char c) {
+        if (m_size == m_cap) {
+            m_cap = m_cap == 0 ? 128 : 2 * m_cap;
+            m_buf = static_cast<char *>(realloc(m_buf, m_cap));
         }
+        m_buf[m_size++] = c;
     }
+#endif
 
-    if (std::ferror(fp)) {
+    /* Reads the next line including its terminator into `m_buf[0, m_size)`.
+       Returns false at end of file or on error, in which case `m_size` may still be positive for a last
+       line without terminator. */
+    bool next() {
+#if defined(LEAN_WINDOWS)
+        m_size = 0;
+        _lock_file(m_fp);
+        int c;
+        while ((c = _getc_nolock(m_fp)) != EOF) {
+            push(static_cast<char>(c));
+            if (c == '\n') break;
+        }
+        _unlock_file(m_fp);
+        return c != EOF;
+#else
+        ssize_t n = getline(&m_buf, &m_cap, m_fp);
+        m_size = n < 0 ? 0 : n;
+        return n > 0 && m_buf[n - 1] == '\n';
+#endif
+    }
+
+    /* Returns the error of the last `next`, or `nullptr` at end of file, resetting the end-of-file indicator
+       so that later reads see data appended in the meantime. */
+    obj_res error() {
+        if (std::ferror(m_fp)) {
+            return decode_io_error(errno, nullptr);
+        }
+        clearerr(m_fp);
+        return nullptr;
+    }
+};
+
+/* Creates a Lean string from `s[0, sz)`, replacing invalid UTF-8 by U+FFFD. Lines are usually ASCII, so we
+   check for that while copying and only run the full validation on the copy otherwise. */
+static obj_res mk_line_string(char const * s, size_t sz) {
+    object * r = lean_alloc_string(sz + 1, sz + 1, 0);
+    char * d = lean_to_string(r)->m_data;
+    uint64 hi = 0;
+    size_t i = 0;
+    for (; i + 8 <= sz; i += 8) {
+        uint64 w;
+        memcpy(&w, s + i, 8);
+        memcpy(d + i, &w, 8);
+        hi |= w;
+    }
+    for (; i < sz; i++) {
+        d[i] = s[i];
+        hi |= static_cast<uint8>(s[i]);
+    }
+    d[sz] = 0;
+    if ((hi & 0x8080808080808080ull) == 0) {
+        lean_to_string(r)->m_length = sz;
+        return r;
+    }
+    size_t pos = 0, len = 0;
+    if (validate_utf8(reinterpret_cast<uint8 const *>(d), sz, pos, len)) {
+        lean_to_string(r)->m_length = len;
+        return r;
+    }
+    lean_dec_ref(r);
+    return lean_mk_string_from_bytes(s, sz);
+}
+
+/* Handle.getLine : (@& Handle) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_get_line(b_obj_arg h, obj_arg /* w */) {
+    line_reader rd(io_get_handle(h));
+    if (!rd.next()) {
+        if (obj_res err = rd.error()) return io_result_mk_error(err);
+    }
+    return io_result_mk_ok(mk_line_string(rd.m_buf, rd.m_size));
+}
+
+/* Handle.readLines : (@& Handle) → USize → IO (Array String) */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read_lines(b_obj_arg h, usize max_lines, obj_arg /* w */) {
+    line_reader rd(io_get_handle(h));
+    object * lines = lean_alloc_array(0, std::min<usize>(max_lines, 1024));
+    while (lean_array_size(lines) < max_lines) {
+        bool more = rd.next();
+        size_t n = rd.m_size;
+        if (more) {
+            n--;
+            if (n > 0 && rd.m_buf[n - 1] == '\r') n--;
+        }
+        if (more || n > 0) {
+            lines = lean_array_push(lines, mk_line_string(rd.m_buf, n));
+        }
+        if (!more) {
+            if (obj_res err = rd.error()) {
+                lean_dec(lines);
+                return io_result_mk_error(err);
+            }
+            break;
+        }
+    }
+    return io_result_mk_ok(lines);
+}
+
+/* Handle.readAny : (@& Array Handle) → (timeoutMs : UInt32) → IO (Array (Nat × ByteArray)) */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read_any(b_obj_arg hs, uint32 timeout_ms, obj_arg /* w */) {
+    static constexpr size_t chunk_size = 64 * 1024;
+    size_t n = lean_array_size(hs);
+    object * res = lean_alloc_array(0, n);
+    auto push = [&](size_t i, obj_arg chunk) {
+        object * p = alloc_cnstr(0, 2, 0);
+        cnstr_set(p, 0, lean_usize_to_nat(i));
+        cnstr_set(p, 1, chunk);
+        res = lean_array_push(res, p);
+    };
+#if defined(LEAN_WINDOWS)
+    // anonymous pipes cannot be waited on, so we poll them with increasing delays
+    auto start = std::chrono::steady_clock::now();
+    DWORD delay = 1;
+    while (true) {
+        for (size_t i = 0; i < n; i++) {
+            HANDLE h = win_handle(io_get_handle(lean_array_get_core(hs, i)));
+            DWORD avail = 0;
+            if (!PeekNamedPipe(h, nullptr, 0, nullptr, &avail, nullptr)) {
+                if (GetLastError() == ERROR_BROKEN_PIPE) {
+                    push(i, lean_alloc_sarray(1, 0, 0));
+                    continue;
+                }
+                // not a pipe: a read does not block for long
+                avail = chunk_size;
+            }
+            if (avail == 0) continue;
+            DWORD to_read = std::min<DWORD>(avail, chunk_size);
+            object * chunk = lean_alloc_sarray(1, 0, to_read);
+            DWORD got = 0;
+            if (!ReadFile(h, lean_sarray_cptr(chunk), to_read, &got, nullptr) && GetLastError() != ERROR_BROKEN_PIPE) {
+                lean_dec(chunk);
+                lean_dec(res);
+                return io_result_mk_error((sstream() << GetLastError()).str());
+            }
+            lean_to_sarray(chunk)->m_size = got;
+            push(i, chunk);
+        }
+        if (lean_array_size(res) > 0) break;
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        if (timeout_ms != UINT32_MAX && elapsed >= timeout_ms) break;
+        Sleep(delay);
+        delay = std::min<DWORD>(2 * delay, 16);
+    }
+    return io_result_mk_ok(res);
+#else
+    std::vector<pollfd> fds(n);
+    for (size_t i = 0; i < n; i++) {
+        fds[i].fd = fileno(io_get_handle(lean_array_get_core(hs, i)));
+        fds[i].events = POLLIN;
+    }
+    int r;
+    do {
+        r = poll(fds.data(), n, timeout_ms == UINT32_MAX ? -1 : static_cast<int>(std::min<uint32>(timeout_ms, INT32_MAX)));
+    } while (r < 0 && errno == EINTR);
+    if (r < 0) {
+        lean_dec(res);
         return io_result_mk_error(decode_io_error(errno, nullptr));
-    } else if (std::feof(fp)) {
-        clearerr(fp);
-        return io_result_mk_ok(mk_string(result));
-    } else {
-        obj_res ret = io_result_mk_ok(mk_string(result));
-        return ret;
     }
+    for (size_t i = 0; i < n && r > 0; i++) {
+        if (fds[i].revents == 0) continue;
+        object * chunk = lean_alloc_sarray(1, 0, chunk_size);
+        ssize_t got = read(fds[i].fd, lean_sarray_cptr(chunk), chunk_size);
+        if (got < 0) {
+            int err = errno;
+            lean_dec(chunk);
+            if (err == EAGAIN || err == EINTR) continue;
+            lean_dec(res);
+            return io_result_mk_error(decode_io_error(err, nullptr));
+        }
+        lean_to_sarray(chunk)->m_size = got;
+        push(i, chunk);
+    }
+    return io_result_mk_ok(res);
+#endif
 }
 
 /* Handle.putStr : (@& Handle) → (@& String) → IO Unit */
@@ -537,6 +909,11 @@ extern "C" LEAN_EXPORT obj_res lean_io_mono_nanos_now(obj_arg /* w */) {
     return io_result_mk_ok(uint64_to_nat(tm.count()));
 }
 
+/* hashSeed : BaseIO UInt64 */
+extern "C" LEAN_EXPORT obj_res lean_io_hash_seed(obj_arg /* w */) {
+    return io_result_mk_ok(box_uint64(get_process_hash_seed()));
+}
+
 /* getRandomBytes (nBytes : USize) : IO ByteArray */
 extern "C" LEAN_EXPORT obj_res lean_io_get_random_bytes (size_t nbytes, obj_arg /* w */) {
     // Adapted from https://github.com/rust-random/getrandom/blob/30308ae845b0bf3839e5a92120559eaf56048c28/src/
@@ -757,11 +1134,17 @@ static obj_res timespec_to_obj(timespec const & ts) {
     return o;
 }
 
-extern "C" LEAN_EXPORT obj_res lean_io_metadata(b_obj_arg fname, obj_arg) {
-    struct stat st;
-    if (stat(string_cstr(fname), &st) != 0) {
-        return io_result_mk_error(decode_io_error(errno, fname));
-    }
+static uint8 file_type_of_mode(unsigned mode) {
+    return
+        S_ISDIR(mode) ? 0 :
+        S_ISREG(mode) ? 1 :
+#ifndef LEAN_WINDOWS
+        S_ISLNK(mode) ? 2 :
+#endif
+        3;
+}
+
+static obj_res metadata_to_obj(struct stat const & st) {
     object * mdata = alloc_cnstr(0, 2, sizeof(uint64) + sizeof(uint8));
 #ifdef __APPLE__
     cnstr_set(mdata, 0, timespec_to_obj(st.st_atimespec));
@@ -775,14 +1158,264 @@ extern "C" LEAN_EXPORT obj_res lean_io_metadata(b_obj_arg fname, obj_arg) {
     cnstr_set(mdata, 1, timespec_to_obj(st.st_mtim));
 #endif
     cnstr_set_uint64(mdata, 2 * sizeof(object *), st.st_size);
-    cnstr_set_uint8(mdata, 2 * sizeof(object *) + sizeof(uint64),
-                    S_ISDIR(st.st_mode) ? 0 :
-                    S_ISREG(st.st_mode) ? 1 :
-#ifndef LEAN_WINDOWS
-                    S_ISLNK(st.st_mode) ? 2 :
+    cnstr_set_uint8(mdata, 2 * sizeof(object *) + sizeof(uint64), file_type_of_mode(st.st_mode));
+    return mdata;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_metadata(b_obj_arg fname, obj_arg) {
+    struct stat st;
+    if (stat(string_cstr(fname), &st) != 0) {
+        return io_result_mk_error(decode_io_error(errno, fname));
+    }
+    return io_result_mk_ok(metadata_to_obj(st));
+}
+
+/*
+  Recursive directory walk. Directories are scanned by a small pool of threads sharing a work stack.
+  The entries are collected as plain C++ data and only converted to Lean objects on the calling thread. */
+
+#if defined(__linux__)
+/* Layout of the records returned by the `getdents64` system call. */
+struct linux_dirent64 {
+    uint64        d_ino;
+    int64         d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char          d_name[1];
+};
+#endif
+
+class dir_walker {
+    struct entry {
+        std::string m_path;
+        uint8       m_type; // `FileType`
+        bool        m_has_stat;
+        struct stat m_stat;
+    };
+
+    /* (device, inode) of the directories on the path to a directory, to detect cycles when following links */
+    struct ancestor {
+        uint64                          m_dev;
+        uint64                          m_ino;
+        std::shared_ptr<ancestor const> m_parent;
+    };
+
+    struct dir_item {
+        std::string                     m_path;
+        std::shared_ptr<ancestor const> m_ancestors;
+    };
+
+    std::string const &              m_root;
+    bool                             m_metadata;
+    bool                             m_follow;
+    mutex                            m_mutex;
+    condition_variable               m_cv;
+    std::vector<dir_item>                 m_todo;
+    unsigned                         m_busy = 0;
+    int                              m_errno = 0;
+    std::string                      m_error_path;
+    std::vector<std::vector<entry>>  m_results;
+
+    static bool is_path_separator(char c) {
+#if defined(LEAN_WINDOWS)
+        return c == '/' || c == '\\';
+#else
+        return c == '/';
+#endif
+    }
+
+    static uint8 file_type_of_dirent(unsigned char d_type) {
+#if defined(DT_DIR)
+        switch (d_type) {
+        case DT_DIR: return 0;
+        case DT_REG: return 1;
+        case DT_LNK: return 2;
+        case DT_UNKNOWN: return 255;
+        default: return 3;
+        }
+#else
+        return 255;
 #endif
-                    3);
-    return io_result_mk_ok(mdata);
+    }
+
+    /* Returns the ancestors of the subdirectories of `d` with status `st`, or `nullptr` if `d` is its own
+       ancestor, i.e. we reached it through a cyclic link. */
+    static std::shared_ptr<ancestor const> enter(dir_item const & d, struct stat const & st) {
+        for (ancestor const * a = d.m_ancestors.get(); a; a = a->m_parent.get()) {
+            if (a->m_dev == static_cast<uint64>(st.st_dev) && a->m_ino == static_cast<uint64>(st.st_ino)) return nullptr;
+        }
+        return std::make_shared<ancestor const>(ancestor{static_cast<uint64>(st.st_dev), static_cast<uint64>(st.st_ino), d.m_ancestors});
+    }
+
+    /* Adds the entry `name` of `dir` to `out`, and to `subdirs` if it is a directory to descend into.
+       `type` is the type reported by the directory listing, or 255 if unknown. */
+    int add_entry(int dfd, std::string const & dir, std::shared_ptr<ancestor const> const & ancestors,
+                  char const * name, uint8 type, std::vector<entry> & out, std::vector<dir_item> & subdirs) {
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) return 0;
+        entry e;
+        e.m_path = dir;
+        if (e.m_path.empty() || !is_path_separator(e.m_path.back())) e.m_path += '/';
+        e.m_path += name;
+        e.m_type = type;
+        e.m_has_stat = false;
+        if (type == 255 || m_metadata || (m_follow && type == 2)) {
+#if defined(LEAN_WINDOWS)
+            (void)dfd;
+            int r = stat(e.m_path.c_str(), &e.m_stat);
+#else
+            int r = fstatat(dfd, name, &e.m_stat, AT_SYMLINK_NOFOLLOW);
+#endif
+            if (r != 0) {
+                // entry vanished, ignore
+                return errno == ENOENT ? 0 : errno;
+            }
+            e.m_has_stat = true;
+            e.m_type = file_type_of_mode(e.m_stat.st_mode);
+        }
+        if (m_follow && e.m_type == 2) {
+            struct stat st;
+            // a dangling link stays a `symlink`
+            if (stat(e.m_path.c_str(), &st) == 0) {
+                e.m_stat = st;
+                e.m_type = file_type_of_mode(st.st_mode);
+            }
+        }
+        if (e.m_type == 0) subdirs.push_back(dir_item{e.m_path, ancestors});
+        out.push_back(std::move(e));
+        return 0;
+    }
+
+    int scan(dir_item const & d, std::vector<entry> & out, std::vector<dir_item> & subdirs) {
+        std::shared_ptr<ancestor const> ancestors;
+#if defined(__linux__)
+        int fd = open(d.m_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) return errno;
+        if (m_follow) {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && !(ancestors = enter(d, st))) {
+                close(fd);
+                return 0;
+            }
+        }
+        alignas(linux_dirent64) char buf[64 * 1024];
+        int err = 0;
+        while (true) {
+            long n = syscall(SYS_getdents64, fd, buf, sizeof(buf));
+            if (n < 0) { err = errno; break; }
+            if (n == 0) break;
+            for (long off = 0; off < n && err == 0;) {
+                linux_dirent64 * e = reinterpret_cast<linux_dirent64 *>(buf + off);
+                off += e->d_reclen;
+                err = add_entry(fd, d.m_path, ancestors, e->d_name, file_type_of_dirent(e->d_type), out, subdirs);
+            }
+            if (err) break;
+        }
+        close(fd);
+        return err;
+#else
+        DIR * dp = opendir(d.m_path.c_str());
+        if (!dp) return errno;
+#if defined(LEAN_WINDOWS)
+        int dfd = -1;
+#else
+        int dfd = dirfd(dp);
+        if (m_follow) {
+            struct stat st;
+            if (fstat(dfd, &st) == 0 && !(ancestors = enter(d, st))) {
+                closedir(dp);
+                return 0;
+            }
+        }
+#endif
+        int err = 0;
+        while (dirent * e = readdir(dp)) {
+#if defined(DT_DIR)
+            uint8 type = file_type_of_dirent(e->d_type);
+#else
+            uint8 type = 255;
+#endif
+            if ((err = add_entry(dfd, d.m_path, ancestors, e->d_name, type, out, subdirs))) break;
+        }
+        closedir(dp);
+        return err;
+#endif
+    }
+
+    void worker(std::vector<entry> & out) {
+        std::vector<dir_item> subdirs;
+        unique_lock<mutex> lock(m_mutex);
+        while (true) {
+            m_cv.wait(lock, [&]() { return !m_todo.empty() || m_busy == 0 || m_errno != 0; });
+            if (m_todo.empty() || m_errno != 0) break;
+            dir_item d = std::move(m_todo.back());
+            m_todo.pop_back();
+            m_busy++;
+            lock.unlock();
+            subdirs.clear();
+            int err = scan(d, out, subdirs);
+            // directories vanishing during the walk are ignored like entries
+            if (err == ENOENT && d.m_path != m_root) err = 0;
+            lock.lock();
+            m_busy--;
+            if (err != 0 && m_errno == 0) {
+                m_errno = err;
+                m_error_path = d.m_path;
+            }
+            for (dir_item & s : subdirs) m_todo.push_back(std::move(s));
+            m_cv.notify_all();
+        }
+        m_cv.notify_all();
+    }
+
+public:
+    dir_walker(std::string const & root, bool metadata, bool follow):
+        m_root(root), m_metadata(metadata), m_follow(follow) {}
+
+    obj_res run(unsigned num_threads) {
+        m_todo.push_back(dir_item{m_root, nullptr});
+        m_results.resize(num_threads);
+        std::vector<std::unique_ptr<lthread>> threads;
+        for (unsigned i = 1; i < num_threads; i++) {
+            threads.emplace_back(new lthread([this, i]() { worker(m_results[i]); }));
+        }
+        worker(m_results[0]);
+        for (auto & t : threads) t->join();
+        if (m_errno != 0) {
+            object * fname = mk_string(m_error_path);
+            object * err = decode_io_error(m_errno, fname);
+            lean_dec(fname);
+            return io_result_mk_error(err);
+        }
+        std::vector<entry *> all;
+        for (auto & r : m_results)
+            for (entry & e : r)
+                all.push_back(&e);
+        std::sort(all.begin(), all.end(), [](entry * a, entry * b) { return a->m_path < b->m_path; });
+        object * arr = lean_alloc_array(0, all.size());
+        for (entry * e : all) {
+            object * o = alloc_cnstr(0, 2, sizeof(uint8));
+            cnstr_set(o, 0, mk_string(e->m_path));
+            if (m_metadata) {
+                object * some = alloc_cnstr(1, 1, 0);
+                cnstr_set(some, 0, metadata_to_obj(e->m_stat));
+                cnstr_set(o, 1, some);
+            } else {
+                cnstr_set(o, 1, box(0));
+            }
+            cnstr_set_uint8(o, 2 * sizeof(object *), e->m_type);
+            arr = lean_array_push(arr, o);
+        }
+        return io_result_mk_ok(arr);
+    }
+};
+
+/* walkDirEntriesCore (root : @& FilePath) (metadata followSymlinks : Bool) (threads : USize) : IO (Array WalkEntry) */
+extern "C" LEAN_EXPORT obj_res lean_io_walk_dir(b_obj_arg root, uint8 metadata, uint8 follow_symlinks, usize threads, obj_arg) {
+    std::string r(string_cstr(root), lean_string_size(root) - 1);
+    unsigned n = threads == 0 ? std::min(hardware_concurrency(), 8u) : static_cast<unsigned>(std::min<usize>(threads, 64));
+    if (n == 0) n = 1;
+    dir_walker walker(r, metadata, follow_symlinks);
+    return walker.run(n);
 }
 
 extern "C" LEAN_EXPORT obj_res lean_io_create_dir(b_obj_arg p, obj_arg) {
@@ -828,6 +1461,140 @@ extern "C" LEAN_EXPORT obj_res lean_io_rename(b_obj_arg from, b_obj_arg to, lean
     return io_result_mk_ok(box(0));
 }
 
+#if !defined(LEAN_WINDOWS) && !defined(__APPLE__)
+/* Copies the contents of `in` to `out`, preferring copies that do not pass through user space. */
+static int copy_fd(int in, int out, size_t size) {
+#if defined(__linux__)
+    // share the extents if the filesystem supports it (btrfs, XFS, ...)
+    if (ioctl(out, FICLONE, in) == 0) return 0;
+    size_t done = 0;
+#if defined(SYS_copy_file_range)
+    while (done < size) {
+        ssize_t n = syscall(SYS_copy_file_range, in, nullptr, out, nullptr, size - done, 0);
+        if (n <= 0) break;
+        done += n;
+    }
+#endif
+    while (done < size) {
+        ssize_t n = sendfile(out, in, nullptr, size - done);
+        if (n <= 0) break;
+        done += n;
+    }
+    // the file may have grown since `fstat`, or both calls above may be unsupported for this pair of files
+#else
+    (void)size;
+#endif
+    std::vector<char> buf(64 * 1024);
+    while (true) {
+        ssize_t n = read(in, buf.data(), buf.size());
+        if (n < 0) return errno;
+        if (n == 0) return 0;
+        for (ssize_t off = 0; off < n;) {
+            ssize_t m = write(out, buf.data() + off, n - off);
+            if (m < 0) return errno;
+            off += m;
+        }
+    }
+}
+#endif
+
+/* copyFile (src dst : @& FilePath) : IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_copy_file(b_obj_arg src, b_obj_arg dst, obj_arg) {
+#if defined(LEAN_WINDOWS)
+    if (!CopyFile(string_cstr(src), string_cstr(dst), FALSE)) {
+        return io_result_mk_error((sstream()
+            << "failed to copy '" << string_cstr(src) << "' to '" << string_cstr(dst) << "': " << GetLastError()).str());
+    }
+    return io_result_mk_ok(box(0));
+#elif defined(__APPLE__)
+    struct stat src_st, dst_st;
+    if (stat(string_cstr(src), &src_st) == 0 && stat(string_cstr(dst), &dst_st) == 0 &&
+        src_st.st_dev == dst_st.st_dev && src_st.st_ino == dst_st.st_ino) {
+        return io_result_mk_error(decode_io_error(EINVAL, dst));
+    }
+    // clones the file on APFS, and copies it otherwise
+    if (copyfile(string_cstr(src), string_cstr(dst), nullptr, COPYFILE_CLONE) != 0) {
+        return io_result_mk_error(decode_io_error(errno, src));
+    }
+    return io_result_mk_ok(box(0));
+#else
+    int in = open(string_cstr(src), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return io_result_mk_error(decode_io_error(errno, src));
+    struct stat st;
+    if (fstat(in, &st) != 0) {
+        int err = errno;
+        close(in);
+        return io_result_mk_error(decode_io_error(err, src));
+    }
+    // `dst` is only truncated once we know that it is not `src`, and its mode is set explicitly as the mode
+    // passed to `open` only applies to new files and is subject to the umask
+    int out = open(string_cstr(dst), O_WRONLY | O_CREAT | O_CLOEXEC, st.st_mode & 07777);
+    if (out < 0) {
+        int err = errno;
+        close(in);
+        return io_result_mk_error(decode_io_error(err, dst));
+    }
+    struct stat out_st;
+    int err = 0;
+    if (fstat(out, &out_st) != 0) {
+        err = errno;
+    } else if (out_st.st_dev == st.st_dev && out_st.st_ino == st.st_ino) {
+        err = EINVAL;
+    } else if (ftruncate(out, 0) != 0 || fchmod(out, st.st_mode & 07777) != 0) {
+        err = errno;
+    }
+    if (err != 0) {
+        close(in);
+        close(out);
+        return io_result_mk_error(decode_io_error(err, dst));
+    }
+    err = copy_fd(in, out, st.st_size);
+    close(in);
+    if (close(out) != 0 && err == 0) err = errno;
+    if (err != 0) return io_result_mk_error(decode_io_error(err, dst));
+    return io_result_mk_ok(box(0));
+#endif
+}
+
+/* hardLink (orig link : @& FilePath) : IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_hard_link(b_obj_arg orig, b_obj_arg link_path, obj_arg) {
+#if defined(LEAN_WINDOWS)
+    if (!CreateHardLink(string_cstr(link_path), string_cstr(orig), nullptr)) {
+        return io_result_mk_error((sstream()
+            << "failed to link '" << string_cstr(link_path) << "' to '" << string_cstr(orig) << "': " << GetLastError()).str());
+    }
+#else
+    if (link(string_cstr(orig), string_cstr(link_path)) != 0) {
+        return io_result_mk_error(decode_io_error(errno, errno == ENOENT ? orig : link_path));
+    }
+#endif
+    return io_result_mk_ok(box(0));
+}
+
+/* renameExchange (a b : @& FilePath) : IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_rename_exchange(b_obj_arg a, b_obj_arg b, obj_arg) {
+#if defined(__linux__) && defined(SYS_renameat2)
+    if (syscall(SYS_renameat2, AT_FDCWD, string_cstr(a), AT_FDCWD, string_cstr(b), RENAME_EXCHANGE) != 0) {
+        std::ostringstream s;
+        s << string_cstr(a) << " and/or " << string_cstr(b);
+        object_ref out{mk_string(s.str())};
+        return io_result_mk_error(decode_io_error(errno, out.raw()));
+    }
+    return io_result_mk_ok(box(0));
+#elif defined(__APPLE__)
+    if (renamex_np(string_cstr(a), string_cstr(b), RENAME_SWAP) != 0) {
+        std::ostringstream s;
+        s << string_cstr(a) << " and/or " << string_cstr(b);
+        object_ref out{mk_string(s.str())};
+        return io_result_mk_error(decode_io_error(errno, out.raw()));
+    }
+    return io_result_mk_ok(box(0));
+#else
+    (void)a; (void)b;
+    return io_result_mk_error(lean_mk_io_error_unsupported_operation(0, mk_string("atomic exchange of paths is not supported on this platform")));
+#endif
+}
+
 /* createTempFile : IO (Handle × FilePath) */
 extern "C" LEAN_EXPORT obj_res lean_io_create_tempfile(lean_object * /* w */) {
     char path[PATH_MAX];
@@ -879,6 +1646,70 @@ extern "C" LEAN_EXPORT obj_res lean_io_create_tempfile(lean_object * /* w */) {
     }
 }
 
+/* Read all of `fp` into a fresh byte array. */
+static obj_res read_file_to_end(FILE * fp) {
+    size_t cap = 64 * 1024;
+    object * r = lean_alloc_sarray(1, 0, cap);
+    size_t sz  = 0;
+    while (true) {
+        size_t n = std::fread(lean_sarray_cptr(r) + sz, 1, cap - sz, fp);
+        sz += n;
+        lean_sarray_set_size(r, sz);
+        if (sz < cap) {
+            if (std::ferror(fp)) {
+                dec_ref(r);
+                return nullptr;
+            }
+            return r;
+        }
+        cap *= 2;
+        object * new_r = lean_alloc_sarray(1, sz, cap);
+        memcpy(lean_sarray_cptr(new_r), lean_sarray_cptr(r), sz);
+        dec_ref(r);
+        r = new_r;
+    }
+}
+
+/* mmapFile : (@& FilePath) → IO ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_io_mmap_file(b_obj_arg fname, obj_arg) {
+#ifdef LEAN_MAPPED_SARRAY
+    int fd = open(string_cstr(fname), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return io_result_mk_error(decode_io_error(errno, fname));
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        return io_result_mk_error(decode_io_error(err, fname));
+    }
+    /* Files such as pipes and `/proc` entries cannot be mapped or do not report their size, so we read them. */
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        object * r = alloc_mapped_byte_array(fd, st.st_size);
+        int err = errno;
+        close(fd);
+        if (r == nullptr)
+            return io_result_mk_error(decode_io_error(err, fname));
+        return io_result_mk_ok(r);
+    }
+    FILE * fp = fdopen(fd, "rb");
+    if (fp == nullptr) {
+        int err = errno;
+        close(fd);
+        return io_result_mk_error(decode_io_error(err, fname));
+    }
+#else
+    FILE * fp = std::fopen(string_cstr(fname), "rb");
+    if (fp == nullptr)
+        return io_result_mk_error(decode_io_error(errno, fname));
+#endif
+    object * r = read_file_to_end(fp);
+    int err = errno;
+    std::fclose(fp);
+    if (r == nullptr)
+        return io_result_mk_error(decode_io_error(err, fname));
+    return io_result_mk_ok(r);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_remove_file(b_obj_arg fname, obj_arg) {
     if (std::remove(string_cstr(fname)) == 0) {
         return io_result_mk_ok(box(0));
@@ -0,0 +1,987 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+
+Author: agent
+
+Native implementation of `Lean.Json` parsing and printing, and of its binary encoding.
+*/
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define LEAN_JSON_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LEAN_JSON_NEON
+#endif
+#include "runtime/object.h"
+#include "runtime/object_ref.h"
+#include "runtime/utf8.h"
+
+namespace lean {
+
+/*
+inductive Json where
+  | null
+  | bool (b : Bool)
+  | num (n : JsonNumber)
+  | str (s : String)
+  | arr (elems : Array Json)
+  | obj (kvPairs : RBNode String (fun _ => Json))
+*/
+enum class json_kind : unsigned { null, bool_, num, str, arr, obj };
+
+static obj_res mk_json_bool(bool b) {
+    object * r = lean_alloc_ctor(static_cast<unsigned>(json_kind::bool_), 0, 1);
+    lean_ctor_set_uint8(r, 0, b);
+    return r;
+}
+
+static obj_res mk_json(json_kind k, obj_arg o) {
+    object * r = lean_alloc_ctor(static_cast<unsigned>(k), 1, 0);
+    lean_ctor_set(r, 0, o);
+    return r;
+}
+
+/* `JsonNumber.mk (mantissa : Int) (exponent : Nat)` */
+static obj_res mk_json_num(obj_arg mantissa, obj_arg exponent) {
+    object * n = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(n, 0, mantissa);
+    lean_ctor_set(n, 1, exponent);
+    return mk_json(json_kind::num, n);
+}
+
+static json_kind json_kind_of(b_obj_arg j) {
+    return static_cast<json_kind>(lean_obj_tag(j));
+}
+
+static char const * json_str_data(b_obj_arg s) { return lean_string_cstr(s); }
+static size_t json_str_size(b_obj_arg s) { return lean_string_size(s) - 1; }
+
+/* `String` order, i.e. lexicographic order on code points, which coincides with the byte order of UTF-8. */
+static int json_key_cmp(b_obj_arg k1, b_obj_arg k2) {
+    size_t n1 = json_str_size(k1), n2 = json_str_size(k2);
+    int c = memcmp(json_str_data(k1), json_str_data(k2), std::min(n1, n2));
+    if (c != 0) return c;
+    return n1 < n2 ? -1 : (n1 > n2 ? 1 : 0);
+}
+
+/*
+inductive RBNode (α : Type u) (β : α → Type v) where
+  | leaf
+  | node (color : RBColor) (lchild : RBNode α β) (key : α) (val : β key) (rchild : RBNode α β)
+*/
+enum class rb_color : uint8 { red, black };
+
+static obj_res mk_rb_node(rb_color c, obj_arg l, obj_arg k, obj_arg v, obj_arg r) {
+    object * n = lean_alloc_ctor(1, 4, 1);
+    lean_ctor_set(n, 0, l);
+    lean_ctor_set(n, 1, k);
+    lean_ctor_set(n, 2, v);
+    lean_ctor_set(n, 3, r);
+    lean_ctor_set_uint8(n, 4 * sizeof(object *), static_cast<uint8>(c));
+    return n;
+}
+
+/* Builds a balanced red-black tree from the key-value pairs `kvs[lo, hi)`, which are sorted by key and
+   unique. Nodes on the lowest level are red if that level is not full, all other nodes are black. */
+static obj_res mk_rb_tree(object * const * kvs, size_t lo, size_t hi, unsigned depth, unsigned red_depth) {
+    if (lo >= hi) return box(0);
+    size_t mid = lo + (hi - lo - 1) / 2;
+    object * l = mk_rb_tree(kvs, lo, mid, depth + 1, red_depth);
+    object * r = mk_rb_tree(kvs, mid + 1, hi, depth + 1, red_depth);
+    rb_color c = depth == red_depth ? rb_color::red : rb_color::black;
+    return mk_rb_node(c, l, kvs[2*mid], kvs[2*mid + 1], r);
+}
+
+static void rb_fields(b_obj_arg n, std::vector<object *> & out) {
+    while (!lean_is_scalar(n)) {
+        rb_fields(lean_ctor_get(n, 0), out);
+        out.push_back(lean_ctor_get(n, 1));
+        out.push_back(lean_ctor_get(n, 2));
+        n = lean_ctor_get(n, 3);
+    }
+}
+
+/* Assembles nested arrays and objects without recursion. The elements of all open containers are kept
+   on one stack; the elements of an object alternate between keys and values. */
+class json_builder {
+    struct frame {
+        bool   m_obj;
+        size_t m_base;
+    };
+    std::vector<frame>    m_frames;
+    std::vector<object *> m_items;
+public:
+    ~json_builder() {
+        for (object * o : m_items) lean_dec(o);
+    }
+
+    bool empty() const { return m_frames.empty(); }
+    bool in_object() const { return m_frames.back().m_obj; }
+    /* Number of items pushed to the innermost container. */
+    size_t size() const { return m_items.size() - m_frames.back().m_base; }
+    b_obj_arg back(size_t i) const { return m_items[m_items.size() - 1 - i]; }
+
+    void open(bool obj) { m_frames.push_back(frame{obj, m_items.size()}); }
+    void push(obj_arg o) { m_items.push_back(o); }
+
+    obj_res close_array() {
+        size_t base = m_frames.back().m_base;
+        size_t n = m_items.size() - base;
+        object * arr = lean_alloc_array(n, n);
+        memcpy(lean_array_cptr(arr), m_items.data() + base, n * sizeof(object *));
+        m_items.resize(base);
+        m_frames.pop_back();
+        return mk_json(json_kind::arr, arr);
+    }
+
+    /* As with repeated `RBNode.insert`, the last value of a duplicate key wins. */
+    obj_res close_object() {
+        size_t base = m_frames.back().m_base;
+        size_t n = (m_items.size() - base) / 2;
+        object ** kvs = m_items.data() + base;
+        bool sorted = true;
+        for (size_t i = 1; i < n && sorted; i++)
+            sorted = json_key_cmp(kvs[2*(i-1)], kvs[2*i]) < 0;
+        if (!sorted) {
+            std::vector<std::pair<object *, object *>> fields(n);
+            for (size_t i = 0; i < n; i++) fields[i] = {kvs[2*i], kvs[2*i + 1]};
+            std::stable_sort(fields.begin(), fields.end(), [](auto const & a, auto const & b) {
+                return json_key_cmp(a.first, b.first) < 0;
+            });
+            size_t m = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (i + 1 < n && json_key_cmp(fields[i].first, fields[i + 1].first) == 0) {
+                    lean_dec(fields[i].first);
+                    lean_dec(fields[i].second);
+                    continue;
+                }
+                kvs[2*m]     = fields[i].first;
+                kvs[2*m + 1] = fields[i].second;
+                m++;
+            }
+            n = m;
+        }
+        unsigned height = 0;
+        for (size_t k = n; k > 0; k /= 2) height++;
+        unsigned red_depth = n == (static_cast<size_t>(1) << height) - 1 ? 0 : height;
+        object * t = mk_rb_tree(kvs, 0, n, 1, red_depth);
+        m_items.resize(base);
+        m_frames.pop_back();
+        return mk_json(json_kind::obj, t);
+    }
+};
+
+static bool is_json_special(unsigned char c) {
+    return c == '"' || c == '\\' || c < 0x20;
+}
+
+/* Returns a pointer to the first `"`, `\` or control character in `[it, end)`, or `end`. These are the
+   characters that end a run of plain characters in a JSON string, both when parsing and when printing. */
+static char const * find_json_special(char const * it, char const * end) {
+#if defined(LEAN_JSON_SSE2)
+    __m128i const quote  = _mm_set1_epi8('"');
+    __m128i const bslash = _mm_set1_epi8('\\');
+    __m128i const ctrl   = _mm_set1_epi8(0x1f);
+    for (; it + 16 <= end; it += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                                 _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v));
+        if (int mask = _mm_movemask_epi8(m))
+            return it + __builtin_ctz(mask);
+    }
+#elif defined(LEAN_JSON_NEON)
+    for (; it + 16 <= end; it += 16) {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<uint8_t const *>(it));
+        uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')), vceqq_u8(v, vdupq_n_u8('\\'))),
+                                vcltq_u8(v, vdupq_n_u8(0x20)));
+        if (vmaxvq_u8(m) != 0) break;
+    }
+#endif
+    uint64_t const ones = 0x0101010101010101ull;
+    uint64_t const high = 0x8080808080808080ull;
+    for (; it + 8 <= end; it += 8) {
+        uint64_t w;
+        memcpy(&w, it, 8);
+        uint64_t q = w ^ (ones * '"');
+        uint64_t b = w ^ (ones * '\\');
+        /* a byte of `x` is zero (resp. smaller than 0x20) iff the high bit of `x - ones` (resp.
+           `x - 0x20 * ones`) is set there while it is not set in `x`, up to the first such byte */
+        if ((((q - ones) & ~q) | ((b - ones) & ~b) | ((w - 0x20 * ones) & ~w)) & high) break;
+    }
+    for (; it < end; it++) {
+        if (is_json_special(*it)) return it;
+    }
+    return end;
+}
+
+static char const g_hex_digits[] = "0123456789abcdef";
+
+/* Appends the body of a JSON string literal for `s[0, n)` to `out`, escaping like `Json.escape`. Returns
+   the number of characters added by escape sequences, beyond the escaped characters themselves. */
+static size_t append_json_escaped(std::string & out, char const * s, size_t n) {
+    char const * end = s + n;
+    size_t extra = 0;
+    while (true) {
+        char const * p = find_json_special(s, end);
+        out.append(s, p);
+        if (p == end) return extra;
+        unsigned char c = *p;
+        switch (c) {
+        case '"':  out += "\\\""; extra += 1; break;
+        case '\\': out += "\\\\"; extra += 1; break;
+        case '\n': out += "\\n";  extra += 1; break;
+        case '\r': out += "\\r";  extra += 1; break;
+        default:
+            out += "\\u00";
+            out += g_hex_digits[c >> 4];
+            out += g_hex_digits[c & 0xf];
+            extra += 5;
+        }
+        s = p + 1;
+    }
+}
+
+/* Appends `JsonNumber.toString n` to `out`. */
+static void append_json_number(std::string & out, b_obj_arg n) {
+    b_obj_arg m = lean_ctor_get(n, 0);
+    b_obj_arg e = lean_ctor_get(n, 1);
+    bool neg;
+    std::string digits;
+    if (lean_is_scalar(m)) {
+        int64_t v = lean_scalar_to_int64(m);
+        neg = v < 0;
+        digits = std::to_string(neg ? -static_cast<uint64_t>(v) : static_cast<uint64_t>(v));
+    } else {
+        neg = mpz_value(m).is_neg();
+        digits = abs(mpz_value(m)).to_string();
+    }
+    if (neg) out += '-';
+    if (e == box(0)) {
+        out += digits;
+        return;
+    }
+    // `exp := 9 + countDigits m - e` if it is negative, `0` otherwise; `k := e + exp`
+    size_t nd = digits.size();
+    std::string neg_exp;
+    size_t k;
+    if (!lean_is_scalar(e)) {
+        neg_exp = (mpz_value(e) - mpz::of_size_t(9 + nd)).to_string();
+        k = 9 + nd;
+    } else if (lean_unbox(e) > 9 + nd) {
+        neg_exp = std::to_string(lean_unbox(e) - 9 - nd);
+        k = 9 + nd;
+    } else {
+        k = lean_unbox(e);
+    }
+    // `m / 10^k` and `m % 10^k`, padded to `k` digits
+    std::string right = nd > k ? digits.substr(nd - k) : std::string(k - nd, '0') + digits;
+    out.append(digits, 0, nd > k ? nd - k : 0);
+    if (nd <= k) out += '0';
+    size_t last = right.find_last_not_of('0');
+    if (last == std::string::npos && neg_exp.empty()) return;
+    out += '.';
+    if (last != std::string::npos) out.append(right, 0, last + 1);
+    if (!neg_exp.empty()) {
+        out += "e-";
+        out += neg_exp;
+    }
+}
+
+struct json_work_item {
+    enum kind : uint8 { value, key, text };
+    kind      m_kind;
+    char      m_char;
+    b_obj_arg m_obj;
+};
+
+/* Json.compress : (@& Json) → String */
+extern "C" LEAN_EXPORT obj_res lean_json_compress(b_obj_arg j) {
+    std::string out;
+    size_t len = 0; // number of characters in `out`
+    std::vector<json_work_item> todo;
+    std::vector<object *> fields;
+    todo.push_back({json_work_item::value, 0, j});
+    while (!todo.empty()) {
+        json_work_item it = todo.back();
+        todo.pop_back();
+        if (it.m_kind == json_work_item::text) {
+            out += it.m_char;
+            len++;
+            continue;
+        }
+        if (it.m_kind == json_work_item::key) {
+            out += '"';
+            len += lean_string_len(it.m_obj) + 3 + append_json_escaped(out, json_str_data(it.m_obj), json_str_size(it.m_obj));
+            out += "\":";
+            continue;
+        }
+        size_t start = out.size();
+        b_obj_arg v = it.m_obj;
+        switch (json_kind_of(v)) {
+        case json_kind::null:
+            out += "null";
+            break;
+        case json_kind::bool_:
+            out += lean_ctor_get_uint8(v, 0) ? "true" : "false";
+            break;
+        case json_kind::num:
+            append_json_number(out, lean_ctor_get(v, 0));
+            break;
+        case json_kind::str: {
+            b_obj_arg s = lean_ctor_get(v, 0);
+            out += '"';
+            len += lean_string_len(s) + 2 + append_json_escaped(out, json_str_data(s), json_str_size(s));
+            out += '"';
+            continue;
+        }
+        case json_kind::arr: {
+            b_obj_arg a = lean_ctor_get(v, 0);
+            size_t n = lean_array_size(a);
+            out += '[';
+            todo.push_back({json_work_item::text, ']', nullptr});
+            for (size_t i = n; i > 0; i--) {
+                todo.push_back({json_work_item::value, 0, lean_array_get_core(a, i - 1)});
+                if (i > 1) todo.push_back({json_work_item::text, ',', nullptr});
+            }
+            break;
+        }
+        case json_kind::obj: {
+            // like `Json.compress`, print the fields in descending order of their keys
+            fields.clear();
+            rb_fields(lean_ctor_get(v, 0), fields);
+            out += '{';
+            todo.push_back({json_work_item::text, '}', nullptr});
+            for (size_t i = 0; i < fields.size(); i += 2) {
+                if (i > 0) todo.push_back({json_work_item::text, ',', nullptr});
+                todo.push_back({json_work_item::value, 0, fields[i + 1]});
+                todo.push_back({json_work_item::key, 0, fields[i]});
+            }
+            break;
+        }
+        }
+        len += out.size() - start;
+    }
+    return lean_mk_string_unchecked(out.data(), out.size(), len);
+}
+
+/* Json.escape : (@& String) → String → String */
+extern "C" LEAN_EXPORT obj_res lean_json_escape(b_obj_arg s, obj_arg acc) {
+    char const * data = json_str_data(s);
+    size_t sz = json_str_size(s);
+    if (find_json_special(data, data + sz) == data + sz)
+        return lean_string_append(acc, s);
+    std::string out;
+    size_t len = lean_string_len(s) + append_json_escaped(out, data, sz);
+    object * e = lean_mk_string_unchecked(out.data(), out.size(), len);
+    acc = lean_string_append(acc, e);
+    lean_dec(e);
+    return acc;
+}
+
+static obj_res mk_json_error(size_t offset, char const * msg) {
+    std::string err = "offset " + std::to_string(offset) + ": " + msg;
+    return mk_except_error_string(err.c_str());
+}
+
+static obj_res mk_json_ok(obj_arg j) {
+    object * r = lean_alloc_ctor(1, 1, 0);
+    lean_ctor_set(r, 0, j);
+    return r;
+}
+
+static bool is_digit(char c) { return '0' <= c && c <= '9'; }
+
+static int hex_value(char c) {
+    if ('0' <= c && c <= '9') return c - '0';
+    if ('a' <= c && c <= 'f') return c - 'a' + 10;
+    if ('A' <= c && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Parses the digits `[begin, end)` into a `Nat`. */
+static obj_res nat_of_digits(char const * begin, char const * end) {
+    if (end - begin <= 18) {
+        uint64_t v = 0;
+        for (char const * it = begin; it != end; it++) v = 10*v + (*it - '0');
+        return lean_uint64_to_nat(v);
+    }
+    return lean_cstr_to_nat(std::string(begin, end).c_str());
+}
+
+/* A JSON parser that accepts the same language as `Lean.Json.Parser.any` and reports the same errors at
+   the same offsets. */
+class json_parser {
+    char const * m_begin;
+    char const * m_it;
+    char const * m_end;
+    json_builder m_builder;
+    /* Contents of the current string if it contains escape sequences. */
+    std::string  m_buf;
+    char const * m_err_pos = nullptr;
+    char const * m_err     = nullptr;
+
+    static constexpr char const * g_eoi = "unexpected end of input";
+
+    object * fail(char const * pos, char const * msg) {
+        m_err_pos = pos;
+        m_err     = msg;
+        return nullptr;
+    }
+
+    /* The position after the character at `p`, as skipped by `Parsec.any`. */
+    static char const * next_char(char const * p) {
+        return p + get_utf8_size(static_cast<unsigned char>(*p));
+    }
+
+    void skip_ws() {
+        while (m_it < m_end && (*m_it == ' ' || *m_it == '\t' || *m_it == '\n' || *m_it == '\r')) m_it++;
+    }
+
+    bool skip_literal(char const * lit, size_t n) {
+        if (static_cast<size_t>(m_end - m_it) < n || memcmp(m_it, lit, n) != 0) return false;
+        m_it += n;
+        return true;
+    }
+
+    /* Parses the rest of a string literal after its opening quote. */
+    object * parse_string() {
+        char const * start = m_it;
+        char const * p = find_json_special(m_it, m_end);
+        if (p == m_end) return fail(p, g_eoi);
+        if (*p == '"') {
+            m_it = p + 1;
+            size_t sz = p - start;
+            return lean_mk_string_unchecked(start, sz, lean_utf8_n_strlen(start, sz));
+        }
+        m_buf.assign(start, p);
+        while (true) {
+            if (*p == '"') {
+                m_it = p + 1;
+                return lean_mk_string_unchecked(m_buf.data(), m_buf.size(), lean_utf8_n_strlen(m_buf.data(), m_buf.size()));
+            }
+            if (*p != '\\') return fail(p + 1, "unexpected character in string");
+            p++;
+            if (p == m_end) return fail(p, g_eoi);
+            switch (*p) {
+            case '\\': m_buf += '\\'; break;
+            case '"':  m_buf += '"'; break;
+            case '/':  m_buf += '/'; break;
+            case 'b':  m_buf += '\x08'; break;
+            case 'f':  m_buf += '\x0c'; break;
+            case 'n':  m_buf += '\n'; break;
+            case 'r':  m_buf += '\x0d'; break;
+            case 't':  m_buf += '\t'; break;
+            case 'u': {
+                unsigned code = 0;
+                for (unsigned i = 0; i < 4; i++) {
+                    p++;
+                    if (p == m_end) return fail(p, g_eoi);
+                    int d = hex_value(*p);
+                    if (d < 0) return fail(next_char(p), "invalid hex character");
+                    code = 16*code + d;
+                }
+                // like `Char.ofNat`, surrogates are replaced by `'\0'`
+                if (0xd800 <= code && code <= 0xdfff) code = 0;
+                push_unicode_scalar(m_buf, code);
+                break;
+            }
+            default:
+                return fail(next_char(p), "illegal \\u escape");
+            }
+            p++;
+            char const * q = find_json_special(p, m_end);
+            m_buf.append(p, q);
+            p = q;
+            if (p == m_end) return fail(p, g_eoi);
+        }
+    }
+
+    object * parse_number() {
+        char const * it = m_it;
+        bool neg = *it == '-';
+        if (neg) it++;
+        if (it == m_end) return fail(it, g_eoi);
+        char const * int_begin = it;
+        if (*it == '0') {
+            it++;
+        } else {
+            if (*it < '1' || *it > '9') return fail(it, "expected 1-9");
+            while (it < m_end && is_digit(*it)) it++;
+        }
+        char const * int_end = it;
+        char const * frac_begin = it;
+        char const * frac_end = it;
+        if (it < m_end && *it == '.') {
+            it++;
+            if (it == m_end) return fail(it, g_eoi);
+            if (!is_digit(*it)) return fail(it, "expected digit");
+            frac_begin = it;
+            while (it < m_end && is_digit(*it)) it++;
+            frac_end = it;
+        }
+        size_t frac_digits = frac_end - frac_begin;
+        // the value is `(-1)^neg * digits * 10^(shift - exponent)`
+        object * exponent = lean_usize_to_nat(frac_digits);
+        size_t shift = 0;
+        if (it < m_end && (*it == 'e' || *it == 'E')) {
+            it++;
+            if (it == m_end) { lean_dec(exponent); return fail(it, g_eoi); }
+            bool exp_neg = *it == '-';
+            if (exp_neg || *it == '+') it++;
+            if (it == m_end) { lean_dec(exponent); return fail(it, g_eoi); }
+            if (!is_digit(*it)) { lean_dec(exponent); return fail(it, "expected 0-9"); }
+            char const * exp_begin = it;
+            while (it < m_end && is_digit(*it)) it++;
+            if (exp_neg) {
+                object * n = nat_of_digits(exp_begin, it);
+                object * e = lean_nat_add(exponent, n);
+                lean_dec(n);
+                lean_dec(exponent);
+                exponent = e;
+            } else {
+                while (exp_begin < it - 1 && *exp_begin == '0') exp_begin++;
+                uint64_t n = 0;
+                for (char const * d = exp_begin; d != it; d++) {
+                    if (n > (UINT64_MAX - 9) / 10) { lean_dec(exponent); return fail(it, "exp too large"); }
+                    n = 10*n + (*d - '0');
+                }
+                lean_dec(exponent);
+                if (n <= frac_digits) {
+                    exponent = lean_usize_to_nat(frac_digits - n);
+                } else {
+                    exponent = box(0);
+                    shift = n - frac_digits;
+                }
+            }
+        }
+        m_it = it;
+        size_t num_digits = (int_end - int_begin) + frac_digits;
+        object * mantissa;
+        if (num_digits + shift <= 18) {
+            int64_t v = 0;
+            for (char const * d = int_begin; d != int_end; d++) v = 10*v + (*d - '0');
+            for (char const * d = frac_begin; d != frac_end; d++) v = 10*v + (*d - '0');
+            for (size_t i = 0; i < shift; i++) v *= 10;
+            mantissa = lean_int64_to_int(neg ? -v : v);
+        } else {
+            std::string digits(int_begin, int_end);
+            digits.append(frac_begin, frac_end);
+            mantissa = lean_nat_to_int(lean_cstr_to_nat(digits.c_str()));
+            if (shift > 0) {
+                object * s = lean_usize_to_nat(shift);
+                object * p = lean_nat_pow(box(10), s);
+                lean_dec(s);
+                object * f = lean_nat_to_int(p);
+                object * r = lean_int_mul(mantissa, f);
+                lean_dec(f);
+                lean_dec(mantissa);
+                mantissa = r;
+            }
+            if (neg) {
+                object * r = lean_int_neg(mantissa);
+                lean_dec(mantissa);
+                mantissa = r;
+            }
+        }
+        return mk_json_num(mantissa, exponent);
+    }
+
+    /* Parses `"key" :` inside an object and pushes the key. */
+    bool parse_key() {
+        if (m_it == m_end || *m_it != '"') {
+            fail(m_it, m_it == m_end ? g_eoi : "expected \"");
+            return false;
+        }
+        m_it++;
+        object * k = parse_string();
+        if (!k) return false;
+        m_builder.push(k);
+        skip_ws();
+        if (m_it == m_end || *m_it != ':') {
+            fail(m_it, m_it == m_end ? g_eoi : "expected :");
+            return false;
+        }
+        m_it++;
+        skip_ws();
+        return true;
+    }
+
+    object * parse_value() {
+        skip_ws();
+        while (true) {
+            if (m_it == m_end) return fail(m_it, g_eoi);
+            object * v;
+            char c = *m_it;
+            if (c == '[') {
+                m_it++;
+                skip_ws();
+                if (m_it == m_end) return fail(m_it, g_eoi);
+                if (*m_it != ']') {
+                    m_builder.open(false);
+                    continue;
+                }
+                m_it++;
+                skip_ws();
+                v = mk_json(json_kind::arr, lean_alloc_array(0, 0));
+            } else if (c == '{') {
+                m_it++;
+                skip_ws();
+                if (m_it == m_end) return fail(m_it, g_eoi);
+                if (*m_it != '}') {
+                    m_builder.open(true);
+                    if (!parse_key()) return nullptr;
+                    continue;
+                }
+                m_it++;
+                skip_ws();
+                v = mk_json(json_kind::obj, box(0));
+            } else if (c == '"') {
+                m_it++;
+                object * s = parse_string();
+                if (!s) return nullptr;
+                skip_ws();
+                v = mk_json(json_kind::str, s);
+            } else if (c == 'f') {
+                if (!skip_literal("false", 5)) return fail(m_it, "expected: false");
+                skip_ws();
+                v = mk_json_bool(false);
+            } else if (c == 't') {
+                if (!skip_literal("true", 4)) return fail(m_it, "expected: true");
+                skip_ws();
+                v = mk_json_bool(true);
+            } else if (c == 'n') {
+                if (!skip_literal("null", 4)) return fail(m_it, "expected: null");
+                skip_ws();
+                v = box(0);
+            } else if (c == '-' || is_digit(c)) {
+                v = parse_number();
+                if (!v) return nullptr;
+                skip_ws();
+            } else {
+                return fail(m_it, "unexpected input");
+            }
+            // `v` is complete, close the containers it completes
+            while (true) {
+                if (m_builder.empty()) return v;
+                m_builder.push(v);
+                if (m_it == m_end) return fail(m_it, g_eoi);
+                char d = *m_it;
+                m_it = next_char(m_it);
+                if (d == ',') {
+                    skip_ws();
+                    if (m_builder.in_object() && !parse_key()) return nullptr;
+                    break;
+                }
+                if (m_builder.in_object()) {
+                    if (d != '}') return fail(m_it, "unexpected character in object");
+                    skip_ws();
+                    v = m_builder.close_object();
+                } else {
+                    if (d != ']') return fail(m_it, "unexpected character in array");
+                    skip_ws();
+                    v = m_builder.close_array();
+                }
+            }
+        }
+    }
+
+public:
+    json_parser(char const * begin, size_t size):m_begin(begin), m_it(begin), m_end(begin + size) {}
+
+    obj_res operator()() {
+        object * v = parse_value();
+        if (v && m_it != m_end) {
+            lean_dec(v);
+            v = fail(m_it, "expected end of input");
+        }
+        if (!v) return mk_json_error(m_err_pos - m_begin, m_err);
+        return mk_json_ok(v);
+    }
+};
+
+/* Json.parse : (@& String) → Except String Json */
+extern "C" LEAN_EXPORT obj_res lean_json_parse(b_obj_arg s) {
+    return json_parser(json_str_data(s), json_str_size(s))();
+}
+
+/*
+Binary encoding of `Json` values, used by `Json.toBinary` and `Json.ofBinary`. A value is a tag byte
+followed by its payload; all lengths and counts are LEB128 varints.
+
+- `null`, `false`, `true`: no payload
+- small number: zigzag varint mantissa, varint exponent
+- big number: sign byte, length-prefixed decimal digits of the absolute value of the mantissa, then
+  length-prefixed decimal digits of the exponent
+- string: length-prefixed UTF-8 bytes
+- array: number of elements, then the elements
+- object: number of fields, then each field as key (length-prefixed UTF-8 bytes) and value, in ascending
+  order of keys
+*/
+enum class json_bin_tag : uint8 { null, false_, true_, small_num, big_num, str, arr, obj };
+
+static void put_varint(std::string & out, uint64_t v) {
+    while (v >= 0x80) {
+        out += static_cast<char>((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+static void put_bytes(std::string & out, char const * s, size_t n) {
+    put_varint(out, n);
+    out.append(s, n);
+}
+
+static void put_digits(std::string & out, b_obj_arg n) {
+    std::string d = lean_is_scalar(n) ? std::to_string(lean_unbox(n)) : abs(mpz_value(n)).to_string();
+    put_bytes(out, d.data(), d.size());
+}
+
+static void put_json_number(std::string & out, b_obj_arg n) {
+    b_obj_arg m = lean_ctor_get(n, 0);
+    b_obj_arg e = lean_ctor_get(n, 1);
+    if (lean_is_scalar(m) && lean_is_scalar(e)) {
+        int64_t v = lean_scalar_to_int64(m);
+        out += static_cast<char>(json_bin_tag::small_num);
+        put_varint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+        put_varint(out, lean_unbox(e));
+    } else {
+        out += static_cast<char>(json_bin_tag::big_num);
+        out += static_cast<char>(!lean_is_scalar(m) ? mpz_value(m).is_neg() : lean_scalar_to_int64(m) < 0);
+        put_digits(out, m);
+        put_digits(out, e);
+    }
+}
+
+/* Json.toBinary : (@& Json) → ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_json_to_binary(b_obj_arg j) {
+    std::string out;
+    std::vector<json_work_item> todo;
+    std::vector<object *> fields;
+    todo.push_back({json_work_item::value, 0, j});
+    while (!todo.empty()) {
+        json_work_item it = todo.back();
+        todo.pop_back();
+        b_obj_arg v = it.m_obj;
+        if (it.m_kind == json_work_item::key) {
+            put_bytes(out, json_str_data(v), json_str_size(v));
+            continue;
+        }
+        switch (json_kind_of(v)) {
+        case json_kind::null:
+            out += static_cast<char>(json_bin_tag::null);
+            break;
+        case json_kind::bool_:
+            out += static_cast<char>(lean_ctor_get_uint8(v, 0) ? json_bin_tag::true_ : json_bin_tag::false_);
+            break;
+        case json_kind::num:
+            put_json_number(out, lean_ctor_get(v, 0));
+            break;
+        case json_kind::str: {
+            b_obj_arg s = lean_ctor_get(v, 0);
+            out += static_cast<char>(json_bin_tag::str);
+            put_bytes(out, json_str_data(s), json_str_size(s));
+            break;
+        }
+        case json_kind::arr: {
+            b_obj_arg a = lean_ctor_get(v, 0);
+            size_t n = lean_array_size(a);
+            out += static_cast<char>(json_bin_tag::arr);
+            put_varint(out, n);
+            for (size_t i = n; i > 0; i--)
+                todo.push_back({json_work_item::value, 0, lean_array_get_core(a, i - 1)});
+            break;
+        }
+        case json_kind::obj: {
+            fields.clear();
+            rb_fields(lean_ctor_get(v, 0), fields);
+            out += static_cast<char>(json_bin_tag::obj);
+            put_varint(out, fields.size() / 2);
+            for (size_t i = fields.size(); i > 0; i -= 2) {
+                todo.push_back({json_work_item::value, 0, fields[i - 1]});
+                todo.push_back({json_work_item::key, 0, fields[i - 2]});
+            }
+            break;
+        }
+        }
+    }
+    object * r = lean_alloc_sarray(1, out.size(), out.size());
+    memcpy(lean_sarray_cptr(r), out.data(), out.size());
+    return r;
+}
+
+class json_bin_decoder {
+    uint8_t const *     m_begin;
+    uint8_t const *     m_it;
+    uint8_t const *     m_end;
+    json_builder        m_builder;
+    /* Number of elements still to be decoded in each open container. */
+    std::vector<size_t> m_remaining;
+    char const *        m_err = nullptr;
+
+    object * fail(char const * msg) {
+        m_err = msg;
+        return nullptr;
+    }
+
+    bool get_varint(uint64_t & v) {
+        v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (m_it == m_end) {
+                fail("unexpected end of input");
+                return false;
+            }
+            uint8_t b = *m_it++;
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        fail("invalid varint");
+        return false;
+    }
+
+    bool get_bytes(uint8_t const * & data, size_t & size) {
+        uint64_t n;
+        if (!get_varint(n)) return false;
+        if (n > static_cast<uint64_t>(m_end - m_it)) {
+            fail("unexpected end of input");
+            return false;
+        }
+        data = m_it;
+        size = n;
+        m_it += n;
+        return true;
+    }
+
+    object * get_string() {
+        uint8_t const * data;
+        size_t size;
+        if (!get_bytes(data, size)) return nullptr;
+        size_t pos = 0, len = 0;
+        if (!validate_utf8(data, size, pos, len)) return fail("invalid UTF-8");
+        return lean_mk_string_unchecked(reinterpret_cast<char const *>(data), size, len);
+    }
+
+    object * get_digits() {
+        uint8_t const * data;
+        size_t size;
+        if (!get_bytes(data, size)) return nullptr;
+        if (size == 0) return fail("invalid number");
+        for (size_t i = 0; i < size; i++) {
+            if (!is_digit(data[i])) return fail("invalid number");
+        }
+        char const * d = reinterpret_cast<char const *>(data);
+        return nat_of_digits(d, d + size);
+    }
+
+    object * get_number(json_bin_tag tag) {
+        if (tag == json_bin_tag::small_num) {
+            uint64_t m, e;
+            if (!get_varint(m) || !get_varint(e)) return nullptr;
+            int64_t v = static_cast<int64_t>(m >> 1) ^ -static_cast<int64_t>(m & 1);
+            return mk_json_num(lean_int64_to_int(v), lean_uint64_to_nat(e));
+        }
+        if (m_it == m_end) return fail("unexpected end of input");
+        bool neg = *m_it++ != 0;
+        object * m = get_digits();
+        if (!m) return nullptr;
+        object * e = get_digits();
+        if (!e) { lean_dec(m); return nullptr; }
+        object * mantissa = lean_nat_to_int(m);
+        if (neg) {
+            object * r = lean_int_neg(mantissa);
+            lean_dec(mantissa);
+            mantissa = r;
+        }
+        return mk_json_num(mantissa, e);
+    }
+
+    /* Decodes the key of the next field of the innermost object, which must be larger than the previous one. */
+    bool get_key() {
+        object * k = get_string();
+        if (!k) return false;
+        if (m_builder.size() > 0 && json_key_cmp(m_builder.back(1), k) >= 0) {
+            lean_dec(k);
+            fail("object keys are not in ascending order");
+            return false;
+        }
+        m_builder.push(k);
+        return true;
+    }
+
+    object * get_value() {
+        while (true) {
+            if (m_it == m_end) return fail("unexpected end of input");
+            object * v;
+            json_bin_tag tag = static_cast<json_bin_tag>(*m_it++);
+            switch (tag) {
+            case json_bin_tag::null:   v = box(0); break;
+            case json_bin_tag::false_: v = mk_json_bool(false); break;
+            case json_bin_tag::true_:  v = mk_json_bool(true); break;
+            case json_bin_tag::small_num:
+            case json_bin_tag::big_num:
+                v = get_number(tag);
+                if (!v) return nullptr;
+                break;
+            case json_bin_tag::str: {
+                object * s = get_string();
+                if (!s) return nullptr;
+                v = mk_json(json_kind::str, s);
+                break;
+            }
+            case json_bin_tag::arr:
+            case json_bin_tag::obj: {
+                uint64_t n;
+                if (!get_varint(n)) return nullptr;
+                bool obj = tag == json_bin_tag::obj;
+                if (n == 0) {
+                    v = obj ? mk_json(json_kind::obj, box(0)) : mk_json(json_kind::arr, lean_alloc_array(0, 0));
+                    break;
+                }
+                // every element takes at least one byte
+                if (n > static_cast<uint64_t>(m_end - m_it)) return fail("unexpected end of input");
+                m_builder.open(obj);
+                m_remaining.push_back(n);
+                if (obj && !get_key()) return nullptr;
+                continue;
+            }
+            default:
+                return fail("invalid tag");
+            }
+            while (true) {
+                if (m_builder.empty()) return v;
+                m_builder.push(v);
+                if (--m_remaining.back() > 0) {
+                    if (m_builder.in_object() && !get_key()) return nullptr;
+                    break;
+                }
+                m_remaining.pop_back();
+                v = m_builder.in_object() ? m_builder.close_object() : m_builder.close_array();
+            }
+        }
+    }
+
+public:
+    json_bin_decoder(uint8_t const * begin, size_t size):m_begin(begin), m_it(begin), m_end(begin + size) {}
+
+    obj_res operator()() {
+        object * v = get_value();
+        if (v && m_it != m_end) {
+            lean_dec(v);
+            v = fail("unexpected data after value");
+        }
+        if (!v) return mk_json_error(m_it - m_begin, m_err);
+        return mk_json_ok(v);
+    }
+};
+
+/* Json.ofBinary : (@& ByteArray) → Except String Json */
+extern "C" LEAN_EXPORT obj_res lean_json_of_binary(b_obj_arg bytes) {
+    return json_bin_decoder(lean_sarray_cptr(bytes), lean_sarray_size(bytes))();
+}
+
+}
@@ -17,6 +17,11 @@ Revision History:
 
 --*/
 #include <stdint.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
 #include "runtime/mpn.h"
 #include "runtime/debug.h"
 #include "runtime/buffer.h"
@@ -86,11 +91,10 @@ void mpn_sub(mpn_digit const * a, size_t const lnga,
     }
 }
 
-void mpn_mul(mpn_digit const * a, size_t const lnga,
-             mpn_digit const * b, size_t const lngb,
-             mpn_digit * c) {
+static void mul_basecase(mpn_digit const * a, size_t const lnga,
+                         mpn_digit const * b, size_t const lngb,
+                         mpn_digit * c) {
     // Essentially Knuth's Algorithm M.
-    // Perhaps implement a more efficient version, see e.g., Knuth, Section 4.3.3.
     size_t i;
     mpn_digit k;
 
@@ -265,6 +269,349 @@ static void div_n(mpn_buffer & numer, mpn_buffer const & denom,
     }
 }
 
+/* Subquadratic algorithms.
+
+   `mpn_mul` switches from Knuth's Algorithm M to Karatsuba and then to Toom-3 as the operands grow,
+   `mpn_div` switches to a Newton reciprocal for long divisors and quotients, and `mpn_to_string`
+   converts large numbers by recursively splitting them at powers of ten. The thresholds are in digits
+   and were tuned on x86-64; they only affect performance. */
+#define KARATSUBA_THRESHOLD    32
+#define TOOM3_THRESHOLD        160
+#define DIV_NEWTON_THRESHOLD   300
+#define RECIP_BASECASE         16
+#define TO_STRING_DC_THRESHOLD 60
+
+typedef std::vector<mpn_digit> mpn_vec;
+
+static size_t trimmed_size(mpn_digit const * a, size_t n) {
+    while (n > 0 && a[n-1] == 0) n--;
+    return n;
+}
+
+static void trim(mpn_vec & a) {
+    a.resize(trimmed_size(a.data(), a.size()));
+}
+
+/* `r[0, rn) += a[0, an)` for `an <= rn`, returning the carry. */
+static mpn_digit add_to(mpn_digit * r, size_t rn, mpn_digit const * a, size_t an) {
+    lean_assert(an <= rn);
+    mpn_double_digit c = 0;
+    size_t i = 0;
+    for (; i < an; i++) {
+        c += (mpn_double_digit)r[i] + a[i];
+        r[i] = (mpn_digit)c;
+        c >>= DIGIT_BITS;
+    }
+    for (; c != 0 && i < rn; i++) {
+        c += r[i];
+        r[i] = (mpn_digit)c;
+        c >>= DIGIT_BITS;
+    }
+    return (mpn_digit)c;
+}
+
+/* `r[0, rn) -= a[0, an)` for `an <= rn`, returning the borrow. */
+static mpn_digit sub_from(mpn_digit * r, size_t rn, mpn_digit const * a, size_t an) {
+    lean_assert(an <= rn);
+    mpn_digit k = 0;
+    size_t i = 0;
+    for (; i < an; i++) {
+        mpn_double_digit t = (mpn_double_digit)r[i] - a[i] - k;
+        r[i] = (mpn_digit)t;
+        k = (t >> DIGIT_BITS) != 0;
+    }
+    for (; k != 0 && i < rn; i++) {
+        k = r[i] == 0;
+        r[i]--;
+    }
+    return k;
+}
+
+static void mul_rec(mpn_digit const * a, size_t la, mpn_digit const * b, size_t lb, mpn_digit * c);
+
+/* `c = a * b` where `b` is at most half as long as `a`: multiply by `lb`-digit chunks of `a`. */
+static void mul_unbalanced(mpn_digit const * a, size_t la, mpn_digit const * b, size_t lb, mpn_digit * c) {
+    std::fill(c, c + la + lb, 0);
+    mpn_vec t(2*lb);
+    for (size_t i = 0; i < la; i += lb) {
+        size_t k = std::min(lb, la - i);
+        mul_rec(a + i, k, b, lb, t.data());
+        add_to(c + i, la + lb - i, t.data(), k + lb);
+    }
+}
+
+/* `c = a * b` for `la >= lb > ceil(la/2)`. With `h = ceil(la/2)`, `a = a1*B^h + a0` and `b = b1*B^h + b0`:
+   `a*b = a1*b1*B^(2h) + ((a0+a1)*(b0+b1) - a0*b0 - a1*b1)*B^h + a0*b0`. */
+static void mul_karatsuba(mpn_digit const * a, size_t la, mpn_digit const * b, size_t lb, mpn_digit * c) {
+    size_t h   = (la + 1) / 2;
+    size_t la1 = la - h;
+    size_t lb1 = lb - h;
+    lean_assert(lb > h);
+    mul_rec(a, h, b, h, c);
+    mul_rec(a + h, la1, b + h, lb1, c + 2*h);
+    mpn_vec sa(a, a + h), sb(b, b + h);
+    sa.push_back(add_to(sa.data(), h, a + h, la1));
+    sb.push_back(add_to(sb.data(), h, b + h, lb1));
+    mpn_vec z1(2*h + 2);
+    mul_rec(sa.data(), h + 1, sb.data(), h + 1, z1.data());
+    sub_from(z1.data(), z1.size(), c, 2*h);
+    sub_from(z1.data(), z1.size(), c + 2*h, la1 + lb1);
+    add_to(c + h, la + lb - h, z1.data(), trimmed_size(z1.data(), z1.size()));
+}
+
+/* Signed numbers for Toom-3 interpolation and Newton iteration. The magnitude has no leading zeros,
+   and zero is not negative. */
+struct mpn_snum {
+    bool    m_neg = false;
+    mpn_vec m_mag;
+    mpn_snum() {}
+    mpn_snum(mpn_digit const * a, size_t n):m_mag(a, a + trimmed_size(a, n)) {}
+    explicit mpn_snum(mpn_vec && v):m_mag(std::move(v)) { trim(m_mag); }
+    bool is_zero() const { return m_mag.empty(); }
+};
+
+static int cmp_mag(mpn_vec const & a, mpn_vec const & b) {
+    if (a.size() != b.size())
+        return a.size() < b.size() ? -1 : 1;
+    return mpn_compare(a.data(), a.size(), b.data(), b.size());
+}
+
+/* `a + (neg_b ? -b : b)` */
+static mpn_snum add_signed(mpn_snum const & a, mpn_snum const & b, bool neg_b) {
+    mpn_snum r;
+    if (a.m_neg == neg_b) {
+        mpn_vec const & x = a.m_mag.size() >= b.m_mag.size() ? a.m_mag : b.m_mag;
+        mpn_vec const & y = a.m_mag.size() >= b.m_mag.size() ? b.m_mag : a.m_mag;
+        r.m_mag = x;
+        r.m_mag.push_back(0);
+        add_to(r.m_mag.data(), r.m_mag.size(), y.data(), y.size());
+        r.m_neg = a.m_neg;
+    } else {
+        int c = cmp_mag(a.m_mag, b.m_mag);
+        if (c == 0)
+            return r;
+        mpn_vec const & x = c > 0 ? a.m_mag : b.m_mag;
+        mpn_vec const & y = c > 0 ? b.m_mag : a.m_mag;
+        r.m_mag = x;
+        sub_from(r.m_mag.data(), r.m_mag.size(), y.data(), y.size());
+        r.m_neg = c > 0 ? a.m_neg : neg_b;
+    }
+    trim(r.m_mag);
+    if (r.is_zero()) r.m_neg = false;
+    return r;
+}
+
+static mpn_snum operator+(mpn_snum const & a, mpn_snum const & b) { return add_signed(a, b, b.m_neg); }
+static mpn_snum operator-(mpn_snum const & a, mpn_snum const & b) { return add_signed(a, b, !b.m_neg && !b.is_zero()); }
+
+static mpn_snum operator*(mpn_snum const & a, mpn_snum const & b) {
+    mpn_snum r;
+    if (a.is_zero() || b.is_zero())
+        return r;
+    r.m_mag.resize(a.m_mag.size() + b.m_mag.size());
+    mul_rec(a.m_mag.data(), a.m_mag.size(), b.m_mag.data(), b.m_mag.size(), r.m_mag.data());
+    trim(r.m_mag);
+    r.m_neg = a.m_neg != b.m_neg;
+    return r;
+}
+
+/* `a * 2^k` for `k < DIGIT_BITS`. */
+static mpn_snum shl_bits(mpn_snum a, unsigned k) {
+    if (k == 0 || a.is_zero())
+        return a;
+    a.m_mag.push_back(0);
+    for (size_t i = a.m_mag.size() - 1; i > 0; i--)
+        a.m_mag[i] = (a.m_mag[i] << k) | (a.m_mag[i-1] >> (DIGIT_BITS - k));
+    a.m_mag[0] <<= k;
+    trim(a.m_mag);
+    return a;
+}
+
+/* `a / d` for a small `d` dividing `a`. */
+static mpn_snum div_exact(mpn_snum a, mpn_digit d) {
+    mpn_double_digit r = 0;
+    for (size_t i = a.m_mag.size(); i-- > 0;) {
+        mpn_double_digit t = (r << DIGIT_BITS) | a.m_mag[i];
+        a.m_mag[i] = (mpn_digit)(t / d);
+        r = t % d;
+    }
+    lean_assert(r == 0);
+    trim(a.m_mag);
+    return a;
+}
+
+/* Add the nonnegative `a` to `c[0, cn)` at digit offset `off`. */
+static void add_at(mpn_digit * c, size_t cn, size_t off, mpn_snum const & a) {
+    lean_assert(!a.m_neg);
+    if (!a.is_zero())
+        add_to(c + off, cn - off, a.m_mag.data(), a.m_mag.size());
+}
+
+/* `c = a * b` for `la >= lb > 2*ceil(la/3)`, evaluating at 0, 1, -1, -2 and infinity and interpolating
+   with Bodrato's sequence. */
+static void mul_toom3(mpn_digit const * a, size_t la, mpn_digit const * b, size_t lb, mpn_digit * c) {
+    size_t k = (la + 2) / 3;
+    lean_assert(lb > 2*k);
+    mpn_snum a0(a, k), a1(a + k, k), a2(a + 2*k, la - 2*k);
+    mpn_snum b0(b, k), b1(b + k, k), b2(b + 2*k, lb - 2*k);
+    mpn_snum ta  = a0 + a2, tb = b0 + b2;
+    mpn_snum pa1 = ta + a1, pb1 = tb + b1;
+    mpn_snum pam1 = ta - a1, pbm1 = tb - b1;
+    mpn_snum pam2 = shl_bits(pam1 + a2, 1) - a0;
+    mpn_snum pbm2 = shl_bits(pbm1 + b2, 1) - b0;
+    mpn_snum r0   = a0 * b0;
+    mpn_snum r1   = pa1 * pb1;
+    mpn_snum rm1  = pam1 * pbm1;
+    mpn_snum rm2  = pam2 * pbm2;
+    mpn_snum rinf = a2 * b2;
+    mpn_snum s3 = div_exact(rm2 - r1, 3);
+    mpn_snum s1 = div_exact(r1 - rm1, 2);
+    mpn_snum s2 = rm1 - r0;
+    s3 = div_exact(s2 - s3, 2) + shl_bits(rinf, 1);
+    s2 = s2 + s1 - rinf;
+    s1 = s1 - s3;
+    size_t cn = la + lb;
+    std::fill(c, c + cn, 0);
+    add_at(c, cn, 0,   r0);
+    add_at(c, cn, k,   s1);
+    add_at(c, cn, 2*k, s2);
+    add_at(c, cn, 3*k, s3);
+    add_at(c, cn, 4*k, rinf);
+}
+
+static void mul_rec(mpn_digit const * a, size_t la, mpn_digit const * b, size_t lb, mpn_digit * c) {
+    if (la < lb) {
+        std::swap(a, b);
+        std::swap(la, lb);
+    }
+    if (lb < KARATSUBA_THRESHOLD)
+        mul_basecase(a, la, b, lb, c);
+    else if (2*lb <= la + 1)
+        mul_unbalanced(a, la, b, lb, c);
+    else if (lb >= TOOM3_THRESHOLD && lb > 2*((la + 2) / 3))
+        mul_toom3(a, la, b, lb, c);
+    else
+        mul_karatsuba(a, la, b, lb, c);
+}
+
+void mpn_mul(mpn_digit const * a, size_t const lnga,
+             mpn_digit const * b, size_t const lngb,
+             mpn_digit * c) {
+    if (lnga < KARATSUBA_THRESHOLD || lngb < KARATSUBA_THRESHOLD)
+        mul_basecase(a, lnga, b, lngb, c);
+    else
+        mul_rec(a, lnga, b, lngb, c);
+}
+
+/* `B^k` where `B` is the digit base. */
+static mpn_snum pow_base(size_t k) {
+    mpn_vec v(k + 1, 0);
+    v[k] = 1;
+    return mpn_snum(std::move(v));
+}
+
+/* `a * B^k` */
+static mpn_snum shl_digits(mpn_snum a, size_t k) {
+    if (!a.is_zero())
+        a.m_mag.insert(a.m_mag.begin(), k, 0);
+    return a;
+}
+
+/* `a / B^k`, rounding the magnitude down. */
+static mpn_snum shr_digits(mpn_snum a, size_t k) {
+    if (k >= a.m_mag.size())
+        return mpn_snum();
+    a.m_mag.erase(a.m_mag.begin(), a.m_mag.begin() + k);
+    return a;
+}
+
+/* Adjust the estimate `q` of `floor(n / d)` given `r = n - q*d`, so that `0 <= r < d`. */
+static void fix_quotient(mpn_snum & q, mpn_snum & r, mpn_snum const & d) {
+    mpn_snum one(mpn_vec(1, 1));
+    while (r.m_neg) {
+        q = q - one;
+        r = r + d;
+    }
+    while (cmp_mag(r.m_mag, d.m_mag) >= 0) {
+        q = q + one;
+        r = r - d;
+    }
+}
+
+/* `floor(B^(2n) / d)` for `d` with `n` digits and the top bit set, computed from the reciprocal of the
+   top `h ~ n/2` digits by one Newton step `x + x*(B^(2n) - d*x)/B^(2n)`, which doubles the number of
+   correct digits, followed by an exact correction. */
+static mpn_snum recip(mpn_digit const * d, size_t n) {
+    mpn_snum dn(d, n);
+    if (n <= RECIP_BASECASE) {
+        mpn_vec num(2*n + 1, 0), q(n + 2), r(n);
+        num[2*n] = 1;
+        mpn_div(num.data(), num.size(), d, n, q.data(), r.data());
+        return mpn_snum(std::move(q));
+    }
+    size_t h = n/2 + 2;
+    mpn_snum xh = recip(d + n - h, h);
+    // x0 = xh * B^(n-h), so d*x0 = (d*xh) * B^(n-h) and x0*e / B^(2n) = (xh*e) / B^(n+h)
+    mpn_snum e = pow_base(2*n) - shl_digits(dn * xh, n - h);
+    mpn_snum x = shl_digits(xh, n - h) + shr_digits(xh * e, n + h);
+    mpn_snum r = pow_base(2*n) - dn * x;
+    fix_quotient(x, r, dn);
+    return x;
+}
+
+static void copy_digits(mpn_snum const & a, mpn_digit * r, size_t n) {
+    lean_assert(!a.m_neg && a.m_mag.size() <= n);
+    std::copy(a.m_mag.begin(), a.m_mag.end(), r);
+    std::fill(r + a.m_mag.size(), r + n, 0);
+}
+
+/* Same contract as `mpn_div`, for `lden >= DIV_NEWTON_THRESHOLD`. The operands are shifted so that the top
+   bit of the divisor is set. If the quotient is shorter than the divisor, only the top `m + 2` digits of both
+   operands are needed to estimate it within a few units. Otherwise the numerator is divided in blocks of
+   `lden` digits, reusing one reciprocal of the divisor. */
+static void div_newton(mpn_digit const * numer, size_t lnum,
+                       mpn_digit const * denom, size_t lden,
+                       mpn_digit * quot, mpn_digit * rem) {
+    unsigned s = 0;
+    while (((denom[lden-1] << s) & MASK_FIRST) == 0) s++;
+    mpn_snum a = shl_bits(mpn_snum(numer, lnum), s);
+    mpn_snum b = shl_bits(mpn_snum(denom, lden), s);
+    lean_assert(b.m_mag.size() == lden);
+    size_t m = lnum - lden;
+    mpn_snum q, r;
+    if (m + 2 <= lden) {
+        size_t t    = m + 2;
+        size_t drop = lden - t;
+        mpn_snum x = recip(b.m_mag.data() + drop, t);
+        q = shr_digits(shr_digits(a, drop) * x, 2*t);
+        r = a - q * b;
+        fix_quotient(q, r, b);
+    } else {
+        mpn_snum x = recip(b.m_mag.data(), lden);
+        size_t la = a.m_mag.size();
+        size_t nblocks = (la + lden - 1) / lden;
+        mpn_vec qd(nblocks * lden, 0);
+        for (size_t j = nblocks; j-- > 0;) {
+            size_t lo = j * lden;
+            size_t hi = std::min(la, lo + lden);
+            mpn_snum c = shl_digits(r, hi - lo) + mpn_snum(a.m_mag.data() + lo, hi - lo);
+            mpn_snum qj = shr_digits(c * x, 2*lden);
+            r = c - qj * b;
+            fix_quotient(qj, r, b);
+            std::copy(qj.m_mag.begin(), qj.m_mag.end(), qd.begin() + lo);
+        }
+        q = mpn_snum(std::move(qd));
+    }
+    copy_digits(q, quot, m + 1);
+    // undo the shift of the remainder
+    mpn_vec rd = r.m_mag;
+    rd.resize(lden + 1, 0);
+    if (s != 0)
+        for (size_t i = 0; i < lden; i++)
+            rd[i] = (rd[i] >> s) | (rd[i+1] << (DIGIT_BITS - s));
+    std::copy(rd.begin(), rd.begin() + lden, rem);
+}
+
 void mpn_div(mpn_digit const * numer, size_t const lnum,
              mpn_digit const * denom, size_t const lden,
              mpn_digit * quot,
@@ -295,6 +642,9 @@ void mpn_div(mpn_digit const * numer, size_t const lnum,
         for (size_t i = 0; i < lden; i++)
             rem[i] = (i < lnum) ? numer[i] : 0;
     }
+    else if (lden >= DIV_NEWTON_THRESHOLD && lnum - lden >= DIV_NEWTON_THRESHOLD / 4) {
+        div_newton(numer, lnum, denom, lden, quot, rem);
+    }
     else  {
         mpn_buffer u, v, t_ms, t_ab;
         size_t d = div_normalize(numer, lnum, denom, lden, u, v);
@@ -318,6 +668,52 @@ void mpn_div(mpn_digit const * numer, size_t const lnum,
 #endif
 }
 
+static const mpn_digit DEC_CHUNK      = 1000000000;
+static const unsigned  DEC_CHUNK_DIGS = 9;
+
+/* Append the decimal digits of `a` to `out`, left-padded with zeros to `width` characters. */
+static void to_decimal_basecase(mpn_vec a, size_t width, std::string & out) {
+    std::vector<mpn_digit> chunks;
+    trim(a);
+    while (!a.empty()) {
+        mpn_double_digit r = 0;
+        for (size_t i = a.size(); i-- > 0;) {
+            mpn_double_digit t = (r << DIGIT_BITS) | a[i];
+            a[i] = (mpn_digit)(t / DEC_CHUNK);
+            r = t % DEC_CHUNK;
+        }
+        chunks.push_back((mpn_digit)r);
+        trim(a);
+    }
+    std::string s;
+    char tmp[DEC_CHUNK_DIGS + 1];
+    for (size_t i = chunks.size(); i-- > 0;) {
+        snprintf(tmp, sizeof(tmp), i + 1 == chunks.size() ? "%u" : "%09u", chunks[i]);
+        s += tmp;
+    }
+    if (s.size() < width)
+        out.append(width - s.size(), '0');
+    out += s;
+}
+
+/* `pows[k]` is `10^(9 * 2^k)`. Split `a` at the largest power that is at most about its square root. */
+static void to_decimal(mpn_vec const & a, size_t width, std::vector<mpn_vec> const & pows, std::string & out) {
+    size_t n = trimmed_size(a.data(), a.size());
+    if (n < TO_STRING_DC_THRESHOLD) {
+        to_decimal_basecase(mpn_vec(a.begin(), a.begin() + n), width, out);
+        return;
+    }
+    size_t k = 0;
+    while (k + 1 < pows.size() && 2 * pows[k + 1].size() <= n + 1)
+        k++;
+    mpn_vec const & p = pows[k];
+    size_t lo_width = DEC_CHUNK_DIGS << k;
+    mpn_vec q(n - p.size() + 1), r(p.size());
+    mpn_div(a.data(), n, p.data(), p.size(), q.data(), r.data());
+    to_decimal(q, width > lo_width ? width - lo_width : 0, pows, out);
+    to_decimal(r, lo_width, pows, out);
+}
+
 char * mpn_to_string(mpn_digit const * a, size_t const lng, char * buf, size_t const lbuf) {
     lean_assert(buf && lbuf > 0);
 
@@ -327,29 +723,27 @@ char * mpn_to_string(mpn_digit const * a, size_t const lng, char * buf, size_t c
 #else
         snprintf(buf, lbuf, "%u", *a);
 #endif
-    }
-    else {
-        mpn_buffer temp(lng, 0), t_numer(lng+1, 0), t_denom(1, 0);
-        for (unsigned i = 0; i < lng; i++)
-            temp[i] = a[i];
-
-        size_t j = 0;
-        mpn_digit rem;
-        mpn_digit ten = 10;
-        while (!temp.empty() && (temp.size() > 1 || temp[0] != 0)) {
-            size_t d = div_normalize(&temp[0], temp.size(), &ten, 1, t_numer, t_denom);
-            div_1(t_numer, t_denom[0], &temp[0]);
-            div_unnormalize(t_numer, t_denom, d, &rem);
-            buf[j++] = '0' + rem;
-            while (!temp.empty() && temp.back() == 0)
-                temp.pop_back();
+    } else {
+        std::string out;
+        mpn_vec v(a, a + lng);
+        if (lng < TO_STRING_DC_THRESHOLD) {
+            to_decimal_basecase(v, 0, out);
+        } else {
+            std::vector<mpn_vec> pows;
+            pows.push_back(mpn_vec(1, DEC_CHUNK));
+            while (2 * pows.back().size() <= lng + 1) {
+                mpn_vec const & p = pows.back();
+                mpn_vec sq(2 * p.size());
+                mpn_mul(p.data(), p.size(), p.data(), p.size(), sq.data());
+                trim(sq);
+                pows.push_back(sq);
+            }
+            to_decimal(v, 0, pows, out);
         }
-        buf[j] = 0;
-
-        j--;
-        size_t mid = (j/2) + ((j % 2) ? 1 : 0);
-        for (size_t i = 0; i < mid; i++)
-            std::swap(buf[i], buf[j-i]);
+        if (out.empty())
+            out = "0";
+        lean_assert(out.size() < lbuf);
+        memcpy(buf, out.c_str(), out.size() + 1);
     }
     return buf;
 }
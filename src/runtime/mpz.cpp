@@ -5,6 +5,7 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include <memory>
+#include <algorithm>
 #include <string>
 #include <cstring>
 #include "runtime/sstream.h"
@@ -69,6 +70,27 @@ mpz::~mpz() {
     mpz_clear(m_val);
 }
 
+mpz::mpz(bool neg, size_t n, limb const * d) {
+    mpz_init2(m_val, std::max<size_t>(n, 1) * GMP_NUMB_BITS);
+    if (n > 0) mpn_copyi(m_val[0]._mp_d, d, n);
+    m_val[0]._mp_size = neg ? -static_cast<int>(n) : static_cast<int>(n);
+}
+
+mpz::mpz(bool neg, size_t n, limb * d, view_tag) {
+    lean_assert(n > 0 && d[n-1] != 0);
+    m_val[0]._mp_alloc = static_cast<int>(n);
+    m_val[0]._mp_size  = neg ? -static_cast<int>(n) : static_cast<int>(n);
+    m_val[0]._mp_d     = d;
+}
+
+size_t mpz::limb_size() const {
+    return mpz_size(m_val);
+}
+
+mpz::limb const * mpz::limbs() const {
+    return m_val[0]._mp_d;
+}
+
 void mpz::set(mpz_t r) const {
     mpz_set(r, m_val);
 }
@@ -293,6 +315,31 @@ std::ostream & operator<<(std::ostream & out, mpz const & v) {
     return out;
 }
 
+static size_t normalize_limbs(mpz::limb const * r, size_t n) {
+    while (n > 0 && r[n-1] == 0) n--;
+    return n;
+}
+
+size_t mpz_limbs_add(mpz::limb * r, mpz::limb const * a, size_t n, size_t b) {
+    r[n] = mpn_add_1(r, a, n, b);
+    return n + (r[n] != 0);
+}
+
+size_t mpz_limbs_sub(mpz::limb * r, mpz::limb const * a, size_t n, size_t b) {
+    mpn_sub_1(r, a, n, b);
+    return normalize_limbs(r, n);
+}
+
+size_t mpz_limbs_mul(mpz::limb * r, mpz::limb const * a, size_t n, size_t b) {
+    r[n] = mpn_mul_1(r, a, n, b);
+    return normalize_limbs(r, n + 1);
+}
+
+size_t mpz_limbs_divrem(mpz::limb * r, mpz::limb const * a, size_t n, size_t b, size_t & rem) {
+    rem = mpn_divrem_1(r, 0, a, n, b);
+    return normalize_limbs(r, n);
+}
+
 #else
 /***** NON GMP VERSION ******/
 
@@ -428,6 +475,31 @@ mpz::~mpz() {
     }
 }
 
+mpz::mpz(bool neg, size_t n, limb const * d) {
+    if (n == 0) {
+        init();
+    } else {
+        allocate(n);
+        m_sign = neg;
+        memcpy(m_digits, d, n * sizeof(mpn_digit));
+    }
+}
+
+mpz::mpz(bool neg, size_t n, limb * d, view_tag):
+    m_sign(neg),
+    m_size(n),
+    m_digits(d) {
+    lean_assert(n > 0 && d[n-1] != 0);
+}
+
+size_t mpz::limb_size() const {
+    return m_size;
+}
+
+mpz::limb const * mpz::limbs() const {
+    return m_digits;
+}
+
 void swap(mpz & a, mpz & b) {
     std::swap(a.m_sign, b.m_sign);
     std::swap(a.m_size, b.m_size);
@@ -993,6 +1065,88 @@ void gcd(mpz & g, mpz const & a, mpz const & b) {
     }
 }
 
+static size_t normalize_limbs(mpz::limb const * r, size_t n) {
+    while (n > 0 && r[n-1] == 0) n--;
+    return n;
+}
+
+/* `size_t` operands may be wider than a digit, so these kernels carry in a `uint64`. */
+static constexpr unsigned digit_bits = sizeof(mpn_digit) * 8;
+static constexpr uint64 digit_mask   = (static_cast<uint64>(1) << digit_bits) - 1;
+
+size_t mpz_limbs_add(mpz::limb * r, mpz::limb const * a, size_t n, size_t b) {
+    uint64 c = b;
+    for (size_t i = 0; i < n; i++) {
+        uint64 t = static_cast<uint64>(a[i]) + (c & digit_mask);
+        r[i] = static_cast<mpn_digit>(t);
+        c = (c >> digit_bits) + (t >> digit_bits);
+    }
+    for (; c != 0; c >>= digit_bits)
+        r[n++] = static_cast<mpn_digit>(c);
+    return n;
+}
+
+size_t mpz_limbs_sub(mpz::limb * r, mpz::limb const * a, size_t n, size_t b) {
+    uint64 c = b;
+    for (size_t i = 0; i < n; i++) {
+        uint64 lo = c & digit_mask;
+        c >>= digit_bits;
+        if (a[i] >= lo) {
+            r[i] = static_cast<mpn_digit>(a[i] - lo);
+        } else {
+            r[i] = static_cast<mpn_digit>(static_cast<uint64>(a[i]) + (digit_mask + 1) - lo);
+            c++;
+        }
+    }
+    lean_assert(c == 0);
+    return normalize_limbs(r, n);
+}
+
+size_t mpz_limbs_mul(mpz::limb * r, mpz::limb const * a, size_t n, size_t b) {
+    uint64 b_lo = static_cast<uint64>(b) & digit_mask;
+    uint64 b_hi = static_cast<uint64>(b) >> digit_bits;
+    uint64 c = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64 t = a[i] * b_lo + c;
+        r[i] = static_cast<mpn_digit>(t);
+        c = t >> digit_bits;
+    }
+    r[n]   = static_cast<mpn_digit>(c);
+    r[n+1] = 0;
+    if (b_hi != 0) {
+        c = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint64 t = a[i] * b_hi + r[i+1] + c;
+            r[i+1] = static_cast<mpn_digit>(t);
+            c = t >> digit_bits;
+        }
+        r[n+1] = static_cast<mpn_digit>(c);
+    }
+    return normalize_limbs(r, n + 2);
+}
+
+size_t mpz_limbs_divrem(mpz::limb * r, mpz::limb const * a, size_t n, size_t b, size_t & rem) {
+    if (static_cast<uint64>(b) <= digit_mask) {
+        uint64 c = 0;
+        for (size_t i = n; i-- > 0;) {
+            uint64 t = (c << digit_bits) | a[i];
+            r[i] = static_cast<mpn_digit>(t / b);
+            c = t % b;
+        }
+        rem = c;
+        return normalize_limbs(r, n);
+    } else if (n < 2) {
+        rem = a[0];
+        return 0;
+    } else {
+        mpn_digit d[2] = { static_cast<mpn_digit>(b), static_cast<mpn_digit>(static_cast<uint64>(b) >> digit_bits) };
+        mpn_digit m[2];
+        mpn_div(a, n, d, 2, r, m);
+        rem = static_cast<size_t>(m[0] | (static_cast<uint64>(m[1]) << digit_bits));
+        return normalize_limbs(r, n - 1);
+    }
+}
+
 std::ostream & operator<<(std::ostream & out, mpz const & v) {
     if (v.m_sign)
         out << "-";
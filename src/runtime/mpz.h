@@ -20,10 +20,24 @@ Author: Leonardo de Moura
 
 namespace lean {
 
+struct mpz_object;
+
 /** \brief Wrapper for GMP integers */
 class LEAN_EXPORT mpz {
     friend class object_compactor;
     friend class compacted_region;
+    friend struct mpz_object;
+public:
+#ifdef LEAN_USE_GMP
+    typedef mp_limb_t limb;
+#else
+    typedef mpn_digit limb;
+#endif
+private:
+    struct view_tag {};
+    /* Make this number refer to the `n > 0` limbs at `d` without owning them.
+       Such a number must be neither mutated nor destroyed, see `mpz_object`. */
+    mpz(bool neg, size_t n, limb * d, view_tag);
 #ifdef LEAN_USE_GMP
     mpz_t m_val;
     mpz(__mpz_struct const * v) { mpz_init_set(m_val, v); }
@@ -61,6 +75,9 @@ public:
         else
             return mpz((unsigned) v); // NOLINT
     }
+    /** \brief The number with magnitude given by the `n` limbs at `d`, least significant first, and sign `neg`.
+        `d[n-1]` must be nonzero unless `n == 0`. */
+    mpz(bool neg, size_t n, limb const * d);
     mpz(mpz const & s);
     mpz(mpz && s);
     ~mpz();
@@ -132,6 +149,11 @@ public:
 
     friend mpz abs(mpz a) { a.abs(); return a; }
 
+    /** \brief Number of limbs of the magnitude. */
+    size_t limb_size() const;
+    /** \brief Limbs of the magnitude, least significant first. */
+    limb const * limbs() const;
+
     bool is_int() const;
     bool is_unsigned_int() const;
     bool is_size_t() const;
@@ -289,6 +311,16 @@ public:
     std::string to_string() const;
 };
 
+/* Magnitude kernels for the fast paths in `object.cpp` that combine a bignum with a machine word without
+   creating `mpz` temporaries. `a` has `n > 0` limbs and `r` must have room for `n + 2` limbs; `r` may not
+   overlap `a`. They return the number of limbs of the result after removing leading zeros. */
+size_t mpz_limbs_add(mpz::limb * r, mpz::limb const * a, size_t n, size_t b);
+/* Requires `a >= b`. */
+size_t mpz_limbs_sub(mpz::limb * r, mpz::limb const * a, size_t n, size_t b);
+size_t mpz_limbs_mul(mpz::limb * r, mpz::limb const * a, size_t n, size_t b);
+/* Store the quotient of `a` by `b != 0` in `r` and the remainder in `rem`. */
+size_t mpz_limbs_divrem(mpz::limb * r, mpz::limb const * a, size_t n, size_t b, size_t & rem);
+
 struct mpz_cmp_fn {
     int operator()(mpz const & v1, mpz const & v2) const { return cmp(v1, v2); }
 };
@@ -22,11 +22,24 @@ Author: Leonardo de Moura
 #include "runtime/io.h"
 #include "runtime/hash.h"
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define LEAN_SARRAY_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LEAN_SARRAY_NEON
+#endif
+
 #ifdef __GLIBC__
 #include <execinfo.h>
 #include <unistd.h>
 #endif
 
+#ifdef LEAN_MAPPED_SARRAY
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 // HACK: for unknown reasons, std::isnan(x) fails on msys64 because math.h
 // is imported and isnan(x) looks like a macro. On the other hand, isnan(x)
 // fails on linux because <cmath> doesn't define it (as expected).
@@ -180,12 +193,80 @@ static inline void lean_dealloc(lean_object * o, size_t sz) {
 #endif
 }
 
+/* Return true if objects of `old_sz` and `new_sz` bytes are allocated using `malloc`, and can be resized using `realloc`. */
+static inline bool lean_can_realloc(size_t old_sz, size_t new_sz) {
+#ifdef LEAN_SMALL_ALLOCATOR
+    return lean_align(old_sz, LEAN_OBJECT_SIZE_DELTA) > LEAN_MAX_SMALL_OBJECT_SIZE &&
+           lean_align(new_sz, LEAN_OBJECT_SIZE_DELTA) > LEAN_MAX_SMALL_OBJECT_SIZE;
+#else
+    (void)old_sz; (void)new_sz;
+    return true;
+#endif
+}
+
+/* Resize the exclusive object `o` to `new_sz` bytes, see `lean_can_realloc`.
+   The allocator grows large blocks in place when possible (glibc uses `mremap` for very large ones),
+   instead of copying them. */
+static inline lean_object * lean_realloc_object(lean_object * o, size_t new_sz) {
+#ifdef LEAN_SMALL_ALLOCATOR
+    new_sz = lean_align(new_sz, LEAN_OBJECT_SIZE_DELTA);
+#endif
+    void * r = realloc(o, new_sz);
+    if (r == nullptr) lean_internal_panic_out_of_memory();
+    return static_cast<lean_object*>(r);
+}
+
+/* Release the limbs of a number, unless they are stored inline (see `alloc_mpz_limbs`). */
+static inline void free_mpz_object(lean_object * o) {
+    if (!to_mpz(o)->has_inline_limbs())
+        to_mpz(o)->m_value.~mpz();
+}
+
+#ifdef LEAN_MAPPED_SARRAY
+/* The data of a mapped scalar array starts on a page boundary, and its header is at the end of the
+   anonymous page mapped just before it. */
+static size_t mapped_sarray_header_page_size() {
+    static size_t sz = sysconf(_SC_PAGESIZE);
+    return sz;
+}
+
+object * alloc_mapped_byte_array(int fd, size_t size) {
+    size_t page = mapped_sarray_header_page_size();
+    char * base = static_cast<char*>(mmap(nullptr, page + size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+        return nullptr;
+    /* A private mapping, so that in-place updates of an exclusive array copy the page instead of writing to the file. */
+    if (mmap(base + page, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int err = errno;
+        munmap(base, page + size);
+        errno = err;
+        return nullptr;
+    }
+    lean_sarray_object * o = reinterpret_cast<lean_sarray_object*>(base + page - sizeof(lean_sarray_object));
+    lean_set_st_header(reinterpret_cast<object*>(o), LeanScalarArray, 1 | LEAN_SARRAY_MAPPED_FLAG);
+    o->m_size     = size;
+    o->m_capacity = size;
+    return reinterpret_cast<object*>(o);
+}
+#endif
+
+static inline void free_sarray(lean_object * o) {
+#ifdef LEAN_MAPPED_SARRAY
+    if (lean_sarray_is_mapped(o)) {
+        size_t page = mapped_sarray_header_page_size();
+        munmap(reinterpret_cast<char*>(lean_sarray_cptr(o)) - page, page + lean_sarray_capacity(o));
+        return;
+    }
+#endif
+    lean_dealloc(o, lean_sarray_byte_size(o));
+}
+
 extern "C" LEAN_EXPORT void lean_free_object(lean_object * o) {
     switch (lean_ptr_tag(o)) {
     case LeanArray:       return lean_dealloc(o, lean_array_byte_size(o));
-    case LeanScalarArray: return lean_dealloc(o, lean_sarray_byte_size(o));
+    case LeanScalarArray: return free_sarray(o);
     case LeanString:      return lean_dealloc(o, lean_string_byte_size(o));
-    case LeanMPZ:         to_mpz(o)->m_value.~mpz(); return lean_free_small_object(o);
+    case LeanMPZ:         free_mpz_object(o); return lean_free_small_object(o);
     default:              return lean_free_small_object(o);
     }
 }
@@ -288,13 +369,13 @@ static void lean_del_core(object * o, object * & todo) {
             break;
         }
         case LeanScalarArray:
-            lean_dealloc(o, lean_sarray_byte_size(o));
+            free_sarray(o);
             break;
         case LeanString:
             lean_dealloc(o, lean_string_byte_size(o));
             break;
         case LeanMPZ:
-            to_mpz(o)->m_value.~mpz();
+            free_mpz_object(o);
             lean_free_small_object(o);
             break;
         case LeanThunk:
@@ -610,6 +691,18 @@ class task_manager {
     condition_variable                            m_task_finished_cv;
     bool                                          m_shutting_down{false};
 
+    /* Pending `IO.Promise.resolveAfter` calls, as a binary heap ordered by deadline. They are resolved by a
+       single timer thread that is started on first use, so that no worker is blocked while a timer is pending. */
+    struct timer {
+        chrono::steady_clock::time_point m_deadline;
+        lean_task_object *               m_promise;
+        object *                         m_value;
+        bool operator<(timer const & other) const { return m_deadline > other.m_deadline; }
+    };
+    std::vector<timer>                            m_timers;
+    std::unique_ptr<lthread>                      m_timer_thread;
+    condition_variable                            m_timer_cv;
+
     lean_task_object * dequeue() {
         lean_assert(m_queues_size != 0);
         std::deque<lean_task_object *> & q = m_queues[m_max_prio];
@@ -769,6 +862,35 @@ class task_manager {
         }
     }
 
+    void run_timers() {
+        unique_lock<mutex> lock(m_mutex);
+        while (!m_shutting_down) {
+            if (m_timers.empty()) {
+                m_timer_cv.wait(lock);
+                continue;
+            }
+            chrono::steady_clock::time_point deadline = m_timers.front().m_deadline;
+            if (chrono::steady_clock::now() < deadline) {
+                m_timer_cv.wait_until(lock, deadline);
+                continue;
+            }
+            std::pop_heap(m_timers.begin(), m_timers.end());
+            timer t = m_timers.back();
+            m_timers.pop_back();
+            if (t.m_promise->m_value) {
+                // already resolved by `Promise.resolve`
+                lock.unlock();
+                dec(t.m_value);
+            } else {
+                resolve_core(t.m_promise, t.m_value);
+                lock.unlock();
+            }
+            // `dec_ref` could lead to `deactivate_task` trying to take the lock
+            lean_dec_ref((lean_object*)t.m_promise);
+            lock.lock();
+        }
+    }
+
     object * wait_any_check(object * task_list) {
         object * it = task_list;
         while (!is_scalar(it)) {
@@ -792,10 +914,13 @@ public:
             // we can assume that `m_std_workers` will not be changed after this line
         }
         m_queue_cv.notify_all();
+        m_timer_cv.notify_all();
 #ifndef LEAN_EMSCRIPTEN
         // wait for all workers to finish
         for (auto & t : m_std_workers)
             t->join();
+        if (m_timer_thread)
+            m_timer_thread->join();
         // never seems to terminate under Emscripten
 #endif
     }
@@ -815,6 +940,31 @@ public:
         resolve_core(t, v);
     }
 
+    /* Resolves the promise `t` with `v` once `ms` milliseconds have passed. Timers that are still pending at
+       shutdown are dropped without resolving their promises. */
+    void resolve_after(lean_task_object * t, object * v, unsigned ms) {
+        mark_mt(v);
+        lean_inc_ref((lean_object*)t);
+        unique_lock<mutex> lock(m_mutex);
+        if (m_shutting_down) {
+            lock.unlock();
+            dec(v);
+            lean_dec_ref((lean_object*)t);
+            return;
+        }
+        m_timers.push_back(timer{chrono::steady_clock::now() + chrono::milliseconds(ms), t, v});
+        std::push_heap(m_timers.begin(), m_timers.end());
+        if (!m_timer_thread) {
+            m_timer_thread.reset(new lthread([this]() {
+                save_stack_info(false);
+                run_timers();
+            }));
+        } else if (m_timers.front().m_promise == t) {
+            // new earliest deadline
+            m_timer_cv.notify_one();
+        }
+    }
+
     void add_dep(lean_task_object * t1, lean_task_object * t2) {
         lean_assert(t2->m_value == nullptr);
         if (t1->m_value) {
@@ -1086,6 +1236,11 @@ extern "C" LEAN_EXPORT obj_res lean_io_promise_resolve(obj_arg value, b_obj_arg
     return io_result_mk_ok(box(0));
 }
 
+extern "C" LEAN_EXPORT obj_res lean_io_promise_resolve_after(obj_arg value, b_obj_arg promise, uint32 ms, obj_arg) {
+    g_task_manager->resolve_after(lean_to_task(promise), value, ms);
+    return io_result_mk_ok(box(0));
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_promise_result(obj_arg promise) {
     // the task is the promise itself
     return promise;
@@ -1101,6 +1256,66 @@ object * alloc_mpz(mpz const & m) {
     return (lean_object*)o;
 }
 
+object * alloc_mpz(mpz && m) {
+    void * mem = lean_alloc_small_object(sizeof(mpz_object));
+    mpz_object * o = new (mem) mpz_object(std::move(m));
+    lean_set_st_header((lean_object*)o, LeanMPZ, 0);
+    return (lean_object*)o;
+}
+
+/* Numbers of at most this many bytes keep their limbs inside the `mpz_object`, which saves a heap block. */
+#define LEAN_MPZ_INLINE_BYTES 16
+
+/* Allocate the number with sign `neg` and the `n > 0` limbs `d`. */
+static object * alloc_mpz_limbs(bool neg, size_t n, mpz::limb const * d) {
+    lean_assert(n > 0 && d[n-1] != 0);
+    if (n * sizeof(mpz::limb) <= LEAN_MPZ_INLINE_BYTES) {
+        void * mem = lean_alloc_small_object(sizeof(mpz_object) + n * sizeof(mpz::limb));
+        mpz_object * o = new (mem) mpz_object(neg, n, d);
+        lean_set_st_header((lean_object*)o, LeanMPZ, 0);
+        return (lean_object*)o;
+    } else {
+        return alloc_mpz(mpz(neg, n, d));
+    }
+}
+
+/* Mixed scalar/bignum operations whose bignum operand has at most this many limbs compute the result
+   limbs into a stack buffer with the `mpz_limbs_*` kernels and allocate the result only once. */
+#define LEAN_MPZ_FAST_LIMBS 64
+
+static inline bool mpz_has_fast_limbs(b_obj_arg o) {
+    return mpz_value(o).limb_size() <= LEAN_MPZ_FAST_LIMBS;
+}
+
+/* Shifting by half a limb twice is well defined even when limbs are as wide as `size_t`. */
+#define LEAN_MPZ_HALF_LIMB_BITS (4 * sizeof(mpz::limb))
+
+/* Return `true` and store the value in `v` if the `n` limbs `d` fit in a `size_t`. */
+static inline bool limbs_to_size_t(size_t n, mpz::limb const * d, size_t & v) {
+    if (n * sizeof(mpz::limb) > sizeof(size_t))
+        return false;
+    v = 0;
+    for (size_t i = n; i-- > 0;)
+        v = ((v << LEAN_MPZ_HALF_LIMB_BITS) << LEAN_MPZ_HALF_LIMB_BITS) | d[i];
+    return true;
+}
+
+/* Store the limbs of `v` in `d` and return their number. */
+static inline size_t size_t_to_limbs(size_t v, mpz::limb * d) {
+    size_t n = 0;
+    for (; v != 0; v = (v >> LEAN_MPZ_HALF_LIMB_BITS) >> LEAN_MPZ_HALF_LIMB_BITS)
+        d[n++] = static_cast<mpz::limb>(v);
+    return n;
+}
+
+static inline obj_res limbs_to_nat(size_t n, mpz::limb const * d) {
+    size_t v;
+    if (limbs_to_size_t(n, d, v) && v <= LEAN_MAX_SMALL_NAT)
+        return lean_box(v);
+    else
+        return alloc_mpz_limbs(false, n, d);
+}
+
 #ifdef LEAN_USE_GMP
 extern "C" LEAN_EXPORT lean_object * lean_alloc_mpz(mpz_t v) {
     return alloc_mpz(mpz(v));
@@ -1116,6 +1331,11 @@ object * mpz_to_nat_core(mpz const & m) {
     return alloc_mpz(m);
 }
 
+static inline object * mpz_to_nat_core(mpz && m) {
+    lean_assert(!m.is_size_t() || m.get_size_t() > LEAN_MAX_SMALL_NAT);
+    return alloc_mpz(std::move(m));
+}
+
 static inline obj_res mpz_to_nat(mpz const & m) {
     if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
         return lean_box(m.get_size_t());
@@ -1123,6 +1343,14 @@ static inline obj_res mpz_to_nat(mpz const & m) {
         return mpz_to_nat_core(m);
 }
 
+/* Temporaries are moved into the result instead of being copied. */
+static inline obj_res mpz_to_nat(mpz && m) {
+    if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
+        return lean_box(m.get_size_t());
+    else
+        return mpz_to_nat_core(std::move(m));
+}
+
 extern "C" LEAN_EXPORT object * lean_cstr_to_nat(char const * n) {
     return mpz_to_nat(mpz(n));
 }
@@ -1143,16 +1371,26 @@ extern "C" LEAN_EXPORT object * lean_big_uint64_to_nat(uint64_t n) {
     }
 }
 
+/* `a + b` for a bignum `a`. */
+static object * nat_big_add_small(b_obj_arg a, size_t b) {
+    if (!mpz_has_fast_limbs(a))
+        return mpz_to_nat_core(mpz_value(a) + mpz::of_size_t(b));
+    mpz const & m = mpz_value(a);
+    mpz::limb r[LEAN_MPZ_FAST_LIMBS + 2];
+    size_t n = mpz_limbs_add(r, m.limbs(), m.limb_size(), b);
+    return alloc_mpz_limbs(false, n, r);
+}
+
 extern "C" LEAN_EXPORT object * lean_nat_big_succ(object * a) {
-    return mpz_to_nat_core(mpz_value(a) + 1);
+    return nat_big_add_small(a, 1);
 }
 
 extern "C" LEAN_EXPORT object * lean_nat_big_add(object * a1, object * a2) {
     lean_assert(!lean_is_scalar(a1) || !lean_is_scalar(a2));
     if (lean_is_scalar(a1))
-        return mpz_to_nat_core(mpz::of_size_t(lean_unbox(a1)) + mpz_value(a2));
+        return nat_big_add_small(a2, lean_unbox(a1));
     else if (lean_is_scalar(a2))
-        return mpz_to_nat_core(mpz_value(a1) + mpz::of_size_t(lean_unbox(a2)));
+        return nat_big_add_small(a1, lean_unbox(a2));
     else
         return mpz_to_nat_core(mpz_value(a1) + mpz_value(a2));
 }
@@ -1164,7 +1402,11 @@ extern "C" LEAN_EXPORT object * lean_nat_big_sub(object * a1, object * a2) {
         return lean_box(0);
     } else if (lean_is_scalar(a2)) {
         lean_assert(mpz_value(a1) > mpz::of_size_t(lean_unbox(a2)));
-        return mpz_to_nat(mpz_value(a1) - mpz::of_size_t(lean_unbox(a2)));
+        if (!mpz_has_fast_limbs(a1))
+            return mpz_to_nat(mpz_value(a1) - mpz::of_size_t(lean_unbox(a2)));
+        mpz const & m = mpz_value(a1);
+        mpz::limb r[LEAN_MPZ_FAST_LIMBS + 2];
+        return limbs_to_nat(mpz_limbs_sub(r, m.limbs(), m.limb_size(), lean_unbox(a2)), r);
     } else {
         if (mpz_value(a1) < mpz_value(a2))
             return lean_box(0);
@@ -1173,18 +1415,31 @@ extern "C" LEAN_EXPORT object * lean_nat_big_sub(object * a1, object * a2) {
     }
 }
 
+/* `a * b` for a bignum `a`. */
+static object * nat_big_mul_small(b_obj_arg a, size_t b) {
+    if (!mpz_has_fast_limbs(a))
+        return mpz_to_nat(mpz_value(a) * mpz::of_size_t(b));
+    mpz const & m = mpz_value(a);
+    mpz::limb r[LEAN_MPZ_FAST_LIMBS + 2];
+    return limbs_to_nat(mpz_limbs_mul(r, m.limbs(), m.limb_size(), b), r);
+}
+
 extern "C" LEAN_EXPORT object * lean_nat_big_mul(object * a1, object * a2) {
     lean_assert(!lean_is_scalar(a1) || !lean_is_scalar(a2));
     if (lean_is_scalar(a1))
-        return mpz_to_nat(mpz::of_size_t(lean_unbox(a1)) * mpz_value(a2));
+        return nat_big_mul_small(a2, lean_unbox(a1));
     else if (lean_is_scalar(a2))
-        return mpz_to_nat(mpz_value(a1) * mpz::of_size_t(lean_unbox(a2)));
+        return nat_big_mul_small(a1, lean_unbox(a2));
     else
         return mpz_to_nat_core(mpz_value(a1) * mpz_value(a2));
 }
 
 extern "C" LEAN_EXPORT object * lean_nat_overflow_mul(size_t a1, size_t a2) {
-    return mpz_to_nat(mpz::of_size_t(a1) * mpz::of_size_t(a2));
+    lean_assert(a1 != 0);
+    mpz::limb d[sizeof(size_t) / sizeof(mpz::limb)];
+    size_t n = size_t_to_limbs(a1, d);
+    mpz::limb r[sizeof(size_t) / sizeof(mpz::limb) + 2];
+    return limbs_to_nat(mpz_limbs_mul(r, d, n, a2), r);
 }
 
 extern "C" LEAN_EXPORT object * lean_nat_big_div(object * a1, object * a2) {
@@ -1195,7 +1450,14 @@ extern "C" LEAN_EXPORT object * lean_nat_big_div(object * a1, object * a2) {
         return lean_box(0);
     } else if (lean_is_scalar(a2)) {
         usize n2 = lean_unbox(a2);
-        return n2 == 0 ? a2 : mpz_to_nat(mpz_value(a1) / mpz::of_size_t(n2));
+        if (n2 == 0)
+            return a2;
+        if (!mpz_has_fast_limbs(a1))
+            return mpz_to_nat(mpz_value(a1) / mpz::of_size_t(n2));
+        mpz const & m = mpz_value(a1);
+        mpz::limb r[LEAN_MPZ_FAST_LIMBS + 2];
+        size_t rem;
+        return limbs_to_nat(mpz_limbs_divrem(r, m.limbs(), m.limb_size(), n2, rem), r);
     } else {
         lean_assert(mpz_value(a2) != 0);
         return mpz_to_nat(mpz_value(a1) / mpz_value(a2));
@@ -1212,8 +1474,14 @@ extern "C" LEAN_EXPORT object * lean_nat_big_mod(object * a1, object * a2) {
         if (n2 == 0) {
             lean_inc(a1);
             return a1;
-        } else {
+        } else if (!mpz_has_fast_limbs(a1)) {
             return mpz_to_nat(mpz_value(a1) % mpz::of_size_t(n2));
+        } else {
+            mpz const & m = mpz_value(a1);
+            mpz::limb r[LEAN_MPZ_FAST_LIMBS + 2];
+            size_t rem;
+            mpz_limbs_divrem(r, m.limbs(), m.limb_size(), n2, rem);
+            return lean_box(rem);
         }
     } else {
         lean_assert(mpz_value(a2) != 0);
@@ -1371,13 +1639,39 @@ inline object * mpz_to_int_core(mpz const & m) {
     return alloc_mpz(m);
 }
 
-static object * mpz_to_int(mpz const & m) {
+static object * mpz_to_int(mpz && m) {
     if (m < LEAN_MIN_SMALL_INT || m > LEAN_MAX_SMALL_INT)
-        return mpz_to_int_core(m);
+        return alloc_mpz(std::move(m));
     else
         return lean_box(static_cast<unsigned>(m.get_int()));
 }
 
+static inline obj_res limbs_to_int(bool neg, size_t n, mpz::limb const * d) {
+    size_t v;
+    if (limbs_to_size_t(n, d, v)) {
+        if (!neg && v <= static_cast<size_t>(LEAN_MAX_SMALL_INT))
+            return lean_box(static_cast<unsigned>(static_cast<int>(v)));
+        if (neg && v <= static_cast<size_t>(-static_cast<int64>(LEAN_MIN_SMALL_INT)))
+            return lean_box(static_cast<unsigned>(static_cast<int>(-static_cast<int64>(v))));
+    }
+    return alloc_mpz_limbs(neg, n, d);
+}
+
+static inline size_t int_magnitude(int i) {
+    return static_cast<size_t>(i < 0 ? -static_cast<int64>(i) : static_cast<int64>(i));
+}
+
+/* `(neg_a ? -|a| : |a|) + (neg_b ? -b : b)` for a bignum `a`. Recall that the magnitude of a big integer is
+   at least the magnitude of any small one, so the difference of magnitudes below cannot underflow. */
+static object * int_big_add_small(bool neg_a, b_obj_arg a, bool neg_b, size_t b) {
+    mpz const & m = mpz_value(a);
+    lean_assert(m.limb_size() <= LEAN_MPZ_FAST_LIMBS);
+    mpz::limb r[LEAN_MPZ_FAST_LIMBS + 2];
+    size_t n = neg_a == neg_b ? mpz_limbs_add(r, m.limbs(), m.limb_size(), b)
+                              : mpz_limbs_sub(r, m.limbs(), m.limb_size(), b);
+    return limbs_to_int(neg_a, n, r);
+}
+
 extern "C" LEAN_EXPORT lean_obj_res lean_big_int_to_nat(lean_obj_arg a) {
     lean_assert(!lean_is_scalar(a));
     mpz m = mpz_value(a);
@@ -1410,28 +1704,52 @@ extern "C" LEAN_EXPORT object * lean_int_big_neg(object * a) {
 }
 
 extern "C" LEAN_EXPORT object * lean_int_big_add(object * a1, object * a2) {
-    if (lean_is_scalar(a1))
-        return mpz_to_int(lean_scalar_to_int(a1) + mpz_value(a2));
-    else if (lean_is_scalar(a2))
-        return mpz_to_int(mpz_value(a1) + lean_scalar_to_int(a2));
-    else
+    if (lean_is_scalar(a1)) {
+        int i1 = lean_scalar_to_int(a1);
+        if (mpz_has_fast_limbs(a2))
+            return int_big_add_small(mpz_value(a2).is_neg(), a2, i1 < 0, int_magnitude(i1));
+        return mpz_to_int(i1 + mpz_value(a2));
+    } else if (lean_is_scalar(a2)) {
+        int i2 = lean_scalar_to_int(a2);
+        if (mpz_has_fast_limbs(a1))
+            return int_big_add_small(mpz_value(a1).is_neg(), a1, i2 < 0, int_magnitude(i2));
+        return mpz_to_int(mpz_value(a1) + i2);
+    } else {
         return mpz_to_int(mpz_value(a1) + mpz_value(a2));
+    }
 }
 
 extern "C" LEAN_EXPORT object * lean_int_big_sub(object * a1, object * a2) {
-    if (lean_is_scalar(a1))
-        return mpz_to_int(lean_scalar_to_int(a1) - mpz_value(a2));
-    else if (lean_is_scalar(a2))
-        return mpz_to_int(mpz_value(a1) - lean_scalar_to_int(a2));
-    else
+    if (lean_is_scalar(a1)) {
+        int i1 = lean_scalar_to_int(a1);
+        if (mpz_has_fast_limbs(a2))
+            return int_big_add_small(!mpz_value(a2).is_neg(), a2, i1 < 0, int_magnitude(i1));
+        return mpz_to_int(i1 - mpz_value(a2));
+    } else if (lean_is_scalar(a2)) {
+        int i2 = lean_scalar_to_int(a2);
+        if (mpz_has_fast_limbs(a1))
+            return int_big_add_small(mpz_value(a1).is_neg(), a1, i2 >= 0, int_magnitude(i2));
+        return mpz_to_int(mpz_value(a1) - i2);
+    } else {
         return mpz_to_int(mpz_value(a1) - mpz_value(a2));
+    }
+}
+
+/* `a * i` for a bignum `a`. */
+static object * int_big_mul_small(b_obj_arg a, int i) {
+    if (!mpz_has_fast_limbs(a))
+        return mpz_to_int(mpz_value(a) * i);
+    mpz const & m = mpz_value(a);
+    mpz::limb r[LEAN_MPZ_FAST_LIMBS + 2];
+    size_t n = mpz_limbs_mul(r, m.limbs(), m.limb_size(), int_magnitude(i));
+    return limbs_to_int(m.is_neg() != (i < 0), n, r);
 }
 
 extern "C" LEAN_EXPORT object * lean_int_big_mul(object * a1, object * a2) {
     if (lean_is_scalar(a1))
-        return mpz_to_int(lean_scalar_to_int(a1) * mpz_value(a2));
+        return int_big_mul_small(a2, lean_scalar_to_int(a1));
     else if (lean_is_scalar(a2))
-        return mpz_to_int(mpz_value(a1) * lean_scalar_to_int(a2));
+        return int_big_mul_small(a1, lean_scalar_to_int(a2));
     else
         return mpz_to_int(mpz_value(a1) * mpz_value(a2));
 }
@@ -1443,8 +1761,14 @@ extern "C" LEAN_EXPORT object * lean_int_big_div(object * a1, object * a2) {
         int d = lean_scalar_to_int(a2);
         if (d == 0)
             return a2;
-        else
+        if (!mpz_has_fast_limbs(a1))
             return mpz_to_int(mpz_value(a1) / d);
+        // truncated division: the quotient of the magnitudes, negated if exactly one operand is negative
+        mpz const & m = mpz_value(a1);
+        mpz::limb r[LEAN_MPZ_FAST_LIMBS + 2];
+        size_t rem;
+        size_t n = mpz_limbs_divrem(r, m.limbs(), m.limb_size(), int_magnitude(d), rem);
+        return limbs_to_int(m.is_neg() != (d < 0), n, r);
     } else {
         return mpz_to_int(mpz_value(a1) / mpz_value(a2));
     }
@@ -1458,8 +1782,16 @@ extern "C" LEAN_EXPORT object * lean_int_big_mod(object * a1, object * a2) {
         if (i2 == 0) {
             lean_inc(a1);
             return a1;
-        } else {
+        } else if (!mpz_has_fast_limbs(a1)) {
             return mpz_to_int(mpz_value(a1) % mpz(i2));
+        } else {
+            // truncated remainder: it has the sign of the dividend and fits in a scalar
+            mpz const & m = mpz_value(a1);
+            mpz::limb r[LEAN_MPZ_FAST_LIMBS + 2];
+            size_t rem;
+            mpz_limbs_divrem(r, m.limbs(), m.limb_size(), int_magnitude(i2), rem);
+            int64 v = m.is_neg() ? -static_cast<int64>(rem) : static_cast<int64>(rem);
+            return lean_box(static_cast<unsigned>(static_cast<int>(v)));
         }
     } else {
         return mpz_to_int(mpz_value(a1) % mpz_value(a2));
@@ -1617,7 +1949,13 @@ static object * string_ensure_capacity(object * o, size_t extra) {
     size_t sz  = string_size(o);
     size_t cap = string_capacity(o);
     if (sz + extra > cap) {
-        object * new_o = alloc_string(sz, cap + sz + extra, string_len(o));
+        size_t new_cap = cap + sz + extra;
+        if (lean_can_realloc(lean_string_byte_size(o), sizeof(lean_string_object) + new_cap)) {
+            object * new_o = lean_realloc_object(o, sizeof(lean_string_object) + new_cap);
+            lean_to_string(new_o)->m_capacity = new_cap;
+            return new_o;
+        }
+        object * new_o = alloc_string(sz, new_cap, string_len(o));
         lean_assert(string_capacity(new_o) >= sz + extra);
         memcpy(w_string_cstr(new_o), string_cstr(o), sz);
         lean_dealloc(o, lean_string_byte_size(o));
@@ -1724,26 +2062,66 @@ extern "C" LEAN_EXPORT object * lean_string_push(object * s, unsigned c) {
     return r;
 }
 
+/* Return an exclusive copy of `s`, or `s` itself if it is exclusive, with room for `extra` more bytes. */
+static object * string_reserve(object * s, size_t extra) {
+    if (!lean_is_exclusive(s)) {
+        size_t sz  = lean_string_size(s);
+        object * r = lean_alloc_string(sz, mk_capacity(sz + extra), lean_string_len(s));
+        memcpy(w_string_cstr(r), lean_string_cstr(s), sz);
+        dec_ref(s);
+        return r;
+    } else {
+        return string_ensure_capacity(s, extra);
+    }
+}
+
+/* Append the `n` bytes at `str`, which encode `len` characters, to `s`.
+   The bytes may belong to `s` when `s` is shared. */
+static object * string_append_bytes(object * s, char const * str, size_t n, size_t len) {
+    if (n == 0)
+        return s;
+    size_t sz  = lean_string_size(s);
+    lean_assert(!lean_is_exclusive(s) || str < lean_string_cstr(s) || str >= lean_string_cstr(s) + sz);
+    object * r = string_reserve(s, n);
+    memcpy(w_string_cstr(r) + sz - 1, str, n);
+    lean_to_string(r)->m_size    = sz + n;
+    lean_to_string(r)->m_length += len;
+    w_string_cstr(r)[sz + n - 1] = 0;
+    return r;
+}
+
 extern "C" LEAN_EXPORT object * lean_string_append(object * s1, object * s2) {
-    size_t sz1      = lean_string_size(s1);
-    size_t sz2      = lean_string_size(s2);
-    size_t len1     = lean_string_len(s1);
-    size_t len2     = lean_string_len(s2);
-    size_t new_len  = len1 + len2;
-    size_t new_sz   = sz1 + sz2 - 1;
-    object * r;
-    if (!lean_is_exclusive(s1)) {
-        r = lean_alloc_string(new_sz, mk_capacity(new_sz), new_len);
-        memcpy(w_string_cstr(r), lean_string_cstr(s1), sz1 - 1);
-        dec_ref(s1);
+    lean_assert(!lean_is_exclusive(s1) || s1 != s2);
+    return string_append_bytes(s1, lean_string_cstr(s2), lean_string_size(s2) - 1, lean_string_len(s2));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_string_pushn(obj_arg s, unsigned c, b_obj_arg n0) {
+    if (!lean_is_scalar(n0)) lean_internal_panic_out_of_memory();
+    size_t n = lean_unbox(n0);
+    if (n == 0)
+        return s;
+    char buf[8];
+    unsigned k = push_unicode_scalar(buf, c);
+    if (n > (LEAN_MAX_SMALL_NAT - lean_string_size(s)) / k) lean_internal_panic_out_of_memory();
+    size_t sz  = lean_string_size(s);
+    object * r = string_reserve(s, n * k);
+    char * it  = w_string_cstr(r) + sz - 1;
+    if (k == 1) {
+        memset(it, buf[0], n);
     } else {
-        lean_assert(s1 != s2);
-        r = string_ensure_capacity(s1, sz2-1);
+        for (size_t i = 0; i < n; i++, it += k)
+            memcpy(it, buf, k);
     }
-    memcpy(w_string_cstr(r) + sz1 - 1, lean_string_cstr(s2), sz2 - 1);
-    lean_to_string(r)->m_size   = new_sz;
-    lean_to_string(r)->m_length = new_len;
-    w_string_cstr(r)[new_sz - 1] = 0;
+    lean_to_string(r)->m_size    = sz + n * k;
+    lean_to_string(r)->m_length += n;
+    w_string_cstr(r)[sz + n * k - 1] = 0;
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_mk_empty_string_with_capacity(b_obj_arg capacity) {
+    if (!lean_is_scalar(capacity)) lean_internal_panic_out_of_memory();
+    object * r = lean_alloc_string(1, lean_unbox(capacity) + 1, 0);
+    w_string_cstr(r)[0] = 0;
     return r;
 }
 
@@ -2020,6 +2398,22 @@ extern "C" LEAN_EXPORT obj_res lean_string_utf8_extract(b_obj_arg s, b_obj_arg b
     return lean_mk_string_from_bytes_unchecked(lean_string_cstr(s) + b, new_sz);
 }
 
+/* `s ++ src.extract b e` without allocating the extracted string. */
+extern "C" LEAN_EXPORT obj_res lean_string_append_extract(obj_arg s, b_obj_arg src, b_obj_arg b0, b_obj_arg e0) {
+    if (!lean_is_scalar(b0))
+        return s;
+    char const * str = lean_string_cstr(src);
+    usize sz = lean_string_size(src) - 1;
+    usize b  = lean_unbox(b0);
+    usize e  = lean_is_scalar(e0) ? std::min(lean_unbox(e0), sz) : sz;
+    /* Same conventions for invalid positions as `lean_string_utf8_extract`. */
+    if (b >= e || !is_utf8_first_byte(str[b]))
+        return s;
+    if (e < sz && !is_utf8_first_byte(str[e]))
+        e = sz;
+    return string_append_bytes(s, str + b, e - b, utf8_strlen(str + b, e - b));
+}
+
 extern "C" LEAN_EXPORT obj_res lean_string_utf8_prev(b_obj_arg s, b_obj_arg i0) {
     if (!lean_is_scalar(i0)) {
         /* See comment at string_utf8_get */
@@ -2078,10 +2472,21 @@ extern "C" LEAN_EXPORT uint64 lean_string_hash(b_obj_arg s) {
     return hash_str(sz, (unsigned char const *) str, 11);
 }
 
+extern "C" LEAN_EXPORT uint64 lean_string_hash_with_seed(b_obj_arg s, uint64 seed) {
+    return hash_bytes(lean_string_size(s) - 1, (unsigned char const *) lean_string_cstr(s), seed);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_string_of_usize(size_t n) {
     return mk_ascii_string_unchecked(std::to_string(n));
 }
 
+extern "C" LEAN_EXPORT obj_res lean_nat_big_repr(b_obj_arg n) {
+    if (lean_is_scalar(n))
+        return mk_ascii_string_unchecked(std::to_string(lean_unbox(n)));
+    else
+        return mk_ascii_string_unchecked(mpz_value(n).to_string());
+}
+
 // =======================================
 // ByteArray & FloatArray
 
@@ -2101,10 +2506,16 @@ extern "C" LEAN_EXPORT obj_res lean_copy_sarray(obj_arg a, size_t cap) {
     unsigned esz   = lean_sarray_elem_size(a);
     size_t sz      = lean_sarray_size(a);
     lean_assert(cap >= sz);
+    size_t new_byte_sz = sizeof(lean_sarray_object) + lean_sarray_data_byte_size(esz, cap);
+    if (lean_is_exclusive(a) && !lean_sarray_is_mapped(a) && lean_can_realloc(lean_sarray_byte_size(a), new_byte_sz)) {
+        object * r = lean_realloc_object(a, new_byte_sz);
+        lean_to_sarray(r)->m_capacity = cap;
+        return r;
+    }
     object * r     = lean_alloc_sarray(esz, sz, cap);
     uint8 * it     = lean_sarray_cptr(a);
     uint8 * dest   = lean_sarray_cptr(r);
-    memcpy(dest, it, esz*sz);
+    memcpy(dest, it, lean_sarray_data_byte_size(esz, sz));
     lean_dec(a);
     return r;
 }
@@ -2167,7 +2578,8 @@ extern "C" LEAN_EXPORT obj_res lean_byte_array_push(obj_arg a, uint8 b) {
     return r;
 }
 
-    extern "C" LEAN_EXPORT obj_res lean_byte_array_copy_slice(b_obj_arg src, obj_arg o_src_off, obj_arg dest, obj_arg o_dest_off, obj_arg o_len, bool exact) {
+static obj_res lean_sarray_copy_slice(b_obj_arg src, obj_arg o_src_off, obj_arg dest, obj_arg o_dest_off, obj_arg o_len, bool exact) {
+    unsigned esz = lean_sarray_elem_size(src);
     size_t ssz = lean_sarray_size(src);
     size_t dsz = lean_sarray_size(dest);
     size_t src_off = lean_nat_to_size_t(o_src_off);
@@ -2183,14 +2595,62 @@ extern "C" LEAN_EXPORT obj_res lean_byte_array_push(obj_arg a, uint8 b) {
     object * r = lean_sarray_ensure_exclusive(lean_sarray_ensure_capacity(dest, new_dsz, exact));
     lean_to_sarray(r)->m_size = new_dsz;
     // `r` is exclusive, so the ranges definitely cannot overlap
-    memcpy(lean_sarray_cptr(r) + dest_off, lean_sarray_cptr(src) + src_off, len);
+    memcpy(lean_sarray_cptr(r) + esz*dest_off, lean_sarray_cptr(src) + esz*src_off, esz*len);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_byte_array_copy_slice(b_obj_arg src, obj_arg o_src_off, obj_arg dest, obj_arg o_dest_off, obj_arg o_len, bool exact) {
+    return lean_sarray_copy_slice(src, o_src_off, dest, o_dest_off, o_len, exact);
+}
+
+/* Convert a borrowed `Nat` into a `size_t`, saturating at `max`. */
+static inline size_t nat_to_size_t_sat(b_obj_arg n, size_t max) {
+    return lean_is_scalar(n) ? std::min(lean_unbox(n), max) : max;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_byte_array_fill(obj_arg a, b_obj_arg o_off, b_obj_arg o_len, uint8 v) {
+    size_t sz  = lean_sarray_size(a);
+    size_t off = nat_to_size_t_sat(o_off, sz);
+    size_t len = nat_to_size_t_sat(o_len, sz - off);
+    if (len == 0)
+        return a;
+    object * r = lean_sarray_ensure_exclusive(a);
+    memset(lean_sarray_cptr(r) + off, v, len);
     return r;
 }
 
+extern "C" LEAN_EXPORT obj_res lean_byte_array_index_of(b_obj_arg a, uint8 v, b_obj_arg o_start) {
+    size_t sz    = lean_sarray_size(a);
+    size_t start = nat_to_size_t_sat(o_start, sz);
+    uint8 * it   = lean_sarray_cptr(a);
+    void const * p = start < sz ? memchr(it + start, v, sz - start) : nullptr;
+    return lean_usize_to_nat(p ? static_cast<uint8 const *>(p) - it : sz);
+}
+
+extern "C" LEAN_EXPORT uint8 lean_byte_array_compare(b_obj_arg a, b_obj_arg b) {
+    size_t asz = lean_sarray_size(a);
+    size_t bsz = lean_sarray_size(b);
+    size_t n   = std::min(asz, bsz);
+    int c      = n == 0 ? 0 : memcmp(lean_sarray_cptr(a), lean_sarray_cptr(b), n);
+    if (c == 0)
+        c = asz < bsz ? -1 : (asz > bsz ? 1 : 0);
+    // `Ordering.lt`, `Ordering.eq`, `Ordering.gt`
+    return c < 0 ? 0 : (c == 0 ? 1 : 2);
+}
+
+extern "C" LEAN_EXPORT bool lean_byte_array_beq(b_obj_arg a, b_obj_arg b) {
+    size_t sz = lean_sarray_size(a);
+    return a == b || (sz == lean_sarray_size(b) && memcmp(lean_sarray_cptr(a), lean_sarray_cptr(b), sz) == 0);
+}
+
 extern "C" LEAN_EXPORT uint64_t lean_byte_array_hash(b_obj_arg a) {
     return hash_str(lean_sarray_size(a), lean_sarray_cptr(a), 11);
 }
 
+extern "C" LEAN_EXPORT uint64_t lean_byte_array_hash_with_seed(b_obj_arg a, uint64_t seed) {
+    return hash_bytes(lean_sarray_size(a), lean_sarray_cptr(a), seed);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_copy_float_array(obj_arg a) {
     return lean_copy_sarray(a, lean_sarray_capacity(a));
 }
@@ -2230,6 +2690,398 @@ extern "C" LEAN_EXPORT obj_res lean_float_array_push(obj_arg a, double d) {
     return r;
 }
 
+extern "C" LEAN_EXPORT obj_res lean_float_array_copy_slice(b_obj_arg src, obj_arg o_src_off, obj_arg dest, obj_arg o_dest_off, obj_arg o_len, bool exact) {
+    return lean_sarray_copy_slice(src, o_src_off, dest, o_dest_off, o_len, exact);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_float_array_fill(obj_arg a, b_obj_arg o_off, b_obj_arg o_len, double v) {
+    size_t sz  = lean_sarray_size(a);
+    size_t off = nat_to_size_t_sat(o_off, sz);
+    size_t len = nat_to_size_t_sat(o_len, sz - off);
+    if (len == 0)
+        return a;
+    object * r = lean_sarray_ensure_exclusive(a);
+    std::fill_n(lean_float_array_cptr(r) + off, len, v);
+    return r;
+}
+
+/* Return an exclusive float array of size `n` for the result of an element-wise operation whose first
+   operand is `a`. When `a` is exclusive its buffer is reused, and the kernels below write each element
+   after reading it, so `a` may alias the other operands. */
+static object * float_array_elementwise_result(obj_arg a, size_t n) {
+    if (lean_is_exclusive(a)) {
+        lean_to_sarray(a)->m_size = n;
+        return a;
+    } else {
+        return lean_alloc_sarray(sizeof(double), n, n); // NOLINT
+    }
+}
+
+/* The element-wise kernels are plain counted loops, which the compiler vectorizes at `-O3` for
+   whatever vector width the target provides. */
+extern "C" LEAN_EXPORT obj_res lean_float_array_add(obj_arg a, b_obj_arg b) {
+    size_t n   = std::min(lean_sarray_size(a), lean_sarray_size(b));
+    object * r = float_array_elementwise_result(a, n);
+    double const * x = lean_float_array_cptr(a);
+    double const * y = lean_float_array_cptr(b);
+    double * z       = lean_float_array_cptr(r);
+    for (size_t i = 0; i < n; i++)
+        z[i] = x[i] + y[i];
+    if (r != a) lean_dec(a);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_float_array_mul(obj_arg a, b_obj_arg b) {
+    size_t n   = std::min(lean_sarray_size(a), lean_sarray_size(b));
+    object * r = float_array_elementwise_result(a, n);
+    double const * x = lean_float_array_cptr(a);
+    double const * y = lean_float_array_cptr(b);
+    double * z       = lean_float_array_cptr(r);
+    for (size_t i = 0; i < n; i++)
+        z[i] = x[i] * y[i];
+    if (r != a) lean_dec(a);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_float_array_fma(obj_arg a, b_obj_arg b, b_obj_arg c) {
+    size_t n   = std::min(lean_sarray_size(a), std::min(lean_sarray_size(b), lean_sarray_size(c)));
+    object * r = float_array_elementwise_result(a, n);
+    double const * x = lean_float_array_cptr(a);
+    double const * y = lean_float_array_cptr(b);
+    double const * w = lean_float_array_cptr(c);
+    double * z       = lean_float_array_cptr(r);
+    for (size_t i = 0; i < n; i++)
+        z[i] = x[i] * y[i] + w[i];
+    if (r != a) lean_dec(a);
+    return r;
+}
+
+/* Reductions cannot be vectorized by the compiler without reassociating floating point additions, so
+   we do it explicitly: the sums below keep four independent partial sums and add them up at the end.
+   The result can therefore differ from a left fold in the last bits. */
+static double float_dot(double const * x, double const * y, size_t n) {
+    size_t i = 0;
+#if defined(LEAN_SARRAY_SSE2)
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(x + i),     _mm_loadu_pd(y + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    double p[2];
+    _mm_storeu_pd(p, _mm_add_pd(s0, s1));
+    double s = p[0] + p[1];
+#elif defined(LEAN_SARRAY_NEON)
+    float64x2_t s0 = vdupq_n_f64(0.0), s1 = vdupq_n_f64(0.0);
+    for (; i + 4 <= n; i += 4) {
+        s0 = vaddq_f64(s0, vmulq_f64(vld1q_f64(x + i),     vld1q_f64(y + i)));
+        s1 = vaddq_f64(s1, vmulq_f64(vld1q_f64(x + i + 2), vld1q_f64(y + i + 2)));
+    }
+    double s = vaddvq_f64(vaddq_f64(s0, s1));
+#else
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += x[i] * y[i];
+        s1 += x[i + 1] * y[i + 1];
+        s2 += x[i + 2] * y[i + 2];
+        s3 += x[i + 3] * y[i + 3];
+    }
+    double s = (s0 + s2) + (s1 + s3);
+#endif
+    for (; i < n; i++)
+        s += x[i] * y[i];
+    return s;
+}
+
+static double float_sum(double const * x, size_t n) {
+    size_t i = 0;
+#if defined(LEAN_SARRAY_SSE2)
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_pd(s0, _mm_loadu_pd(x + i));
+        s1 = _mm_add_pd(s1, _mm_loadu_pd(x + i + 2));
+    }
+    double p[2];
+    _mm_storeu_pd(p, _mm_add_pd(s0, s1));
+    double s = p[0] + p[1];
+#elif defined(LEAN_SARRAY_NEON)
+    float64x2_t s0 = vdupq_n_f64(0.0), s1 = vdupq_n_f64(0.0);
+    for (; i + 4 <= n; i += 4) {
+        s0 = vaddq_f64(s0, vld1q_f64(x + i));
+        s1 = vaddq_f64(s1, vld1q_f64(x + i + 2));
+    }
+    double s = vaddvq_f64(vaddq_f64(s0, s1));
+#else
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += x[i];
+        s1 += x[i + 1];
+        s2 += x[i + 2];
+        s3 += x[i + 3];
+    }
+    double s = (s0 + s2) + (s1 + s3);
+#endif
+    for (; i < n; i++)
+        s += x[i];
+    return s;
+}
+
+/* `min` and `max` skip `NaN` elements: `m = x < m ? x : m` keeps `m` when `x` is `NaN`. This is
+   exactly the semantics of `minpd`/`maxpd` with the element as first operand, and of `fminnm`/`fmaxnm`. */
+static double float_min(double const * x, size_t n) {
+    size_t i = 0;
+    double m = HUGE_VAL;
+#if defined(LEAN_SARRAY_SSE2)
+    if (n >= 4) {
+        __m128d m0 = _mm_set1_pd(m), m1 = m0;
+        for (; i + 4 <= n; i += 4) {
+            m0 = _mm_min_pd(_mm_loadu_pd(x + i),     m0);
+            m1 = _mm_min_pd(_mm_loadu_pd(x + i + 2), m1);
+        }
+        double p[2];
+        _mm_storeu_pd(p, _mm_min_pd(m0, m1));
+        m = std::min(p[0], p[1]);
+    }
+#elif defined(LEAN_SARRAY_NEON)
+    if (n >= 4) {
+        float64x2_t m0 = vdupq_n_f64(m), m1 = m0;
+        for (; i + 4 <= n; i += 4) {
+            m0 = vminnmq_f64(m0, vld1q_f64(x + i));
+            m1 = vminnmq_f64(m1, vld1q_f64(x + i + 2));
+        }
+        m = vminnmvq_f64(vminnmq_f64(m0, m1));
+    }
+#endif
+    for (; i < n; i++)
+        m = x[i] < m ? x[i] : m;
+    return m;
+}
+
+static double float_max(double const * x, size_t n) {
+    size_t i = 0;
+    double m = -HUGE_VAL;
+#if defined(LEAN_SARRAY_SSE2)
+    if (n >= 4) {
+        __m128d m0 = _mm_set1_pd(m), m1 = m0;
+        for (; i + 4 <= n; i += 4) {
+            m0 = _mm_max_pd(_mm_loadu_pd(x + i),     m0);
+            m1 = _mm_max_pd(_mm_loadu_pd(x + i + 2), m1);
+        }
+        double p[2];
+        _mm_storeu_pd(p, _mm_max_pd(m0, m1));
+        m = std::max(p[0], p[1]);
+    }
+#elif defined(LEAN_SARRAY_NEON)
+    if (n >= 4) {
+        float64x2_t m0 = vdupq_n_f64(m), m1 = m0;
+        for (; i + 4 <= n; i += 4) {
+            m0 = vmaxnmq_f64(m0, vld1q_f64(x + i));
+            m1 = vmaxnmq_f64(m1, vld1q_f64(x + i + 2));
+        }
+        m = vmaxnmvq_f64(vmaxnmq_f64(m0, m1));
+    }
+#endif
+    for (; i < n; i++)
+        m = x[i] > m ? x[i] : m;
+    return m;
+}
+
+extern "C" LEAN_EXPORT double lean_float_array_dot(b_obj_arg a, b_obj_arg b) {
+    return float_dot(lean_float_array_cptr(a), lean_float_array_cptr(b), std::min(lean_sarray_size(a), lean_sarray_size(b)));
+}
+
+extern "C" LEAN_EXPORT double lean_float_array_sum(b_obj_arg a) {
+    return float_sum(lean_float_array_cptr(a), lean_sarray_size(a));
+}
+
+extern "C" LEAN_EXPORT double lean_float_array_min(b_obj_arg a) {
+    return float_min(lean_float_array_cptr(a), lean_sarray_size(a));
+}
+
+extern "C" LEAN_EXPORT double lean_float_array_max(b_obj_arg a) {
+    return float_max(lean_float_array_cptr(a), lean_sarray_size(a));
+}
+
+// =======================================
+// BitArray
+
+static inline size_t bit_array_words(size_t n) {
+    return (n + 63) / 64;
+}
+
+/* Clear the bits of the last word of `a` past its size. */
+static inline void bit_array_clear_tail(object * a) {
+    size_t sz = lean_sarray_size(a);
+    if (sz % 64 != 0)
+        lean_bit_array_cptr(a)[sz / 64] &= (static_cast<uint64>(1) << (sz % 64)) - 1;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_copy_bit_array(obj_arg a) {
+    return lean_copy_sarray(a, lean_sarray_capacity(a));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_bit_array_mk(obj_arg a) {
+    usize sz      = lean_array_size(a);
+    obj_res r     = lean_alloc_sarray(LEAN_BIT_ARRAY_ELEM_SIZE, sz, sz);
+    object ** it  = lean_array_cptr(a);
+    uint64 * dest = lean_bit_array_cptr(r);
+    std::fill_n(dest, bit_array_words(sz), 0);
+    for (size_t i = 0; i < sz; i++) {
+        dest[i / 64] |= static_cast<uint64>(lean_unbox(it[i])) << (i % 64);
+    }
+    lean_dec(a);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_bit_array_data(obj_arg a) {
+    usize sz       = lean_sarray_size(a);
+    obj_res r      = lean_alloc_array(sz, sz);
+    object ** dest = lean_array_cptr(r);
+    for (size_t i = 0; i < sz; i++) {
+        dest[i] = lean_box(lean_bit_array_uget(a, i));
+    }
+    lean_dec(a);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_mk_bit_array(b_obj_arg o_n, uint8 v) {
+    if (!lean_is_scalar(o_n)) lean_internal_panic_out_of_memory();
+    size_t n  = lean_unbox(o_n);
+    obj_res r = lean_alloc_sarray(LEAN_BIT_ARRAY_ELEM_SIZE, n, n);
+    std::fill_n(lean_bit_array_cptr(r), bit_array_words(n), v ? ~static_cast<uint64>(0) : 0);
+    bit_array_clear_tail(r);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_bit_array_push(obj_arg a, uint8 b) {
+    object * r   = lean_sarray_ensure_exclusive(lean_sarray_ensure_capacity(a, lean_sarray_size(a) + 1, /* exact */ false));
+    size_t & sz  = lean_to_sarray(r)->m_size;
+    uint64 * it  = lean_bit_array_cptr(r) + sz / 64;
+    /* A word past the size is not initialized. */
+    uint64 w     = sz % 64 == 0 ? 0 : *it;
+    *it = w | (static_cast<uint64>(b) << (sz % 64));
+    sz++;
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_bit_array_popcount(b_obj_arg a) {
+    uint64 const * it = lean_bit_array_cptr(a);
+    size_t n = bit_array_words(lean_sarray_size(a));
+    size_t r = 0;
+    for (size_t i = 0; i < n; i++)
+        r += __builtin_popcountll(it[i]);
+    return lean_box(r);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_bit_array_find_first_set(b_obj_arg a, b_obj_arg o_start) {
+    size_t sz    = lean_sarray_size(a);
+    size_t start = nat_to_size_t_sat(o_start, sz);
+    if (start == sz)
+        return lean_box(sz);
+    uint64 const * it = lean_bit_array_cptr(a);
+    size_t n = bit_array_words(sz);
+    size_t i = start / 64;
+    uint64 w = it[i] & (~static_cast<uint64>(0) << (start % 64));
+    while (w == 0) {
+        if (++i == n)
+            return lean_box(sz);
+        w = it[i];
+    }
+    return lean_box(64*i + __builtin_ctzll(w));
+}
+
+/* Combine the words of `a` and `b` with `f`, reading the missing words of a shorter `b` as zero. The result
+   has the size of `a`, and reuses `a` when it is exclusive. */
+template<typename F>
+static obj_res bit_array_zip(obj_arg a, b_obj_arg b, F f) {
+    size_t sz  = lean_sarray_size(a);
+    size_t n   = bit_array_words(sz);
+    size_t m   = std::min(n, bit_array_words(lean_sarray_size(b)));
+    object * r = lean_is_exclusive(a) ? a : lean_alloc_sarray(LEAN_BIT_ARRAY_ELEM_SIZE, sz, sz);
+    uint64 const * x = lean_bit_array_cptr(a);
+    uint64 const * y = lean_bit_array_cptr(b);
+    uint64 * z       = lean_bit_array_cptr(r);
+    for (size_t i = 0; i < m; i++)
+        z[i] = f(x[i], y[i]);
+    for (size_t i = m; i < n; i++)
+        z[i] = f(x[i], 0);
+    bit_array_clear_tail(r);
+    if (r != a)
+        lean_dec(a);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_bit_array_and(obj_arg a, b_obj_arg b) {
+    return bit_array_zip(a, b, [](uint64 x, uint64 y) { return x & y; });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_bit_array_or(obj_arg a, b_obj_arg b) {
+    return bit_array_zip(a, b, [](uint64 x, uint64 y) { return x | y; });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_bit_array_xor(obj_arg a, b_obj_arg b) {
+    return bit_array_zip(a, b, [](uint64 x, uint64 y) { return x ^ y; });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_bit_array_not(obj_arg a) {
+    object * r = lean_sarray_ensure_exclusive(a);
+    uint64 * z = lean_bit_array_cptr(r);
+    size_t n   = bit_array_words(lean_sarray_size(r));
+    for (size_t i = 0; i < n; i++)
+        z[i] = ~z[i];
+    bit_array_clear_tail(r);
+    return r;
+}
+
+/* The shifts keep the size of `a`: `shiftLeft` moves bit `i` to `i + k`, and `shiftRight` moves it to `i - k`.
+   Whole-word moves and the bit shift within words are done in one pass, in place when `a` is exclusive. */
+
+extern "C" LEAN_EXPORT obj_res lean_bit_array_shift_left(obj_arg a, b_obj_arg o_k) {
+    object * r = lean_sarray_ensure_exclusive(a);
+    size_t sz  = lean_sarray_size(r);
+    size_t k   = nat_to_size_t_sat(o_k, sz);
+    size_t n   = bit_array_words(sz);
+    size_t q   = k / 64;
+    unsigned s = k % 64;
+    uint64 * z = lean_bit_array_cptr(r);
+    for (size_t i = n; i-- > 0;) {
+        uint64 w = 0;
+        if (i >= q) {
+            w = z[i - q] << s;
+            if (s != 0 && i > q)
+                w |= z[i - q - 1] >> (64 - s);
+        }
+        z[i] = w;
+    }
+    bit_array_clear_tail(r);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_bit_array_shift_right(obj_arg a, b_obj_arg o_k) {
+    object * r = lean_sarray_ensure_exclusive(a);
+    size_t sz  = lean_sarray_size(r);
+    size_t k   = nat_to_size_t_sat(o_k, sz);
+    size_t n   = bit_array_words(sz);
+    size_t q   = k / 64;
+    unsigned s = k % 64;
+    uint64 * z = lean_bit_array_cptr(r);
+    for (size_t i = 0; i < n; i++) {
+        uint64 w = 0;
+        if (i + q < n) {
+            w = z[i + q] >> s;
+            if (s != 0 && i + q + 1 < n)
+                w |= z[i + q + 1] << (64 - s);
+        }
+        z[i] = w;
+    }
+    return r;
+}
+
+extern "C" LEAN_EXPORT bool lean_bit_array_beq(b_obj_arg a, b_obj_arg b) {
+    size_t sz = lean_sarray_size(a);
+    return a == b || (sz == lean_sarray_size(b) &&
+                      memcmp(lean_bit_array_cptr(a), lean_bit_array_cptr(b), lean_sarray_data_byte_size(LEAN_BIT_ARRAY_ELEM_SIZE, sz)) == 0);
+}
+
 // =======================================
 // Array functions for generated code
 
@@ -2263,6 +3115,11 @@ extern "C" LEAN_EXPORT obj_res lean_copy_expand_array(obj_arg a, bool expand) {
     lean_assert(cap >= sz);
     if (expand) cap = (cap + 1) * 2;
     lean_assert(!expand || cap > sz);
+    if (expand && lean_is_exclusive(a) && lean_can_realloc(lean_array_byte_size(a), sizeof(lean_array_object) + sizeof(void*)*cap)) {
+        object * r = lean_realloc_object(a, sizeof(lean_array_object) + sizeof(void*)*cap);
+        lean_to_array(r)->m_capacity = cap;
+        return r;
+    }
     object * r     = lean_alloc_array(sz, cap);
     object ** it   = lean_array_cptr(a);
     object ** end  = it + sz;
@@ -6,6 +6,8 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <string>
+#include <algorithm>
+#include <utility>
 #include <lean/lean.h>
 #include "runtime/mpz.h"
 
@@ -28,6 +30,17 @@ struct mpz_object {
     mpz         m_value;
     mpz_object() {}
     explicit mpz_object(mpz const & m):m_value(m) {}
+    explicit mpz_object(mpz && m):m_value(std::move(m)) {}
+    /* Store the `n > 0` limbs `d` right after the object instead of in a separate heap block.
+       The object must have been allocated with room for them, see `alloc_mpz_limbs`. */
+    mpz_object(bool neg, size_t n, mpz::limb const * d):m_value(neg, n, copy_inline_limbs(n, d), mpz::view_tag()) {}
+    bool has_inline_limbs() const { return m_value.limbs() == reinterpret_cast<mpz::limb const *>(this + 1); }
+private:
+    mpz::limb * copy_inline_limbs(size_t n, mpz::limb const * d) {
+        mpz::limb * r = reinterpret_cast<mpz::limb *>(this + 1);
+        std::copy(d, d + n, r);
+        return r;
+    }
 };
 
 typedef lean_external_class         external_object_class;
@@ -178,6 +191,7 @@ inline object* apply_m(object* f, unsigned n, object** args) { return lean_apply
 // MPZ
 
 LEAN_EXPORT object * alloc_mpz(mpz const &);
+LEAN_EXPORT object * alloc_mpz(mpz &&);
 inline mpz_object * to_mpz(object * o) { lean_assert(is_mpz(o)); return (mpz_object*)o; }
 
 // =======================================
@@ -219,6 +233,13 @@ inline unsigned sarray_elem_size(object * o) { return lean_sarray_elem_size(o);
 inline size_t sarray_capacity(object * o) { return lean_sarray_capacity(o); }
 inline uint8 * sarray_cptr(object * o) { return lean_sarray_cptr(o); }
 
+#if !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+#define LEAN_MAPPED_SARRAY
+/* Return a byte array whose data is a private memory mapping of the first `size > 0` bytes of `fd`,
+   or `nullptr` with `errno` set on failure. */
+object * alloc_mapped_byte_array(int fd, size_t size);
+#endif
+
 // =======================================
 // ByteArray
 
@@ -9,6 +9,10 @@ Author: Jared Roesch
 #include <iostream>
 #include <iomanip>
 #include <utility>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <algorithm>
 #include <system_error>
 
 #if defined(LEAN_WINDOWS)
@@ -24,7 +28,24 @@ Author: Jared Roesch
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <spawn.h>
+#include <sys/stat.h>
 #include <limits.h> // NOLINT
+#include <poll.h>
+#include <cstring>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#if (defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))) || defined(__APPLE__)
+// `posix_spawn_file_actions_addchdir_np` is available
+#define LEAN_SPAWN_ADDCHDIR
+#endif
+#if defined(__APPLE__)
+#include <crt_externs.h>
+#define environ (*_NSGetEnviron())
+#else
+extern char ** environ;
+#endif
 #endif
 
 #include "runtime/object.h"
@@ -43,6 +64,14 @@ enum stdio {
     NUL,
 };
 
+/* `some (i, exitCode)` */
+static obj_res mk_wait_any_result(size_t i, unsigned exit_code) {
+    object * p = alloc_cnstr(0, 2, 0);
+    cnstr_set(p, 0, lean_usize_to_nat(i));
+    cnstr_set(p, 1, box_uint32(exit_code));
+    return mk_option_some(p);
+}
+
 #if defined(LEAN_WINDOWS)
 
 static lean_external_class * g_win_handle_external_class = nullptr;
@@ -116,6 +145,42 @@ extern "C" LEAN_EXPORT obj_res lean_io_process_child_kill(b_obj_arg, b_obj_arg c
     return lean_io_result_mk_ok(box(0));
 }
 
+/* Child.waitAnyCore : (@& Array (Child cfg)) → (timeoutMs : UInt32) → IO (Option (Nat × UInt32)) */
+extern "C" LEAN_EXPORT obj_res lean_io_process_child_wait_any(b_obj_arg, b_obj_arg children, uint32 timeout_ms, obj_arg) {
+    size_t n = lean_array_size(children);
+    std::vector<HANDLE> hs;
+    for (size_t i = 0; i < n; i++) {
+        hs.push_back(static_cast<HANDLE>(lean_get_external_data(cnstr_get(lean_array_get_core(children, i), 3))));
+    }
+    if (n == 0) return io_result_mk_ok(mk_option_none());
+    auto start = std::chrono::steady_clock::now();
+    DWORD delay = 1;
+    while (true) {
+        // `WaitForMultipleObjects` is limited to `MAXIMUM_WAIT_OBJECTS` handles, so we wait on larger sets in turn
+        for (size_t b = 0; b < n; b += MAXIMUM_WAIT_OBJECTS) {
+            DWORD k = static_cast<DWORD>(std::min<size_t>(n - b, MAXIMUM_WAIT_OBJECTS));
+            DWORD ret = WaitForMultipleObjects(k, hs.data() + b, FALSE, n <= MAXIMUM_WAIT_OBJECTS ? timeout_ms : 0);
+            if (ret == WAIT_FAILED) {
+                return io_result_mk_error((sstream() << GetLastError()).str());
+            }
+            if (ret >= WAIT_OBJECT_0 && ret < WAIT_OBJECT_0 + k) {
+                size_t i = b + (ret - WAIT_OBJECT_0);
+                DWORD exit_code;
+                if (!GetExitCodeProcess(hs[i], &exit_code)) {
+                    return io_result_mk_error((sstream() << GetLastError()).str());
+                }
+                return io_result_mk_ok(mk_wait_any_result(i, exit_code));
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        if (n <= MAXIMUM_WAIT_OBJECTS || (timeout_ms != UINT32_MAX && elapsed >= timeout_ms)) {
+            return io_result_mk_ok(mk_option_none());
+        }
+        Sleep(delay);
+        delay = std::min<DWORD>(2 * delay, 16);
+    }
+}
+
 static FILE * from_win_handle(HANDLE handle, char const * mode) {
     int fd = _open_osfhandle(reinterpret_cast<intptr_t>(handle), _O_APPEND);
     return fdopen(fd, mode);
@@ -364,6 +429,81 @@ extern "C" LEAN_EXPORT obj_res lean_io_process_child_kill(b_obj_arg, b_obj_arg c
     return lean_io_result_mk_ok(box(0));
 }
 
+static unsigned exit_code_of_status(int status) {
+    if (WIFEXITED(status)) {
+        return static_cast<unsigned>(WEXITSTATUS(status));
+    } else {
+        lean_assert(WIFSIGNALED(status));
+        // use bash's convention
+        return 128 + static_cast<unsigned>(WTERMSIG(status));
+    }
+}
+
+/* Child.waitAnyCore : (@& Array (Child cfg)) → (timeoutMs : UInt32) → IO (Option (Nat × UInt32)) */
+extern "C" LEAN_EXPORT obj_res lean_io_process_child_wait_any(b_obj_arg, b_obj_arg children, uint32 timeout_ms, obj_arg) {
+    size_t n = lean_array_size(children);
+    std::vector<pid_t> pids;
+    for (size_t i = 0; i < n; i++) {
+        pids.push_back(cnstr_get_uint32(lean_array_get_core(children, i), 3 * sizeof(object *)));
+    }
+    if (n == 0) return io_result_mk_ok(mk_option_none());
+    auto start = std::chrono::steady_clock::now();
+    auto remaining_ms = [&]() -> int {
+        if (timeout_ms == UINT32_MAX) return -1;
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        return elapsed >= timeout_ms ? 0 : static_cast<int>(std::min<int64>(timeout_ms - elapsed, INT32_MAX));
+    };
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    // wait for any of the children to exit using process file descriptors (Linux 5.3+)
+    std::vector<pollfd> fds;
+    for (pid_t pid : pids) {
+        int fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+        if (fd < 0) break;
+        fds.push_back(pollfd{fd, POLLIN, 0});
+    }
+    bool use_pidfds = fds.size() == n;
+    if (!use_pidfds) {
+        for (pollfd & p : fds) close(p.fd);
+        fds.clear();
+    }
+#endif
+    int delay_ms = 1;
+    while (true) {
+        for (size_t i = 0; i < n; i++) {
+            int status;
+            pid_t r = waitpid(pids[i], &status, WNOHANG);
+            if (r == 0) continue;
+#if defined(__linux__) && defined(SYS_pidfd_open)
+            for (pollfd & p : fds) close(p.fd);
+#endif
+            if (r == -1) return io_result_mk_error(decode_io_error(errno, nullptr));
+            return io_result_mk_ok(mk_wait_any_result(i, exit_code_of_status(status)));
+        }
+        int rem = remaining_ms();
+#if defined(__linux__) && defined(SYS_pidfd_open)
+        if (use_pidfds) {
+            if (rem == 0) break;
+            if (poll(fds.data(), fds.size(), rem) < 0 && errno != EINTR) {
+                int err = errno;
+                for (pollfd & p : fds) close(p.fd);
+                return io_result_mk_error(decode_io_error(err, nullptr));
+            }
+            continue;
+        }
+#endif
+        // no way to wait for a set of children without reaping other children of the process; poll with
+        // increasing delays
+        if (rem == 0) break;
+        int d = rem < 0 ? delay_ms : std::min(delay_ms, rem);
+        usleep(d * 1000);
+        delay_ms = std::min(2 * delay_ms, 16);
+    }
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    for (pollfd & p : fds) close(p.fd);
+#endif
+    return io_result_mk_ok(mk_option_none());
+}
+
 struct pipe { int m_read_fd; int m_write_fd; };
 
 static optional<pipe> setup_stdio(stdio cfg) {
@@ -390,74 +530,206 @@ static optional<pipe> setup_stdio(stdio cfg) {
     lean_unreachable();
 }
 
+/*
+  Everything the child needs, prepared in the parent: the child is started with `posix_spawn` or `vfork`,
+  where it shares the memory of the parent and may only make async-signal-safe calls before `exec`. */
+struct spawn_request {
+    std::string              m_path;     // executable, resolved against `PATH`
+    std::deque<std::string>  m_strings;  // storage for `m_argv`, `m_sh_argv` and `m_envp`, which must not move
+    std::vector<char *>      m_argv;
+    std::vector<char *>      m_sh_argv;  // `/bin/sh m_path args...`, used if `m_path` is not a binary (`ENOEXEC`)
+    std::vector<char *>      m_envp;
+    bool                     m_own_env = false;
+};
+
+static std::vector<char *> null_terminated(std::deque<std::string> & strs, size_t begin, size_t end) {
+    std::vector<char *> r;
+    for (size_t i = begin; i < end; i++) r.push_back(&strs[i][0]);
+    r.push_back(nullptr);
+    return r;
+}
+
+/* Applies the modifications `env` to the environment of the current process. */
+static void setup_env(spawn_request & req, array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env) {
+    if (env.size() == 0) return;
+    req.m_own_env = true;
+    std::vector<std::string> vars;
+    for (char ** e = environ; *e; e++) vars.push_back(*e);
+    for (auto & entry : env) {
+        std::string key(entry.fst().data());
+        auto it = std::find_if(vars.begin(), vars.end(), [&](std::string const & v) {
+            return v.size() > key.size() && v[key.size()] == '=' && v.compare(0, key.size(), key) == 0;
+        });
+        if (it != vars.end()) vars.erase(it);
+        if (entry.snd()) vars.push_back(key + "=" + entry.snd().get()->data());
+    }
+    size_t begin = req.m_strings.size();
+    for (std::string & v : vars) req.m_strings.push_back(std::move(v));
+    req.m_envp = null_terminated(req.m_strings, begin, req.m_strings.size());
+}
+
+static char * const * spawn_envp(spawn_request & req) {
+    return req.m_own_env ? req.m_envp.data() : environ;
+}
+
+/*
+  Resolves `name` like `execvp` does, but against the `PATH` of the child's environment. Relative entries of
+  `PATH` are relative to the working directory `cwd` of the child, if set, and are kept relative in `m_path` as
+  `exec` runs after changing to `cwd`. */
+static int resolve_executable(spawn_request & req, char const * name, char const * cwd) {
+    if (strchr(name, '/')) {
+        req.m_path = name;
+        return 0;
+    }
+    char const * path = nullptr;
+    if (req.m_own_env) {
+        for (char * const * e = spawn_envp(req); *e; e++) {
+            if (strncmp(*e, "PATH=", 5) == 0) path = *e + 5;
+        }
+    } else {
+        path = getenv("PATH");
+    }
+    if (!path) path = "/bin:/usr/bin";
+    int err = ENOENT;
+    while (true) {
+        char const * end = strchr(path, ':');
+        if (!end) end = path + strlen(path);
+        std::string dir(path, end);
+        std::string cand = (dir.empty() ? std::string(".") : dir) + "/" + name;
+        std::string check = cwd && cand[0] != '/' ? std::string(cwd) + "/" + cand : cand;
+        struct stat st;
+        if (stat(check.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            if (access(check.c_str(), X_OK) == 0) {
+                req.m_path = cand;
+                return 0;
+            }
+            err = EACCES;
+        }
+        if (*end == 0) return err;
+        path = end + 1;
+    }
+}
+
+/* Dup `fd` onto the standard stream `target` in a `vfork`ed child. */
+static bool child_dup(int fd, int target) {
+    return fd == target || dup2(fd, target) >= 0;
+}
+
 static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const & args, stdio stdin_mode, stdio stdout_mode,
   stdio stderr_mode, option_ref<string_ref> const & cwd, array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env,
   bool do_setsid) {
+    spawn_request req;
+    setup_env(req, env);
+    if (int err = resolve_executable(req, proc_name.data(), cwd ? cwd.get()->data() : nullptr)) {
+        throw err;
+    }
+    size_t argv_begin = req.m_strings.size();
+    req.m_strings.push_back(proc_name.data());
+    for (auto & arg : args)
+        req.m_strings.push_back(arg.data());
+    req.m_argv = null_terminated(req.m_strings, argv_begin, req.m_strings.size());
+    // like `execvp`, run files that are not binaries (e.g. scripts without `#!`) with the shell
+    req.m_strings.push_back("/bin/sh");
+    req.m_strings.push_back(req.m_path);
+    req.m_sh_argv = null_terminated(req.m_strings, req.m_strings.size() - 2, req.m_strings.size());
+    req.m_sh_argv.pop_back();
+    req.m_sh_argv.insert(req.m_sh_argv.end(), req.m_argv.begin() + 1, req.m_argv.end());
+
     /* Setup stdio based on process configuration. */
     auto stdin_pipe  = setup_stdio(stdin_mode);
     auto stdout_pipe = setup_stdio(stdout_mode);
     auto stderr_pipe = setup_stdio(stderr_mode);
-
-    int pid = fork();
-
-    if (pid == 0) {
-        for (auto & entry : env) {
-            if (entry.snd()) {
-                setenv(entry.fst().data(), entry.snd().get()->data(), true);
-            } else {
-                unsetenv(entry.fst().data());
+    // shared by all streams configured as `Stdio.null`, and closed again once the child has been started
+    int null_fd = -1;
+    auto close_pipes = [&]() {
+        for (auto * p : {&stdin_pipe, &stdout_pipe, &stderr_pipe}) {
+            if (*p) {
+                close((*p)->m_read_fd);
+                close((*p)->m_write_fd);
             }
         }
-
-        if (stdin_pipe) {
-            dup2(stdin_pipe->m_read_fd, STDIN_FILENO);
-            close(stdin_pipe->m_write_fd);
-        } else if (stdin_mode == stdio::NUL) {
-            int fd = open("/dev/null", O_RDONLY);
-            dup2(fd, STDIN_FILENO);
+        if (null_fd >= 0) close(null_fd);
+    };
+    if (stdin_mode == stdio::NUL || stdout_mode == stdio::NUL || stderr_mode == stdio::NUL) {
+        null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+        if (null_fd < 0) {
+            int err = errno;
+            close_pipes();
+            throw err;
         }
-
-        if (stdout_pipe) {
-            dup2(stdout_pipe->m_write_fd, STDOUT_FILENO);
-            close(stdout_pipe->m_read_fd);
-        } else if (stdout_mode == stdio::NUL) {
-            int fd = open("/dev/null", O_WRONLY);
-            dup2(fd, STDOUT_FILENO);
+    }
+    // the child's end of each pipe, or `/dev/null`, or the stream itself for `inherit`
+    int fds[3] = {
+        stdin_pipe  ? stdin_pipe->m_read_fd   : stdin_mode  == stdio::NUL ? null_fd : STDIN_FILENO,
+        stdout_pipe ? stdout_pipe->m_write_fd : stdout_mode == stdio::NUL ? null_fd : STDOUT_FILENO,
+        stderr_pipe ? stderr_pipe->m_write_fd : stderr_mode == stdio::NUL ? null_fd : STDERR_FILENO,
+    };
+
+    pid_t pid;
+    bool use_posix_spawn = true;
+#if !defined(LEAN_SPAWN_ADDCHDIR)
+    if (cwd) use_posix_spawn = false;
+#endif
+#if !defined(POSIX_SPAWN_SETSID)
+    if (do_setsid) use_posix_spawn = false;
+#endif
+    if (use_posix_spawn) {
+        posix_spawn_file_actions_t actions;
+        posix_spawnattr_t attr;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawnattr_init(&attr);
+        for (int i = 0; i < 3; i++) {
+            if (fds[i] != i) {
+                posix_spawn_file_actions_adddup2(&actions, fds[i], i);
+            }
         }
-
-        if (stderr_pipe) {
-            dup2(stderr_pipe->m_write_fd, STDERR_FILENO);
-            close(stderr_pipe->m_read_fd);
-        } else if (stderr_mode == stdio::NUL) {
-            int fd = open("/dev/null", O_WRONLY);
-            dup2(fd, STDERR_FILENO);
+#if defined(LEAN_SPAWN_ADDCHDIR)
+        if (cwd) posix_spawn_file_actions_addchdir_np(&actions, cwd.get()->data());
+#endif
+#if defined(POSIX_SPAWN_SETSID)
+        if (do_setsid) posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+#endif
+        int err = posix_spawn(&pid, req.m_path.c_str(), &actions, &attr, req.m_argv.data(), spawn_envp(req));
+        if (err == ENOEXEC) {
+            err = posix_spawn(&pid, "/bin/sh", &actions, &attr, req.m_sh_argv.data(), spawn_envp(req));
         }
-
-        if (cwd) {
-            if (chdir(cwd.get()->data()) < 0) {
-                std::cerr << "could not change directory to " << cwd.get()->data() << std::endl;
-                exit(-1);
-            }
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attr);
+        if (err != 0) {
+            close_pipes();
+            throw err;
         }
-
-        if (do_setsid) {
-            lean_always_assert(setsid() >= 0);
+    } else {
+        // Set by the child if it fails before `exec`. The child shares our memory until then.
+        volatile int child_err = 0;
+        char const * dir = cwd ? cwd.get()->data() : nullptr;
+        pid = vfork();
+        if (pid == 0) {
+            for (int i = 0; i < 3; i++) {
+                if (!child_dup(fds[i], i)) {
+                    child_err = errno;
+                    _exit(127);
+                }
+            }
+            if ((dir && chdir(dir) < 0) || (do_setsid && setsid() < 0)) {
+                child_err = errno;
+                _exit(127);
+            }
+            execve(req.m_path.c_str(), req.m_argv.data(), spawn_envp(req));
+            if (errno == ENOEXEC) execve("/bin/sh", req.m_sh_argv.data(), spawn_envp(req));
+            child_err = errno;
+            _exit(127);
         }
-
-        buffer<char *> pargs;
-        pargs.push_back(strdup(proc_name.data()));
-        for (auto & arg : args)
-            pargs.push_back(strdup(arg.data()));
-        pargs.push_back(NULL);
-
-        if (execvp(pargs[0], pargs.data()) < 0) {
-            std::cerr << "could not execute external process '" << pargs[0] << "'" << std::endl;
-            exit(-1);
+        if (pid == -1 || child_err != 0) {
+            int err = pid == -1 ? errno : child_err;
+            if (pid != -1) waitpid(pid, nullptr, 0);
+            close_pipes();
+            throw err;
         }
-    } else if (pid == -1) {
-        throw errno;
     }
 
+    if (null_fd >= 0) close(null_fd);
+
     object * parent_stdin  = box(0);
     object * parent_stdout = box(0);
     object * parent_stderr = box(0);
@@ -498,12 +770,11 @@ void finalize_process() {}
 
 extern "C" lean_object* lean_mk_io_error_other_error(uint32_t, lean_object*);
 
-extern "C" LEAN_EXPORT obj_res lean_io_process_spawn(obj_arg args_, obj_arg) {
-    object_ref args(args_);
-    object_ref stdio_cfg = cnstr_get_ref(args, 0);
-    stdio stdin_mode  = static_cast<stdio>(cnstr_get_uint8(stdio_cfg.raw(), 0));
-    stdio stdout_mode = static_cast<stdio>(cnstr_get_uint8(stdio_cfg.raw(), 1));
-    stdio stderr_mode = static_cast<stdio>(cnstr_get_uint8(stdio_cfg.raw(), 2));
+/* Spawns the process described by the `SpawnArgs` object `args` with the stream configuration `stdio_cfg`. */
+static obj_res spawn(object_ref const & args, b_obj_arg stdio_cfg) {
+    stdio stdin_mode  = static_cast<stdio>(cnstr_get_uint8(stdio_cfg, 0));
+    stdio stdout_mode = static_cast<stdio>(cnstr_get_uint8(stdio_cfg, 1));
+    stdio stderr_mode = static_cast<stdio>(cnstr_get_uint8(stdio_cfg, 2));
     if (stdin_mode == stdio::INHERIT) {
         std::cout.flush();
     }
@@ -518,11 +789,41 @@ extern "C" LEAN_EXPORT obj_res lean_io_process_spawn(obj_arg args_, obj_arg) {
                 cnstr_get_ref_t<array_ref<pair_ref<string_ref, option_ref<string_ref>>>>(args, 4),
                 cnstr_get_uint8(args.raw(), 5 * sizeof(object *)));
     } catch (int err) {
-        return lean_io_result_mk_error(decode_io_error(err, nullptr));
+        return lean_io_result_mk_error(decode_io_error(err, cnstr_get(args.raw(), 1)));
     } catch (std::system_error const & err) {
         // TODO: decode
         return lean_io_result_mk_error(lean_mk_io_error_other_error(err.code().value(), mk_string(err.code().message())));
     }
 }
 
+extern "C" LEAN_EXPORT obj_res lean_io_process_spawn(obj_arg args_, obj_arg) {
+    object_ref args(args_);
+    return spawn(args, cnstr_get(args.raw(), 0));
+}
+
+/* spawnMany (cfg : @& StdioConfig) (args : @& Array SpawnArgs) : IO (Array (Child cfg)) */
+extern "C" LEAN_EXPORT obj_res lean_io_process_spawn_many(b_obj_arg cfg, b_obj_arg args, obj_arg) {
+    size_t n = lean_array_size(args);
+    object * children = lean_alloc_array(0, n);
+    for (size_t i = 0; i < n; i++) {
+        object_ref a(lean_array_get_core(args, i), true);
+        obj_res r = spawn(a, cfg);
+        if (lean_io_result_is_error(r)) {
+            // do not leave the children spawned so far behind
+            for (size_t j = 0; j < lean_array_size(children); j++) {
+                object * child = lean_array_get_core(children, j);
+                lean_dec(lean_io_process_child_kill(box(0), child, box(0)));
+                lean_dec(lean_io_process_child_wait(box(0), child, box(0)));
+            }
+            lean_dec(children);
+            return r;
+        }
+        object * child = lean_io_result_get_value(r);
+        lean_inc(child);
+        lean_dec(r);
+        children = lean_array_push(children, child);
+    }
+    return io_result_mk_ok(children);
+}
+
 }
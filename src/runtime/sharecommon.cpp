@@ -184,7 +184,7 @@ class sharecommon_fn {
         size_t sz        = lean_sarray_size(a);
         unsigned elem_sz = lean_sarray_elem_size(a);
         lean_sarray_object * new_a = (lean_sarray_object*)lean_alloc_sarray(elem_sz, sz, sz);
-        memcpy(new_a->m_data, lean_to_sarray(a)->m_data, elem_sz*sz);
+        memcpy(new_a->m_data, lean_to_sarray(a)->m_data, lean_sarray_data_byte_size(elem_sz, sz));
         save(a, (lean_object*)new_a);
     }
 
@@ -5,7 +5,15 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include <cstdlib>
+#include <cstring>
 #include <string>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define LEAN_UTF8_X86
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LEAN_UTF8_NEON
+#endif
 #include "runtime/debug.h"
 #include "runtime/optional.h"
 #include "runtime/utf8.h"
@@ -32,29 +40,51 @@ unsigned get_utf8_size(unsigned char c) {
         return 1; /* invalid */
 }
 
-extern "C" LEAN_EXPORT size_t lean_utf8_strlen(char const * str) {
+/* Number of UTF-8 continuation bytes (`10xxxxxx`) in the 8 bytes stored in `w`. */
+static inline unsigned num_utf8_cont_bytes(uint64_t w) {
+    return __builtin_popcountll(w & ~(w << 1) & 0x8080808080808080ull);
+}
+
+/* Number of UTF-8 continuation bytes in `str[0, sz)`. */
+static size_t count_utf8_cont_bytes(char const * str, size_t sz) {
     size_t r = 0;
-    while (*str != 0) {
-        unsigned sz = get_utf8_size(*str);
-        r++;
-        str += sz;
+    size_t i = 0;
+#if defined(LEAN_UTF8_X86)
+    /* SSE2 is part of x86-64, no need for runtime dispatch */
+    /* As signed bytes, continuation bytes are the ones smaller than -64 (0xC0) */
+    __m128i const min_lead = _mm_set1_epi8(-64);
+    for (; i + 16 <= sz; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(str + i));
+        r += __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(min_lead, v)));
+    }
+#elif defined(LEAN_UTF8_NEON)
+    for (; i + 16 <= sz; i += 16) {
+        int8x16_t v = vld1q_s8(reinterpret_cast<int8_t const *>(str + i));
+        r += vaddvq_u8(vandq_u8(vcltq_s8(v, vdupq_n_s8(-64)), vdupq_n_u8(1)));
+    }
+#endif
+    for (; i + 8 <= sz; i += 8) {
+        uint64_t w;
+        memcpy(&w, str + i, 8);
+        r += num_utf8_cont_bytes(w);
+    }
+    for (; i < sz; i++) {
+        r += is_utf8_next(str[i]);
     }
     return r;
 }
 
+extern "C" LEAN_EXPORT size_t lean_utf8_strlen(char const * str) {
+    return lean_utf8_n_strlen(str, strlen(str));
+}
+
 size_t utf8_strlen(char const * str) {
     return lean_utf8_strlen(str);
 }
 
+/* For valid UTF-8, the number of unicode scalar values is the number of bytes that are not continuation bytes. */
 extern "C" LEAN_EXPORT size_t lean_utf8_n_strlen(char const * str, size_t sz) {
-    size_t r = 0;
-    size_t i = 0;
-    while (i < sz) {
-        unsigned d = get_utf8_size(str[i]);
-        r++;
-        i += d;
-    }
-    return r;
+    return sz - count_utf8_cont_bytes(str, sz);
 }
 
 size_t utf8_strlen(char const * str, size_t sz) {
@@ -267,8 +297,265 @@ bool validate_utf8_one(uint8_t const * str, size_t size, size_t & pos) {
     return true;
 }
 
+/*
+Vectorized UTF-8 validation, following "Validating UTF-8 In Less Than One Instruction Per Byte" (Keiser and Lemire, 2021).
+Every byte is classified using three 16-entry lookup tables indexed by the high nibble of the previous byte, the low
+nibble of the previous byte, and the high nibble of the current byte. The bitwise and of the three results is nonzero
+iff the two bytes form an invalid sequence. Lead bytes of 3 and 4 byte sequences are checked separately.
+*/
+#define UTF8_TOO_SHORT      (1 << 0)
+#define UTF8_TOO_LONG       (1 << 1)
+#define UTF8_OVERLONG_3     (1 << 2)
+#define UTF8_TOO_LARGE      (1 << 3)
+#define UTF8_SURROGATE      (1 << 4)
+#define UTF8_OVERLONG_2     (1 << 5)
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4     (1 << 6)
+#define UTF8_TWO_CONTS      (1 << 7)
+#define UTF8_CARRY          (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+#if defined(LEAN_UTF8_X86) || defined(LEAN_UTF8_NEON)
+alignas(16) static uint8_t const g_utf8_byte_1_high[16] = {
+    /* 0_______ ASCII */
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    /* 10______ continuation */
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    /* 1100____ two byte lead */
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    /* 1101____ two byte lead */
+    UTF8_TOO_SHORT,
+    /* 1110____ three byte lead */
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    /* 1111____ four byte lead */
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+};
+
+alignas(16) static uint8_t const g_utf8_byte_1_low[16] = {
+    /* ____0000 */
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    /* ____0001 */
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    /* ____001_ */
+    UTF8_CARRY,
+    UTF8_CARRY,
+    /* ____0100 */
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    /* ____0101 .. ____1100 */
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    /* ____1101 */
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+    /* ____111_ */
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+};
+
+alignas(16) static uint8_t const g_utf8_byte_2_high[16] = {
+    /* 0_______ ASCII */
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    /* 1000____ */
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    /* 1001____ */
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+    /* 101_____ */
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    /* 11______ */
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+};
+#endif
+
+#if defined(LEAN_UTF8_X86)
+#define LEAN_UTF8_TARGET(t) __attribute__((target(t)))
+
+/* Return a nonzero vector if the bytes of `input` (preceded by `prev_input`) are not valid UTF-8. */
+LEAN_UTF8_TARGET("ssse3") static inline __m128i utf8_errors_ssse3(__m128i input, __m128i prev_input) {
+    __m128i const nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+    __m128i byte_1_high = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<__m128i const *>(g_utf8_byte_1_high)),
+                                           _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    __m128i byte_1_low  = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<__m128i const *>(g_utf8_byte_1_low)),
+                                           _mm_and_si128(prev1, nibble));
+    __m128i byte_2_high = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<__m128i const *>(g_utf8_byte_2_high)),
+                                           _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+    /* bytes following a 3 or 4 byte lead by 2 or 3 positions must be continuation bytes */
+    __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+    __m128i must_be_cont = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xe0 - 0x80))),
+                                        _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xf0 - 0x80))));
+    return _mm_xor_si128(_mm_and_si128(must_be_cont, _mm_set1_epi8(static_cast<char>(0x80))), special);
+}
+
+LEAN_UTF8_TARGET("ssse3") static inline void validate_utf8_block_ssse3(__m128i input, __m128i & prev, __m128i & error, size_t & conts) {
+    /* nothing to check if both blocks are ASCII */
+    if (_mm_movemask_epi8(_mm_or_si128(input, prev)) != 0) {
+        error = _mm_or_si128(error, utf8_errors_ssse3(input, prev));
+        conts += __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-64), input)));
+    }
+    prev = input;
+}
+
+LEAN_UTF8_TARGET("ssse3") static bool validate_utf8_ssse3(uint8_t const * str, size_t size, size_t & len) {
+    __m128i prev  = _mm_setzero_si128();
+    __m128i error = _mm_setzero_si128();
+    size_t conts  = 0;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+        validate_utf8_block_ssse3(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + i)), prev, error, conts);
+    alignas(16) uint8_t tail[16] = {0};
+    memcpy(tail, str + i, size - i);
+    validate_utf8_block_ssse3(_mm_load_si128(reinterpret_cast<__m128i const *>(tail)), prev, error, conts);
+    /* a final block of zeros reports sequences truncated by the end of the input */
+    validate_utf8_block_ssse3(_mm_setzero_si128(), prev, error, conts);
+    len = size - conts;
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+/* `_mm256_alignr_epi8` works on 128-bit lanes, so we first combine the upper half of `prev_input` with the lower half of `input`. */
+#define UTF8_AVX2_PREV(input, prev_input, n) \
+    _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev_input, input, 0x21), 16 - (n))
+
+LEAN_UTF8_TARGET("avx2") static inline __m256i utf8_errors_avx2(__m256i input, __m256i prev_input) {
+    __m256i const nibble = _mm256_set1_epi8(0x0F);
+    __m256i prev1 = UTF8_AVX2_PREV(input, prev_input, 1);
+    __m256i byte_1_high = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const *>(g_utf8_byte_1_high))),
+                                              _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i byte_1_low  = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const *>(g_utf8_byte_1_low))),
+                                              _mm256_and_si256(prev1, nibble));
+    __m256i byte_2_high = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const *>(g_utf8_byte_2_high))),
+                                              _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+    __m256i prev2 = UTF8_AVX2_PREV(input, prev_input, 2);
+    __m256i prev3 = UTF8_AVX2_PREV(input, prev_input, 3);
+    __m256i must_be_cont = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xe0 - 0x80))),
+                                           _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xf0 - 0x80))));
+    return _mm256_xor_si256(_mm256_and_si256(must_be_cont, _mm256_set1_epi8(static_cast<char>(0x80))), special);
+}
+
+LEAN_UTF8_TARGET("avx2") static inline void validate_utf8_block_avx2(__m256i input, __m256i & prev, __m256i & error, size_t & conts) {
+    if (_mm256_movemask_epi8(_mm256_or_si256(input, prev)) != 0) {
+        error = _mm256_or_si256(error, utf8_errors_avx2(input, prev));
+        conts += __builtin_popcount(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-64), input))));
+    }
+    prev = input;
+}
+
+LEAN_UTF8_TARGET("avx2") static bool validate_utf8_avx2(uint8_t const * str, size_t size, size_t & len) {
+    __m256i prev  = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    size_t conts  = 0;
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+        validate_utf8_block_avx2(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + i)), prev, error, conts);
+    alignas(32) uint8_t tail[32] = {0};
+    memcpy(tail, str + i, size - i);
+    validate_utf8_block_avx2(_mm256_load_si256(reinterpret_cast<__m256i const *>(tail)), prev, error, conts);
+    validate_utf8_block_avx2(_mm256_setzero_si256(), prev, error, conts);
+    len = size - conts;
+    return _mm256_testz_si256(error, error);
+}
+
+enum class utf8_simd_kind { none, ssse3, avx2 };
+
+static utf8_simd_kind get_utf8_simd_kind() {
+    static utf8_simd_kind kind = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return utf8_simd_kind::avx2;
+        else if (__builtin_cpu_supports("ssse3"))
+            return utf8_simd_kind::ssse3;
+        else
+            return utf8_simd_kind::none;
+    }();
+    return kind;
+}
+#elif defined(LEAN_UTF8_NEON)
+static inline uint8x16_t utf8_errors_neon(uint8x16_t input, uint8x16_t prev_input) {
+    uint8x16_t const nibble = vdupq_n_u8(0x0F);
+    uint8x16_t prev1 = vextq_u8(prev_input, input, 15);
+    uint8x16_t byte_1_high = vqtbl1q_u8(vld1q_u8(g_utf8_byte_1_high), vshrq_n_u8(prev1, 4));
+    uint8x16_t byte_1_low  = vqtbl1q_u8(vld1q_u8(g_utf8_byte_1_low), vandq_u8(prev1, nibble));
+    uint8x16_t byte_2_high = vqtbl1q_u8(vld1q_u8(g_utf8_byte_2_high), vshrq_n_u8(input, 4));
+    uint8x16_t special = vandq_u8(vandq_u8(byte_1_high, byte_1_low), byte_2_high);
+    uint8x16_t prev2 = vextq_u8(prev_input, input, 14);
+    uint8x16_t prev3 = vextq_u8(prev_input, input, 13);
+    uint8x16_t must_be_cont = vorrq_u8(vqsubq_u8(prev2, vdupq_n_u8(0xe0 - 0x80)), vqsubq_u8(prev3, vdupq_n_u8(0xf0 - 0x80)));
+    return veorq_u8(vandq_u8(must_be_cont, vdupq_n_u8(0x80)), special);
+}
+
+static inline void validate_utf8_block_neon(uint8x16_t input, uint8x16_t & prev, uint8x16_t & error, size_t & conts) {
+    if (vmaxvq_u8(vorrq_u8(input, prev)) >= 0x80) {
+        error = vorrq_u8(error, utf8_errors_neon(input, prev));
+        conts += vaddvq_u8(vandq_u8(vcltq_s8(vreinterpretq_s8_u8(input), vdupq_n_s8(-64)), vdupq_n_u8(1)));
+    }
+    prev = input;
+}
+
+static bool validate_utf8_neon(uint8_t const * str, size_t size, size_t & len) {
+    uint8x16_t prev  = vdupq_n_u8(0);
+    uint8x16_t error = vdupq_n_u8(0);
+    size_t conts = 0;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+        validate_utf8_block_neon(vld1q_u8(str + i), prev, error, conts);
+    uint8_t tail[16] = {0};
+    memcpy(tail, str + i, size - i);
+    validate_utf8_block_neon(vld1q_u8(tail), prev, error, conts);
+    validate_utf8_block_neon(vdupq_n_u8(0), prev, error, conts);
+    len = size - conts;
+    return vmaxvq_u8(error) == 0;
+}
+#endif
+
+/* Return true if `str[0, size)` is valid UTF-8 and store its length in `len`.
+   Return false if it is not, or if there is no vectorized implementation for the current CPU. */
+static bool try_validate_utf8_simd(uint8_t const * str, size_t size, size_t & len) {
+#if defined(LEAN_UTF8_X86)
+    switch (get_utf8_simd_kind()) {
+    case utf8_simd_kind::avx2:  return validate_utf8_avx2(str, size, len);
+    case utf8_simd_kind::ssse3: return validate_utf8_ssse3(str, size, len);
+    case utf8_simd_kind::none:  return false;
+    }
+    return false;
+#elif defined(LEAN_UTF8_NEON)
+    return validate_utf8_neon(str, size, len);
+#else
+    (void)str; (void)size; (void)len;
+    return false;
+#endif
+}
+
+/* Chunks are validated independently, so that an invalid byte late in the input does not waste much work. */
+#define LEAN_UTF8_SIMD_CHUNK 4096
+
 bool validate_utf8(uint8_t const * str, size_t size, size_t & pos, size_t & i) {
+    while (size - pos > LEAN_UTF8_SIMD_CHUNK) {
+        /* end the chunk at a character boundary */
+        size_t end = pos + LEAN_UTF8_SIMD_CHUNK;
+        for (unsigned k = 0; k < 3 && is_utf8_next(str[end]); k++) end--;
+        size_t len;
+        if (!try_validate_utf8_simd(str + pos, end - pos, len)) break;
+        pos  = end;
+        i   += len;
+    }
+    /* on failure, the scalar loop below finds the position of the first invalid character */
     while (pos < size) {
+        uint64_t w;
+        if (size - pos >= 8 && (memcpy(&w, str + pos, 8), (w & 0x8080808080808080ull) == 0)) {
+            /* ASCII fast path */
+            pos += 8;
+            i   += 8;
+            continue;
+        }
         if (!validate_utf8_one(str, size, pos)) return false;
         i++;
     }
@@ -8,6 +8,7 @@ Author: Leonardo de Moura
 #include <fstream>
 #include <signal.h>
 #include <cctype>
+#include <algorithm>
 #include <cstdlib>
 #include <string>
 #include <utility>
@@ -199,6 +200,8 @@ static void display_help(std::ostream & out) {
     std::cout << "  -o, --o=oname          create olean file\n";
     std::cout << "  -i, --i=iname          create ilean file\n";
     std::cout << "  -c, --c=fname          name of the C output file\n";
+    std::cout << "  --c-parts=num          split the C output into (at most) num files fname, fname.1.c, ...\n";
+    std::cout << "                         that can be compiled in parallel\n";
     std::cout << "  -b, --bc=fname         name of the LLVM bitcode file\n";
     std::cout << "      --stdin            take input from stdin\n";
     std::cout << "      --root=dir         set package root directory from which the module name\n"
@@ -253,6 +256,7 @@ static struct option g_long_options[] = {
     {"deps-json",    no_argument,       0, 'J'},
     {"timeout",      optional_argument, 0, 'T'},
     {"c",            optional_argument, 0, 'c'},
+    {"c-parts",      required_argument, 0, 'N'},
     {"bc",           optional_argument, 0, 'b'},
     {"features",     optional_argument, 0, 'f'},
     {"exitOnPanic",  no_argument,       0, 'e'},
@@ -496,6 +500,7 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
     optional<std::string> server_in;
     std::string native_output;
     optional<std::string> c_output;
+    unsigned c_parts = 1;
     optional<std::string> llvm_output;
     optional<std::string> root_dir;
     buffer<string_ref> forwarded_args;
@@ -530,6 +535,9 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
                 check_optarg("c");
                 c_output = optarg;
                 break;
+            case 'N':
+                c_parts = std::max(1, atoi(optarg));
+                break;
             case 'b':
                 check_optarg("bc");
                 llvm_output = optarg;
@@ -751,7 +759,25 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
                 return 1;
             }
             time_task _("C code generation", opts);
-            out << lean::ir::emit_c(env, *main_module_name).data();
+            if (c_parts > 1) {
+                std::vector<string_ref> parts = lean::ir::emit_c_parts(env, *main_module_name, c_parts);
+                out << parts[0].data();
+                // `out.c` => `out.1.c`, `out.2.c`, ...
+                std::string base = *c_output;
+                if (base.size() > 2 && base.compare(base.size() - 2, 2, ".c") == 0)
+                    base.resize(base.size() - 2);
+                for (size_t i = 1; i < parts.size(); i++) {
+                    std::string part_fn = base + "." + std::to_string(i) + ".c";
+                    std::ofstream part_out(part_fn, std::ios_base::binary);
+                    if (part_out.fail()) {
+                        std::cerr << "failed to create '" << part_fn << "'\n";
+                        return 1;
+                    }
+                    part_out << parts[i].data();
+                }
+            } else {
+                out << lean::ir::emit_c(env, *main_module_name).data();
+            }
             out.close();
         }
 
@@ -0,0 +1,30 @@
+/-!
+  Growing large exclusive arrays, byte arrays and strings one element at a time.
+  Each growth step past the small object size reallocates the buffer. -/
+
+def bench (name : String) (act : IO Nat) : IO Unit := do
+  let start ← IO.monoNanosNow
+  let n ← act
+  let stop ← IO.monoNanosNow
+  IO.println s!"{name}: {n} elements, {(stop - start) / 1000000} ms"
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  bench "Array.push" do
+    let mut a : Array Nat := #[]
+    for i in [0:n] do a := a.push i
+    return a.size
+  bench "ByteArray.push" do
+    let mut a := ByteArray.empty
+    for i in [0:n] do a := a.push i.toUInt8
+    return a.size
+  bench "FloatArray.push" do
+    let mut a := FloatArray.empty
+    for i in [0:n] do a := a.push i.toFloat
+    return a.size
+  bench "String.push" do
+    let mut s := ""
+    for _ in [0:n] do s := s.push 'x'
+    return s.length
+| _ => throw $ IO.userError "give element count"
@@ -0,0 +1,30 @@
+/-!
+  Arithmetic on 64 to 256 bit numbers where one operand is a scalar, as in modular exponentiation and
+  digit-by-digit conversions. Every operation allocates its result. -/
+
+def bench (name : String) (act : IO Nat) : IO Unit := do
+  let start ← IO.monoNanosNow
+  let r ← act
+  let stop ← IO.monoNanosNow
+  IO.println s!"{name}: {r % 1000000007}, {(stop - start) / 1000000} ms"
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  let m := 2^127 - 1
+  bench "Nat mul/mod" do
+    let mut x := 2^64 + 13
+    for i in [0:n] do
+      x := (x * (i + 3)) % m + 2^64
+    return x
+  bench "Nat add/sub/div" do
+    let mut x := 2^100
+    for i in [0:n] do
+      x := (x + i) - (i / 2) + x / (i + 1) % 7
+    return x
+  bench "Int mul/div" do
+    let mut x : Int := -(2^80)
+    for i in [0:n] do
+      x := Int.tdiv (x * (i % 1000 + 1 : Nat)) (i % 1000 + 1 : Nat) - 1
+    return x.natAbs
+| _ => throw $ IO.userError "give iteration count"
@@ -0,0 +1,40 @@
+/-!
+  Sieve of Eratosthenes and bulk set operations on `BitArray`, compared with the same sieve on
+  `Array Bool`. -/
+
+def bench (name : String) (act : IO Nat) : IO Unit := do
+  let start ← IO.monoNanosNow
+  let r ← act
+  let stop ← IO.monoNanosNow
+  IO.println s!"{name}: {r}, {(stop - start) / 1000000} ms"
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  bench "sieve (Array Bool)" do
+    let mut s := mkArray n true
+    for i in [2:n] do
+      if i * i ≥ n then break
+      if s[i]! then
+        for j in [i * i:n:i] do s := s.set! j false
+    return (s.filter id).size - 2
+  bench "sieve (BitArray)" do
+    let mut s := BitArray.replicate n true
+    for i in [2:n] do
+      if i * i ≥ n then break
+      if s[i]! then
+        for j in [i * i:n:i] do s := s.set! j false
+    return s.popcount - 2
+  bench "and/or/xor/shift" do
+    let a := BitArray.replicate n true
+    let mut b := BitArray.replicate n false
+    for i in [0:64] do
+      b := (b <<< 1 ||| a >>> (n - i)) ^^^ (a &&& b >>> 3)
+    return b.popcount
+  bench "findFirstSet?" do
+    let s := (BitArray.replicate n false).set! (n - 1) true
+    let mut c := 0
+    for i in [0:100] do
+      if let some j := s.findFirstSet? i then c := c + j
+    return c
+| _ => throw $ IO.userError "give array size"
@@ -0,0 +1,25 @@
+/-!
+  Hashing throughput of `String.hash`, `String.hashWithSeed` and `ByteArray.hashWithSeed` for short and long keys. -/
+
+def bench (name : String) (n : Nat) (f : Nat → UInt64) : IO Unit := do
+  let start ← IO.monoNanosNow
+  let mut acc : UInt64 := 0
+  for i in [0:n] do
+    acc := acc ^^^ f i
+  let stop ← IO.monoNanosNow
+  IO.println s!"{name}: {(stop - start) / 1000000} ms ({acc != 0})"
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  let seed ← IO.hashSeed
+  let short := (List.range 64).toArray.map fun i => s!"Lean.Elab.Term.elabApp{i}"
+  let long := String.mk (List.replicate 4096 'x')
+  let bytes := long.toUTF8
+  bench "String.hash (short)" n fun i => short[i % 64]!.hash
+  bench "String.hashWithSeed (short)" n fun i => short[i % 64]!.hashWithSeed seed
+  bench "String.hash (4 KiB)" (n / 64) fun _ => long.hash
+  bench "String.hashWithSeed (4 KiB)" (n / 64) fun _ => long.hashWithSeed seed
+  bench "ByteArray.hash (4 KiB)" (n / 64) fun _ => bytes.hash
+  bench "ByteArray.hashWithSeed (4 KiB)" (n / 64) fun _ => bytes.hashWithSeed seed
+| _ => throw $ IO.userError "give iteration count"
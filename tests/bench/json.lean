@@ -0,0 +1,45 @@
+import Lean.Data.Json
+
+/-!
+  Parsing and printing large JSON-RPC payloads, such as semantic token and info tree responses, as JSON
+  text and in the binary encoding used between the language server and its file workers. -/
+
+open Lean
+
+def bench (name : String) (act : IO Nat) : IO Unit := do
+  let start ← IO.monoNanosNow
+  let r ← act
+  let stop ← IO.monoNanosNow
+  IO.println s!"{name}: {r}, {(stop - start) / 1000000} ms"
+
+def mkPayload (n : Nat) : Json := Id.run do
+  let mut tokens : Array Json := #[]
+  let mut goals : Array Json := #[]
+  for i in [0:n] do
+    tokens := tokens.push (i % 97 : Nat) |>.push (i % 13 : Nat) |>.push (i % 5 : Nat)
+    if i % 10 == 0 then
+      goals := goals.push <| Json.mkObj [
+        ("range", Json.mkObj [("start", Json.mkObj [("line", (i : Nat)), ("character", (i % 80 : Nat))])]),
+        ("goal", s!"case h.{i}\nα : Type u_{i % 3}\nxs : List α\n⊢ xs.length + {i} = (xs ++ [\"{i}\"]).length"),
+        ("score", .num ⟨i * 1000 + 17, 3⟩)
+      ]
+  return Json.mkObj [("jsonrpc", "2.0"), ("id", (1 : Nat)),
+    ("result", Json.mkObj [("data", Json.arr tokens), ("goals", Json.arr goals)])]
+
+def main : List String → IO Unit
+| [n] => do
+  let j := mkPayload n.toNat!
+  let s := j.compress
+  bench "compress" do
+    return (List.range 5).foldl (fun acc _ => acc + j.compress.utf8ByteSize) 0
+  bench "parse" do
+    return (List.range 5).foldl (fun acc _ => acc + if (Json.parse s).isOk then 1 else 0) 0
+  bench "parse (Parsec)" do
+    return if (Std.Internal.Parsec.String.Parser.run Json.Parser.any s).isOk then 1 else 0
+  let b := j.toBinary
+  bench "toBinary" do
+    return (List.range 5).foldl (fun acc _ => acc + j.toBinary.size) 0
+  bench "ofBinary" do
+    return (List.range 5).foldl (fun acc _ => acc + if (Json.ofBinary b).isOk then 1 else 0) 0
+  IO.println s!"text: {s.utf8ByteSize} bytes, binary: {b.size} bytes"
+| _ => return
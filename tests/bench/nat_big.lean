@@ -0,0 +1,29 @@
+/-!
+  Arithmetic on numbers with tens of thousands of digits: products of large factors, long division and
+  decimal conversion. -/
+
+def bench (name : String) (act : IO Nat) : IO Unit := do
+  let start ← IO.monoNanosNow
+  let r ← act
+  let stop ← IO.monoNanosNow
+  IO.println s!"{name}: {r % 1000000007}, {(stop - start) / 1000000} ms"
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  let a := 3^(40 * n) + 17
+  let b := 7^(20 * n) + 5
+  bench "mul" do
+    let mut x := 0
+    for i in [0:10] do
+      x := x + (a + i) * (b + i)
+    return x
+  bench "div/mod" do
+    let c := a * a + b
+    let mut x := 0
+    for i in [0:10] do
+      x := x + c / (a + i) + c % (b + i)
+    return x
+  bench "repr" do
+    return (a * b).repr.length
+| _ => throw $ IO.userError "give exponent scale"
@@ -0,0 +1,27 @@
+/-!
+  Reading a large text file line by line. -/
+
+def bench (name : String) (act : IO Nat) : IO Unit := do
+  let start ← IO.monoNanosNow
+  let r ← act
+  let stop ← IO.monoNanosNow
+  IO.println s!"{name}: {r}, {(stop - start) / 1000000} ms"
+
+partial def countGetLine (h : IO.FS.Handle) (acc : Nat) : IO Nat := do
+  let line ← h.getLine
+  if line.isEmpty then return acc else countGetLine h (acc + line.length)
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  let (h, path) ← IO.FS.createTempFile
+  for i in [0:n] do
+    h.putStr s!"{i}: the quick brown fox jumps over the lazy dog{if i % 7 == 0 then " – λ" else ""}\n"
+  h.flush
+  bench "getLine" do
+    let h ← IO.FS.Handle.mk path .read
+    countGetLine h 0
+  bench "lines" do
+    return (← IO.FS.lines path).foldl (· + ·.length) 0
+  IO.FS.removeFile path
+| _ => return
@@ -0,0 +1,44 @@
+/-!
+  Bulk `FloatArray` arithmetic and `ByteArray` search, compared with the equivalent element-wise loops. -/
+
+def bench (name : String) (act : IO Float) : IO Unit := do
+  let start ← IO.monoNanosNow
+  let r ← act
+  let stop ← IO.monoNanosNow
+  IO.println s!"{name}: {r}, {(stop - start) / 1000000} ms"
+
+def main : List String → IO Unit
+| [n, reps] => do
+  let n := n.toNat!
+  let reps := reps.toNat!
+  let mut a := FloatArray.mkEmpty n
+  let mut b := FloatArray.mkEmpty n
+  for i in [0:n] do
+    a := a.push (i % 17).toFloat
+    b := b.push (i % 5).toFloat
+  bench "dot (loop)" do
+    let mut s := 0
+    for _ in [0:reps] do
+      for i in [0:n] do s := s + a[i]! * b[i]!
+    return s
+  bench "dot" do
+    let mut s := 0
+    for _ in [0:reps] do s := s + a.dot b
+    return s
+  bench "fma" do
+    let mut c := FloatArray.mkEmpty n
+    for _ in [0:n] do c := c.push 0
+    for _ in [0:reps] do c := c.fma a b
+    return c.max
+  let bytes := ByteArray.mk (mkArray n 1)
+  bench "indexOf? (loop)" do
+    let mut k := 0
+    for _ in [0:reps] do
+      k := k + ((bytes.findIdx? (· == 0)).getD n)
+    return k.toFloat
+  bench "indexOf?" do
+    let mut k := 0
+    for _ in [0:reps] do
+      k := k + ((bytes.indexOf? 0).getD n)
+    return k.toFloat
+| _ => throw $ IO.userError "give array size and repetition count"
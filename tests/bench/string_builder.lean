@@ -0,0 +1,32 @@
+/-!
+  Rendering a large `Format` and building a long string from small fragments. -/
+
+def bench (name : String) (act : IO Nat) : IO Unit := do
+  let start ← IO.monoNanosNow
+  let r ← act
+  let stop ← IO.monoNanosNow
+  IO.println s!"{name}: {r}, {(stop - start) / 1000000} ms"
+
+def tree : Nat → Std.Format
+  | 0 => "leaf"
+  | n+1 => Std.Format.paren (tree n ++ Std.Format.line ++ toString n ++ Std.Format.line ++ tree n)
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  bench "Format.pretty" do
+    return (tree 16).pretty 100 |>.length
+  bench "String append" do
+    let mut s := ""
+    for i in [0:n] do
+      s := s ++ toString i ++ " "
+      if i % 10 == 0 then s := (s.push '\n').pushn ' ' (i % 16)
+    return s.length
+  bench "StringBuilder" do
+    let mut b := StringBuilder.mkEmpty 0
+    let src := "the quick brown fox jumps over the lazy dog"
+    for i in [0:n] do
+      b := (b.appendExtract src ⟨i % 20⟩ ⟨i % 20 + 4⟩).push ' '
+      if i % 10 == 0 then b := (b.push '\n').pushn ' ' (i % 16)
+    return b.length
+| _ => throw $ IO.userError "give fragment count"
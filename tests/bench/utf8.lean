@@ -0,0 +1,14 @@
+/-!
+  Throughput of UTF-8 validation and length computation on real source files. -/
+
+def main : List String → IO Unit
+| n :: fnames => do
+  let mut bytes := ByteArray.empty
+  for fname in fnames do
+    bytes := bytes ++ (← IO.FS.readBinFile fname)
+  let mut len := 0
+  for _ in [0:n.toNat!] do
+    let some s := String.fromUTF8? bytes | throw $ IO.userError "invalid UTF-8"
+    len := len + s.length
+  IO.println s!"{bytes.size} bytes, {len} characters"
+| _ => throw $ IO.userError "give iteration count and files"
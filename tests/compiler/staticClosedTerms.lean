@@ -0,0 +1,21 @@
+-- Closed terms built only from literals and constructors are emitted as static data by `EmitC`.
+-- Make sure they behave like heap-allocated persistent objects.
+
+def greeting : String := "hello world"
+
+def names : List String := ["alpha", "beta", "gamma", "ünïcödé"]
+
+def pairs : List (Option (String × Nat)) := [some ("one", 1), none, some ("two", 2)]
+
+@[noinline] def extend (s : String) : String :=
+  s.push '!' ++ s
+
+def main : IO Unit := do
+  IO.println greeting
+  IO.println (extend greeting)
+  IO.println greeting.length
+  IO.println names
+  IO.println (names.map String.length)
+  IO.println ("zeta" :: names).length
+  IO.println pairs
+  IO.println (pairs.filterMap id |>.map (·.2) |>.foldl (· + ·) 0)
@@ -0,0 +1,53 @@
+/-! Arithmetic mixing scalar and bignum `Nat`s and `Int`s, around the limits of scalars and limbs. -/
+
+def natSamples : List Nat :=
+  let bases := [2^31, 2^32, 2^63, 2^64, 2^127, 2^128, 2^200, 3^100]
+  bases.bind fun b => [b - 1, b, b + 1]
+
+def smallNats : List Nat := [0, 1, 2, 3, 10, 2^31 - 1, 2^32 + 7, 2^62 + 12345, 2^63 - 1]
+
+def checkNat (a b : Nat) : IO Unit := do
+  unless a + b - b == a && b + a - a == b do throw <| IO.userError s!"add/sub {a} {b}"
+  unless (a + 1) - 1 == a do throw <| IO.userError s!"succ {a}"
+  unless a * b == b * a do throw <| IO.userError s!"mul comm {a} {b}"
+  if b != 0 then
+    unless (a * b) / b == a && (a * b) % b == 0 do throw <| IO.userError s!"mul/div {a} {b}"
+    unless (a / b) * b + a % b == a && a % b < b do throw <| IO.userError s!"divmod {a} {b}"
+  unless (a + b) * (a + b) == a * a + 2 * a * b + b * b do throw <| IO.userError s!"square {a} {b}"
+
+def checkInt (a b : Int) : IO Unit := do
+  unless a + b - b == a && b - (b - a) == a && a - b == -(b - a) do throw <| IO.userError s!"add/sub {a} {b}"
+  unless a * b == b * a && a * b == -((-a) * b) do throw <| IO.userError s!"mul {a} {b}"
+  if b != 0 then
+    unless Int.tdiv (a * b) b == a do throw <| IO.userError s!"mul/div {a} {b}"
+    unless Int.tdiv a b * b + Int.tmod a b == a && (Int.tmod a b).natAbs < b.natAbs do
+      throw <| IO.userError s!"div/mod {a} {b}"
+    unless Int.tdiv (-a) b == -(Int.tdiv a b) && Int.tmod (-a) b == -(Int.tmod a b) do
+      throw <| IO.userError s!"div/mod sign {a} {b}"
+
+#eval show IO Unit from do
+  for a in natSamples do
+    for b in smallNats do
+      checkNat a b
+      checkNat b a
+    for b in natSamples do
+      checkNat a b
+
+#eval show IO Unit from do
+  let smallInts : List Int := [0, 1, -1, 7, -7, 2147483647, -2147483648, 2147483646]
+  for a in natSamples do
+    for s in [1, -1] do
+      let a : Int := s * a
+      for b in smallInts do
+        checkInt a b
+        checkInt b a
+
+-- results that become small again
+#eval show IO Unit from do
+  let big := 2^64 + 5
+  unless big - (2^64) == 5 do throw <| IO.userError "nat sub"
+  unless big / (2^33) == 2^31 do throw <| IO.userError "nat div"
+  unless ((2^31 : Int) - 1) == 2147483647 do throw <| IO.userError "int sub"
+  unless ((2^31 : Int) + (-2147483648)) == 0 do throw <| IO.userError "int add"
+  unless (-(2^31 : Int)) * 1 == -2147483648 do throw <| IO.userError "int mul"
+  unless Int.tdiv (2^40 : Int) (-(2^20)) == -(2^20) do throw <| IO.userError "int div"
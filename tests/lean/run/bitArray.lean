@@ -0,0 +1,53 @@
+/-! `BitArray` operations compared with the same operations on `Array Bool`, around word boundaries. -/
+
+def pattern (n k : Nat) : Array Bool := Id.run do
+  let mut r := #[]
+  for i in [:n] do
+    r := r.push ((i * k + i / 3) % 5 < 2)
+  return r
+
+def bits (bs : Array Bool) : BitArray :=
+  bs.foldl BitArray.push BitArray.empty
+
+def check (msg : String) (a : BitArray) (bs : Array Bool) : IO Unit :=
+  unless a.size == bs.size && a.toList == bs.toList do throw <| IO.userError msg
+
+#eval show IO Unit from do
+  for n in [0, 1, 63, 64, 65, 127, 128, 129, 200] do
+    let xs := pattern n 7
+    let ys := pattern (n / 2 + 1) 3
+    let a := bits xs
+    let b := bits ys
+    check s!"push {n}" a xs
+    check s!"mk {n}" (BitArray.mk xs) xs
+    unless (BitArray.mk xs).data == xs do throw <| IO.userError s!"data {n}"
+    unless a.popcount == (xs.filter id).size do throw <| IO.userError s!"popcount {n}"
+    let get (zs : Array Bool) (i : Nat) := zs.getD i false
+    check s!"and {n}" (a &&& b) (xs.mapIdx fun i x => x && get ys i)
+    check s!"or {n}" (a ||| b) (xs.mapIdx fun i x => x || get ys i)
+    check s!"xor {n}" (a ^^^ b) (xs.mapIdx fun i x => x != get ys i)
+    check s!"not {n}" (~~~a) (xs.map (!·))
+    unless (~~~(BitArray.replicate n true)).popcount == 0 do throw <| IO.userError s!"not replicate {n}"
+    -- a shorter `a` ignores the extra bits of `b`
+    check s!"or short {n}" (b ||| a) (ys.mapIdx fun i y => y || get xs i)
+    for k in [0, 1, 5, 63, 64, 65, 130, 1000] do
+      check s!"shl {n} {k}" (a <<< k) (xs.mapIdx fun i _ => if k ≤ i.val then xs[i.val - k]! else false)
+      check s!"shr {n} {k}" (a >>> k) (xs.mapIdx fun i _ => get xs (i.val + k))
+    for start in [0, 1, 62, 63, 64, 65, 128, 300] do
+      let expected := (List.range n).find? fun i => start ≤ i && xs[i]!
+      unless a.findFirstSet? start == expected do throw <| IO.userError s!"findFirstSet? {n} {start}"
+    unless a.toIndices.size == a.popcount do throw <| IO.userError s!"toIndices {n}"
+
+#eval show IO Unit from do
+  let a := BitArray.replicate 100 false
+  -- shared arrays are not modified
+  let b := a.set! 70 true
+  unless a.popcount == 0 && b.popcount == 1 && b.findFirstSet? == some 70 do throw <| IO.userError "set shared"
+  let c := b ||| (a.set! 3 true)
+  unless c.toIndices == #[3, 70] && b.toIndices == #[70] do throw <| IO.userError "or shared"
+  unless (c <<< 30).toIndices == #[33] && (c >>> 3).toIndices == #[0, 67] do throw <| IO.userError "shift"
+  unless c == bits c.data && c != b && BitArray.empty == bits #[] do throw <| IO.userError "beq"
+  unless (BitArray.replicate 65 true).popcount == 65 do throw <| IO.userError "replicate"
+  unless a.set! 100 true == a && !(a.get! 100) do throw <| IO.userError "out of bounds"
+
+#guard toString ([true, false, true].toBitArray) == "[true, false, true]"
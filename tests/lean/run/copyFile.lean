@@ -0,0 +1,37 @@
+/-! `IO.FS.copyFile`, `IO.FS.hardLink`, `IO.FS.renameExchange` and `IO.FS.linkOrCopyFile` -/
+
+open System IO.FS
+
+#eval show IO Unit from do
+  let root : FilePath := "copyFile.tmp"
+  if ← root.pathExists then removeDirAll root
+  createDirAll root
+  try
+    let data := ByteArray.mk <| (Array.range 300000).map (·.toUInt8)
+    writeBinFile (root / "a") data
+    -- replaces an existing, longer file
+    writeBinFile (root / "b") (data ++ data)
+    copyFile (root / "a") (root / "b")
+    unless (← readBinFile (root / "b")) == data do throw <| IO.userError "copyFile"
+    copyFile (root / "a") (root / "c")
+    unless (← readBinFile (root / "c")) == data do throw <| IO.userError "copyFile new"
+    try
+      copyFile (root / "missing") (root / "d")
+      throw <| IO.userError "copyFile missing"
+    catch
+      | .noFileOrDirectory .. => pure ()
+      | e => throw e
+    hardLink (root / "a") (root / "l")
+    unless (← readBinFile (root / "l")) == data do throw <| IO.userError "hardLink"
+    -- `link` must not exist
+    unless (← (hardLink (root / "a") (root / "l")).toBaseIO) matches .error _ do throw <| IO.userError "hardLink exists"
+    writeFile (root / "x") "x"
+    linkOrCopyFile (root / "x") (root / "l")
+    unless (← readFile (root / "l")) == "x" do throw <| IO.userError "linkOrCopyFile"
+    unless System.Platform.isWindows do
+      writeFile (root / "y") "y"
+      renameExchange (root / "x") (root / "y")
+      unless (← readFile (root / "x")) == "y" && (← readFile (root / "y")) == "x" do
+        throw <| IO.userError "renameExchange"
+  finally
+    removeDirAll root
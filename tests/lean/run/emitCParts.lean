@@ -0,0 +1,29 @@
+import Lean
+
+open Lean Elab Command
+
+mutual
+def isEven : Nat → Bool
+  | 0 => true
+  | n+1 => isOdd n
+def isOdd : Nat → Bool
+  | 0 => false
+  | n+1 => isEven n
+end
+
+def msg : String := "hello " ++ toString (isEven 10)
+
+def h (n : Nat) : Nat := n * 2 + 1
+
+#eval show CommandElabM Unit from do
+  let env ← getEnv
+  let .ok parts := IR.emitCParts env `emitCParts 3 | throwError "failed to emit C code"
+  unless parts.size == 3 do throwError "expected 3 parts"
+  -- The module initializer and the constants live in the first part.
+  unless (parts[0]!.splitOn "initialize_emitCParts").length > 1 do throwError "missing module initializer"
+  unless parts[1:].all (fun p => (p.splitOn "initialize_emitCParts").length == 1) do
+    throwError "module initializer emitted twice"
+  -- Mutually recursive functions are defined in the same part.
+  let defines (p : String) (f : String) := (p.splitOn ("LEAN_EXPORT uint8_t " ++ f ++ "(lean_object* x_1) {")).length > 1
+  unless parts.any (fun p => defines p "l_isEven" && defines p "l_isOdd") do
+    throwError "`isEven` and `isOdd` should be defined in the same part"
@@ -0,0 +1,22 @@
+import Lean.Data.Lsp.Utf16
+
+open Lean
+
+/-! Position conversions on long lines use `FileMap.charIndex`; they must agree with a linear scan. -/
+
+def longLine : String := String.join <| (List.range 3000).map fun i =>
+  if i % 7 == 0 then "😀" else if i % 5 == 0 then "αβ" else "x"
+
+def text : FileMap := ("short line\n" ++ longLine ++ "\nend").toFileMap
+
+#eval show IO Unit from do
+  let s := text.source
+  let lineStart := text.positions[1]!
+  for col in [0:4000:37] do
+    let utf8 := String.Iterator.nextn ⟨s, lineStart⟩ col |>.pos
+    unless text.ofPosition ⟨2, col⟩ == utf8 do throw <| IO.userError s!"ofPosition {col}"
+    let utf16 := s.codepointPosToUtf16PosFrom col lineStart
+    unless text.leanPosToLspPos ⟨2, col⟩ == ⟨1, utf16⟩ do throw <| IO.userError s!"leanPosToLspPos {col}"
+    unless text.lspPosToUtf8Pos ⟨1, utf16⟩ == utf8 do throw <| IO.userError s!"lspPosToUtf8Pos {col}"
+    if utf8 < text.positions[2]! then
+      unless text.toPosition utf8 == ⟨2, col⟩ do throw <| IO.userError s!"toPosition {col}"
@@ -0,0 +1,50 @@
+/-! `IO.FS.Watcher` (Linux only) -/
+
+open System IO.FS
+
+#eval show IO Unit from do
+  unless System.Platform.isWindows || System.Platform.isOSX || System.Platform.isEmscripten do
+    let root : FilePath := "fsWatcher.tmp"
+    if ← root.pathExists then removeDirAll root
+    createDirAll (root / "a")
+    writeFile (root / "a" / "old") ""
+    let w ← Watcher.new
+    try
+      w.add root
+      let ch ← w.changes (debounceMs := 100)
+      writeFile (root / "f") "x"
+      createDirAll (root / "n" / "m")
+      writeFile (root / "n" / "m" / "g") "y"
+      removeFile (root / "a" / "old")
+      let some es ← ch.sync.recv? | throw <| IO.userError "no events"
+      -- events may be split over several batches
+      let mut es := es
+      while !(es.any (·.path == root / "a" / "old")) || !(es.any (·.path == root / "n" / "m" / "g")) do
+        let some es' ← ch.sync.recv? | throw <| IO.userError s!"missing events: {repr es}"
+        es := es ++ es'
+      for (p, k) in [(root / "f", ChangeKind.created), (root / "n" / "m" / "g", .created), (root / "a" / "old", .removed)] do
+        unless es.any (fun e => e.path == p && e.kind == k) do throw <| IO.userError s!"{p}: {repr es}"
+      w.close
+      -- the channel is closed once the watcher is
+      while (← ch.sync.recv?).isSome do pure ()
+      unless (← w.wait).isNone do throw <| IO.userError "wait after close"
+      unless (← IO.ofExcept (← IO.wait (← w.next))).isNone do throw <| IO.userError "next after close"
+    finally
+      w.close
+      removeDirAll root
+
+#eval show IO Unit from do
+  unless System.Platform.isWindows || System.Platform.isOSX || System.Platform.isEmscripten do
+    let root : FilePath := "fsWatcherNext.tmp"
+    if ← root.pathExists then removeDirAll root
+    createDirAll root
+    let w ← Watcher.new
+    try
+      w.add root
+      let t ← w.next
+      writeFile (root / "f") "x"
+      let some es ← IO.ofExcept (← IO.wait t) | throw <| IO.userError "no events"
+      unless es.any (fun e => e.path == root / "f" && e.kind == .created) do throw <| IO.userError s!"{repr es}"
+    finally
+      w.close
+      removeDirAll root
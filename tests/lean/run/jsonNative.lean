@@ -0,0 +1,77 @@
+import Lean.Data.Json
+import Lean.Data.Lsp.Communication
+
+/-! The native `Json.parse`, `Json.compress` and `Json.toBinary`/`Json.ofBinary`, and binary LSP framing. -/
+
+open Lean
+
+def inputs : List String := [
+  "null", " true ", "false", "0", "-0", "123.456e-7", "123.456e+7", "-0.01e8", "1E2", "1.5e2",
+  "123456789012345678901234567890", "-123456789012345678901234567890.5e-3", "1e-30", "0.00000000000000000001",
+  "\"\"", "\"abc\"", "\"\\u7406\\u79D1\"", "\"\\b\\f\\n\\r\\t\\/\\\\\\\"\"", "\"\\ud83d\"", "\"héllo ∀ 😀\"",
+  "[true, 123, \"foo\", []]", "[[[[[]]]]]", "{}", "{ }", "{\"a\":1,\"a\":2,\"b\":[{\"a\":null}],\"a\":4}",
+  "{\"a\": 1.2, \"b\": \"foo\", \"c\": null, \"d\": {\"foo\": \"bar\"}, \"e\": [{}]}",
+  -- errors
+  "", "   ", "[", "]", "{", "\"", "1.", "01", "-", "-a", "1e", "1e+x", "1.x", "nul", "truex", "[1 2]", "[1,]",
+  "{foo: 1}", "{\"a\" 1}", "{\"a\":1 \"b\"}", "\"\\x\"", "\"\\u12g4\"", "\"a\x01\"", "[\"é\" é]", "[1]é"
+]
+
+def sameResult : Except String Json → Except String Json → Bool
+  | .ok a, .ok b => a == b
+  | .error a, .error b => a == b
+  | _, _ => false
+
+-- the native parser agrees with `Json.Parser.any`, including the error messages
+#eval show IO Unit from do
+  for s in inputs do
+    let expected := Std.Internal.Parsec.String.Parser.run Json.Parser.any s
+    unless sameResult (Json.parse s) expected do
+      throw <| IO.userError s!"parse {repr s}"
+
+-- printing and binary encoding round-trip
+#eval show IO Unit from do
+  for s in inputs do
+    let .ok j := Json.parse s | continue
+    unless sameResult (Json.parse j.compress) (.ok j) do
+      throw <| IO.userError s!"compress {repr s}"
+    unless sameResult (Json.ofBinary j.toBinary) (.ok j) do
+      throw <| IO.userError s!"binary {repr s}"
+
+/--
+info: "{\"e\":[{}],\"d\":{\"foo\":\"bar\"},\"c\":null,\"b\":\"foo\",\"a\":1.2}"
+-/
+#guard_msgs in
+#eval (Json.parse "{\"a\": 1.2, \"b\": \"foo\", \"c\": null, \"d\": {\"foo\": \"bar\"}, \"e\": [{}]}").toOption.get!.compress
+
+/-- info: "\"a\\\"b\\\\c\\nd\\re\\u0001\\u001f\"" -/
+#guard_msgs in
+#eval Json.renderString "a\"b\\c\nd\re\x01\x1f"
+
+#guard Json.escape "plain text ∀" "<" == "<plain text ∀"
+
+-- nesting is not limited by the stack
+#eval show IO Unit from do
+  let n := 100000
+  let s := String.mk (List.replicate n '[') ++ String.mk (List.replicate n ']')
+  let .ok j := Json.parse s | throw <| IO.userError "deep parse"
+  unless j.compress == s do throw <| IO.userError "deep compress"
+  unless (Json.ofBinary j.toBinary).toOption.map (·.compress) == some s do throw <| IO.userError "deep binary"
+
+#guard (Json.ofBinary (ByteArray.mk #[6, 2, 0])).toOption.isNone
+#guard (Json.ofBinary (ByteArray.mk #[0, 0])).toOption.isNone
+#guard (Json.ofBinary (ByteArray.mk #[42])).toOption.isNone
+
+-- binary and text messages can be mixed on one stream
+#eval show IO Unit from do
+  let r ← IO.mkRef ({} : IO.FS.Stream.Buffer)
+  let h := IO.FS.Stream.ofBuffer r
+  let params := Json.mkObj [("text", "λ ∀\n\""), ("n", .num ⟨-125, 1⟩)]
+  h.writeLspNotification ⟨"test/a", params⟩ (binary := true)
+  h.writeLspNotification ⟨"test/b", params⟩
+  h.writeLspRequest ⟨1, "test/c", params⟩ (binary := true)
+  r.modify ({ · with pos := 0 })
+  for method in ["test/a", "test/b"] do
+    let n ← h.readLspNotificationAs method Json
+    unless n.param == params do throw <| IO.userError s!"notification {method}"
+  let req ← h.readLspRequestAs "test/c" Json
+  unless req.param == params do throw <| IO.userError "request"
@@ -0,0 +1,40 @@
+/-! `IO.FS.mmapFile` returns the same contents as `readBinFile`, and updates never reach the file. -/
+
+def withTempFile (contents : ByteArray) (f : System.FilePath → IO Unit) : IO Unit := do
+  let (h, path) ← IO.FS.createTempFile
+  h.write contents
+  h.flush
+  try f path finally IO.FS.removeFile path
+
+def bytes (n : Nat) : ByteArray := Id.run do
+  let mut r := ByteArray.mkEmpty n
+  for i in [:n] do
+    r := r.push (UInt8.ofNat (i * 31 % 251))
+  return r
+
+#eval show IO Unit from do
+  for n in [0, 1, 4095, 4096, 4097, 100000] do
+    withTempFile (bytes n) fun path => do
+      let a ← IO.FS.mmapFile path
+      unless a == bytes n && a.size == n do throw <| IO.userError s!"contents {n}"
+      unless hash a == hash (bytes n) do throw <| IO.userError s!"hash {n}"
+      if n > 0 then
+        -- in-place update of the exclusive mapped array
+        let b := a.set! (n - 1) 7
+        unless b[n - 1]! == 7 do throw <| IO.userError s!"set {n}"
+        -- growing copies the array
+        let c := b.push 1 |>.push 2
+        unless c.size == n + 2 && c[n + 1]! == 2 && c.extract 0 (n - 1) == (bytes n).extract 0 (n - 1) do
+          throw <| IO.userError s!"push {n}"
+      unless (← IO.FS.readBinFile path) == bytes n do throw <| IO.userError s!"file modified {n}"
+
+#eval show IO Unit from do
+  -- a shared mapped array is copied on update
+  withTempFile (bytes 10) fun path => do
+    let a ← IO.FS.mmapFile path
+    let b := a.set! 0 42
+    unless a == bytes 10 && b[0]! == 42 do throw <| IO.userError "shared"
+  match ← (IO.FS.mmapFile "does/not/exist").toBaseIO with
+  | .ok _ => throw <| IO.userError "missing file"
+  | .error (.noFileOrDirectory ..) => pure ()
+  | .error e => throw e
@@ -0,0 +1,20 @@
+/-! Decimal representation and division of `Nat`s with many limbs. -/
+
+def reprRef (n : Nat) : String :=
+  (Nat.toDigits 10 n).asString
+
+#eval show IO Unit from do
+  for e in [64, 65, 100, 1000, 5000, 20000] do
+    for n in [2^e - 1, 2^e, 10^(e / 3), 10^(e / 3) - 1, 3^e + 10^(e / 4)] do
+      unless n.repr == reprRef n do throw <| IO.userError s!"repr 2^{e}"
+      unless toString n == reprRef n do throw <| IO.userError s!"toString 2^{e}"
+
+#eval show IO Unit from do
+  let a := 3^40000 + 12345
+  for b in [7^3000 + 1, 7^10000 + 11, 2^40000 - 1, 3^20000] do
+    let q := a / b
+    let r := a % b
+    unless q * b + r == a && r < b do throw <| IO.userError "divmod"
+    unless (a * b) / b == a && (a * b) % b == 0 do throw <| IO.userError "mul/div"
+
+#guard (10^30 + 7).repr == "1000000000000000000000000000007"
@@ -0,0 +1,35 @@
+/-! Positional and vectored reads and writes on a `Handle`. -/
+
+def bytes (n k : Nat) : ByteArray := Id.run do
+  let mut r := ByteArray.mkEmpty n
+  for i in [:n] do
+    r := r.push (UInt8.ofNat (i * k % 251))
+  return r
+
+#eval show IO Unit from do
+  let (h, path) ← IO.FS.createTempFile
+  try
+    let a := bytes 10000 7
+    h.writeAt 0 a
+    -- does not move the cursor, except on Windows
+    unless System.Platform.isWindows do
+      h.write (bytes 3 1)
+      h.flush
+      unless (← h.readAt 0 3) == bytes 3 1 do throw <| IO.userError "write after writeAt"
+    unless (← h.readAt 3 10) == a.extract 3 13 do throw <| IO.userError "readAt"
+    unless (← h.readAt 9990 100) == a.extract 9990 10000 do throw <| IO.userError "readAt at end"
+    unless (← h.readAt 20000 10).isEmpty do throw <| IO.userError "readAt past end"
+    -- writing past the end extends the file
+    h.writeAt 10005 (bytes 5 3)
+    unless (← h.readAt 10000 10) == ByteArray.mk #[0, 0, 0, 0, 0] ++ bytes 5 3 do throw <| IO.userError "hole"
+    let bs := #[bytes 100 5, ByteArray.empty, bytes 1 2, bytes 5000 11]
+    h.writevAt 4000 bs
+    let rs ← h.readvAt 4000 (bs.map (·.size.toUSize))
+    unless rs == bs do throw <| IO.userError "readvAt"
+    let rs ← h.readvAt 10008 #[1, 5, 3]
+    unless rs.map (·.size) == #[1, 1, 0] do throw <| IO.userError "readvAt at end"
+    h.advise 0 0 .sequential
+    h.allocate 0 20000
+    unless (← path.metadata).byteSize ≥ 20000 do throw <| IO.userError "allocate"
+  finally
+    IO.FS.removeFile path
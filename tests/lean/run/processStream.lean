@@ -0,0 +1,28 @@
+/-! `IO.Process.stream`, `IO.FS.Handle.readAny` and `IO.Process.Child.waitAny` -/
+
+open IO.Process
+
+#eval show IO Unit from do
+  unless System.Platform.isWindows do
+    -- more output on both pipes than fits into their buffers
+    let script := "i=0; while [ $i -lt 2000 ]; do echo out$i; echo err$i >&2; i=$((i+1)); done; exit 3"
+    let out ← output { cmd := "sh", args := #["-c", script] }
+    unless out.exitCode == 3 && (out.stdout.splitOn "\n").length == 2001 && out.stderr.startsWith "err0\nerr1\n" do
+      throw <| IO.userError s!"output: {out.exitCode}"
+    let (code?, n) ← stream { cmd := "sh", args := #["-c", script] } 0 fun
+      | .stdout, chunk, n => return n + chunk.size
+      | .stderr, _, n => return n
+    unless code? == some 3 && n == out.stdout.utf8ByteSize do throw <| IO.userError "stream"
+    -- timeout kills the process
+    let start ← IO.monoMsNow
+    let (code?, _) ← stream { cmd := "sh", args := #["-c", "echo start; sleep 10"] } () (fun _ _ _ => pure ()) (timeoutMs? := some 200)
+    unless code?.isNone && (← IO.monoMsNow) - start < 5000 do throw <| IO.userError "timeout"
+    -- waiting for the first of several children
+    let cfg : StdioConfig := { stdin := .null, stdout := .null, stderr := .null }
+    let children ← spawnMany cfg #[{ cmd := "sleep", args := #["5"] }, { cmd := "sh", args := #["-c", "exit 7"] }]
+    let some (i, code) ← Child.waitAny children | throw <| IO.userError "waitAny"
+    unless i == 1 && code == 7 do throw <| IO.userError s!"waitAny: {i} {code}"
+    let #[sleeper, _] := children | throw <| IO.userError "spawnMany"
+    unless (← Child.waitAny #[sleeper] (timeoutMs? := some 10)).isNone do throw <| IO.userError "waitAny timeout"
+    sleeper.kill
+    discard sleeper.wait
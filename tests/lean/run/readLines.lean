@@ -0,0 +1,30 @@
+/-! `Handle.getLine`, `Handle.readLines` and `IO.FS.lines`. -/
+
+partial def allLines (h : IO.FS.Handle) (acc : Array String := #[]) : IO (Array String) := do
+  let l ← h.getLine
+  if l.isEmpty then return acc else allLines h (acc.push l)
+
+#eval show IO Unit from do
+  let (h, path) ← IO.FS.createTempFile
+  try
+    let long := String.mk (List.replicate 10000 'x')
+    h.write "a\nbb\r\n\nλ∀\n\r\n".toUTF8
+    h.write (ByteArray.mk #[0x61, 0, 0x62, 0xff, 0x0a])
+    h.putStr s!"{long}\nlast\r"
+    h.flush
+    let expected := #["a", "bb", "", "λ∀", "", "a\x00b�", long, "last\r"]
+    unless (← IO.FS.lines path) == expected do throw <| IO.userError "lines"
+    let r ← IO.FS.Handle.mk path .read
+    unless (← allLines r) == #["a\n", "bb\r\n", "\n", "λ∀\n", "\r\n", "a\x00b�\n", long ++ "\n", "last\r"] do
+      throw <| IO.userError "getLine"
+    let r ← IO.FS.Handle.mk path .read
+    unless (← r.readLines 3) == expected.extract 0 3 do throw <| IO.userError "readLines 3"
+    unless (← r.getLine) == "λ∀\n" do throw <| IO.userError "getLine after readLines"
+    unless (← r.readLines 10) == expected.extract 4 8 do throw <| IO.userError "readLines rest"
+    unless (← r.readLines 10).isEmpty do throw <| IO.userError "readLines at end"
+    -- data appended after reaching the end is seen by later reads
+    h.putStr "\nmore\n"
+    h.flush
+    unless (← r.readLines 10) == #["", "more"] do throw <| IO.userError "readLines after append"
+  finally
+    IO.FS.removeFile path
@@ -0,0 +1,55 @@
+import Lean.Data.Rope
+import Lean.Server.Utils
+
+open Lean
+
+def checkRope (t : Rope) (s : String) : IO Unit := do
+  unless t.toString == s do throw <| IO.userError s!"rope mismatch: {t.toString.length} vs {s.length}"
+  unless t.length == s.length && t.utf8ByteSize == s.utf8ByteSize do throw <| IO.userError "size mismatch"
+
+#eval show IO Unit from do
+  let chunks := #["a", "αβγ", "hello world ", "∀ x, x = x\n", "😀", String.mk (List.replicate 700 'z')]
+  let mut t : Rope := {}
+  let mut s := ""
+  for i in [0:2000] do
+    let c := chunks[(i * 7) % chunks.size]!
+    t := t.appendString c
+    s := s ++ c
+  checkRope t s
+  -- the tree stays shallow
+  unless t.height < 30 do throw <| IO.userError s!"unbalanced rope: height {t.height}"
+  for i in [0:200] do
+    let a := (i * 7919) % s.length
+    let b := a + (i * 104729) % (s.length - a + 1)
+    checkRope (t.extract a b) (s.extract (s.toSubstring.take a).stopPos (s.toSubstring.take b).stopPos)
+    unless t.get a == s.get (s.toSubstring.take a).stopPos do throw <| IO.userError s!"get {a}"
+  let t' := t.replace 10 20 "REPLACED"
+  checkRope t' ((s.take 10) ++ "REPLACED" ++ (s.drop 20))
+  checkRope (t.set 3 'Ω') ((s.take 3).push 'Ω' ++ s.drop 4)
+  checkRope (Rope.ofString s) s
+
+-- line starts, as used to translate LSP positions
+#eval show IO Unit from do
+  let lines := (List.range 3000).map fun i => String.mk (List.replicate (i % 17) 'x') ++ s!"∀{i}"
+  let s := "\n".intercalate lines
+  let t := Rope.ofString s
+  unless t.newlines == 2999 do throw <| IO.userError s!"newlines {t.newlines}"
+  let mut idx := 0
+  for i in [0:3000], l in lines do
+    unless t.lineStart i == idx do throw <| IO.userError s!"lineStart {i}"
+    idx := idx + l.length + 1
+  unless t.lineStart 3000 == t.length && t.lineStart 5000 == t.length do
+    throw <| IO.userError "lineStart past the end"
+
+-- a batch of edits gives the same text as applying them one by one
+#eval show IO Unit from do
+  let text := "\n".intercalate ((List.range 2000).map fun i => s!"def f{i} := \"😀 {i}\"")
+  let mut changes : Array Lsp.TextDocumentContentChangeEvent := #[]
+  for i in [0:50] do
+    let line := (i * 37) % 1990
+    changes := changes.push <| .rangeChange ⟨⟨line, 4⟩, ⟨line + (i % 3), 9 + i % 4⟩⟩ s!"g{i}\r\n𝔸"
+  changes := changes.push <| .rangeChange ⟨⟨5000, 0⟩, ⟨5000, 3⟩⟩ "end"
+  let expected := changes.foldl Server.applyDocumentChange text.toFileMap
+  let actual := Server.foldDocumentChanges changes text.toFileMap
+  unless actual.source == expected.source do throw <| IO.userError "foldDocumentChanges"
+  unless actual.positions == expected.positions do throw <| IO.userError "foldDocumentChanges positions"
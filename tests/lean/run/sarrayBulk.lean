@@ -0,0 +1,47 @@
+def bytes (n : Nat) : ByteArray := Id.run do
+  let mut r := ByteArray.empty
+  for i in [:n] do
+    r := r.push (UInt8.ofNat (i * 7 % 23))
+  return r
+
+def floats (n : Nat) (f : Nat → Float) : FloatArray := Id.run do
+  let mut r := FloatArray.empty
+  for i in [:n] do
+    r := r.push (f i)
+  return r
+
+#eval show IO Unit from do
+  let bs := bytes 100
+  -- `fill` is truncated to the array
+  let f := bs.fill 90 20 255
+  unless f.size == 100 && f[89]! == bs[89]! && f[90]! == 255 && f[99]! == 255 do throw <| IO.userError "fill"
+  unless bs.fill 200 5 1 == bs do throw <| IO.userError "fill past end"
+  -- `indexOf?` agrees with `findIdx?`
+  for v in [0, 1, 13, 22, 23] do
+    for start in [0, 1, 50, 99, 100, 1000] do
+      unless bs.indexOf? (UInt8.ofNat v) start == bs.findIdx? (· == UInt8.ofNat v) start do
+        throw <| IO.userError s!"indexOf? {v} {start}"
+  -- lexicographic comparison
+  unless compare (bytes 10) (bytes 10) == .eq do throw <| IO.userError "compare eq"
+  unless compare (bytes 9) (bytes 10) == .lt do throw <| IO.userError "compare prefix"
+  unless compare (bytes 10) ((bytes 10).set! 3 0) == .gt do throw <| IO.userError "compare gt"
+  unless compare ByteArray.empty ByteArray.empty == .eq do throw <| IO.userError "compare empty"
+  unless bytes 10 != bytes 11 && bytes 0 == ByteArray.empty do throw <| IO.userError "beq"
+
+#eval show IO Unit from do
+  let a := floats 37 fun i => i.toFloat
+  let b := floats 40 fun i => (2 * i).toFloat
+  let c := floats 37 fun _ => 1
+  unless (a.add b).toList == (List.range 37).map (fun i => (3 * i).toFloat) do throw <| IO.userError "add"
+  unless (a.mul b).toList == (List.range 37).map (fun i => (2 * i * i).toFloat) do throw <| IO.userError "mul"
+  unless (a.fma b c).toList == (List.range 37).map (fun i => (2 * i * i + 1).toFloat) do throw <| IO.userError "fma"
+  -- shared operand is not modified
+  let a' := a.add a
+  unless a[36]! == 36 && a'[36]! == 72 do throw <| IO.userError "add shared"
+  unless a.sum == 666 && a.dot c == 666 && a.dot b == 2 * 16206 do throw <| IO.userError "sum/dot"
+  let d := (floats 21 fun i => (i * 13 % 21).toFloat - 10).set! 5 (0/0)
+  unless d.min == -10 && d.max == 10 do throw <| IO.userError "min/max"
+  unless FloatArray.empty.min == 1/0 && FloatArray.empty.max == -1/0 do throw <| IO.userError "min/max empty"
+  let e := a.copySlice 10 (floats 5 fun _ => 0) 2 5
+  unless e.toList == [0, 0, 10, 11, 12, 13, 14] do throw <| IO.userError "copySlice"
+  unless (a.fill 0 3 (-1)).extract 0 4 |>.toList == [-1, -1, -1, 3] do throw <| IO.userError "fill"
@@ -0,0 +1,20 @@
+import Std.Data.HashMap
+
+/-! Hash maps keyed by strings can opt into `String.hashWithSeed` with a per-process random seed. -/
+
+def build (seed : UInt64) (n : Nat) : Nat × Bool := Id.run do
+  letI := String.seededHashable seed
+  let mut m : Std.HashMap String Nat := {}
+  for i in [0:n] do
+    m := m.insert s!"key{i}" i
+  let ok := (List.range n).all fun i => m[s!"key{i}"]? == some i
+  (m.size, ok && m[s!"key{n}"]? == none)
+
+#eval show IO Unit from do
+  let seed ← IO.hashSeed
+  for s in [seed, 0, 12345] do
+    unless build s 1000 == (1000, true) do throw <| IO.userError s!"seed {s}"
+  -- the seed is fixed for the process
+  unless (← IO.hashSeed) == seed do throw <| IO.userError "hashSeed changed"
+  -- the default instance is unaffected
+  unless hash "lean" == "lean".hash do throw <| IO.userError "default instance"
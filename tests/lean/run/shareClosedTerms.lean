@@ -0,0 +1,17 @@
+import Lean
+
+open Lean Elab Command
+
+def f (n : Nat) : String :=
+  "hello " ++ toString n
+
+set_option compiler.share_closed_terms true in
+def g (n : Nat) : String :=
+  "world " ++ toString n
+
+#eval show CommandElabM Unit from do
+  let env ← getEnv
+  unless isClosedTermName env `f._closed_1 && !isSharedClosedTermName env `f._closed_1 do
+    throwError "`f._closed_1` should be a private closed term"
+  unless isSharedClosedTermName env `g._closed_1 do
+    throwError "`g._closed_1` should be shared with downstream modules"
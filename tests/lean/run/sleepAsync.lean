@@ -0,0 +1,41 @@
+/-! Timers driven by `IO.Promise.resolveAfter`. -/
+
+def assertBEq [BEq α] [ToString α] (caption : String) (actual expected : α) : IO Unit := do
+  unless actual == expected do
+    throw <| IO.userError <|
+      s!"{caption}: expected '{expected}', got '{actual}'"
+
+-- many pending timers do not need a thread each
+#eval show IO Unit from do
+  let start ← IO.monoMsNow
+  let timers ← (List.range 10000).mapM fun i => IO.sleepAsync (100 + (i % 50).toUInt32)
+  assertBEq "pending" (← IO.getTaskState timers[0]!) .running
+  for t in timers do IO.wait t
+  -- no upper bound: it would only measure the load of the machine running the test
+  let elapsed := (← IO.monoMsNow) - start
+  unless 100 ≤ elapsed do
+    throw <| IO.userError s!"elapsed {elapsed} ms"
+
+-- the earliest deadline fires first, regardless of registration order
+#eval show IO Unit from do
+  let slow ← IO.sleepAsync 2000
+  let fast ← IO.sleepAsync 10
+  IO.wait fast
+  assertBEq "slow" (← IO.hasFinished slow) false
+
+#eval show IO Unit from do
+  let p : IO.Promise Nat ← IO.Promise.new
+  p.resolveAfter 1 50
+  p.resolve 2
+  assertBEq "resolved first" (← IO.wait p.result) 2
+  IO.wait (← IO.sleepAsync 100)
+  assertBEq "not overwritten" (← IO.wait p.result) 2
+
+#eval show IO Unit from do
+  let never : IO.Promise Nat ← IO.Promise.new
+  assertBEq "timeout" (← IO.wait (← IO.timeout never.result 20)) none
+  assertBEq "no timeout" (← IO.wait (← IO.timeout (.pure 3) 10000)) (some 3)
+  assertBEq "waitAnyTimeout" (← IO.waitAnyTimeout [never.result] 20) none
+  let t ← IO.asTask (prio := .dedicated) do IO.sleep 20; return 4
+  assertBEq "waitAnyTimeout" (← IO.waitAnyTimeout [never.result, t.map (·.toOption.getD 0)] 10000) (some 4)
+  never.resolve 0
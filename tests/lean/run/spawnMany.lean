@@ -0,0 +1,25 @@
+/-! `IO.Process.spawn` and `IO.Process.spawnMany` -/
+
+open IO.Process
+
+#eval show IO Unit from do
+  unless System.Platform.isWindows do
+    let out ← output { cmd := "sh", args := #["-c", "pwd; echo $FOO; echo ${HOME-unset}"], cwd := some "/",
+                       env := #[("FOO", some "bar"), ("HOME", none)] }
+    unless out.exitCode == 0 && out.stdout == "/\nbar\nunset\n" do throw <| IO.userError s!"output: {out.stdout}"
+    -- `PATH` is looked up in the environment of the child
+    let out ← output { cmd := "sh", args := #["-c", "echo ok"], env := #[("PATH", some "/bin:/usr/bin")] }
+    unless out.stdout == "ok\n" do throw <| IO.userError "PATH"
+    let cfg : StdioConfig := { stdin := .null, stdout := .piped, stderr := .null }
+    let children ← spawnMany cfg <| (Array.range 20).map fun i =>
+      { cmd := "sh", args := #["-c", s!"echo {i}; exit {i % 3}"] }
+    for i in [0:20], child in children do
+      unless (← child.stdout.readToEnd) == s!"{i}\n" do throw <| IO.userError s!"stdout {i}"
+      unless (← child.wait) == (i % 3).toUInt32 do throw <| IO.userError s!"exit code {i}"
+    -- a missing command fails the whole batch
+    try
+      discard <| spawnMany cfg #[{ cmd := "sleep", args := #["10"] }, { cmd := "does-not-exist-lean-test" }]
+      throw <| IO.userError "missing command"
+    catch
+      | .noFileOrDirectory .. => pure ()
+      | e => throw e
@@ -0,0 +1,35 @@
+/-! `StringBuilder` and the `String` primitives it uses, compared with plain `String` appends. -/
+
+#eval show IO Unit from do
+  let mut b := StringBuilder.mkEmpty 4
+  let mut s := ""
+  for i in [:200] do
+    let frag := s!"{i}αβ"
+    b := b ++ frag
+    s := s ++ frag
+    if i % 7 == 0 then
+      b := b.push '∀' |>.pushn 'x' (i % 5)
+      s := s.push '∀' |>.append ("".pushn 'x' (i % 5))
+  unless b.toString == s && b.length == s.length && b.utf8ByteSize == s.utf8ByteSize do
+    throw <| IO.userError "append"
+
+#eval show IO Unit from do
+  let s := "aβc∀de"
+  -- positions that are not on character boundaries behave as in `String.extract`
+  for start in [0, 1, 2, 3, 4, 7, 9, 100] do
+    for stop in [0, 1, 2, 3, 6, 8, 9, 100] do
+      let b := (StringBuilder.mkEmpty 0 ++ "<").appendExtract s ⟨start⟩ ⟨stop⟩
+      let e := "<" ++ s.extract ⟨start⟩ ⟨stop⟩
+      unless b.toString == e && b.length == e.length do throw <| IO.userError s!"appendExtract {start} {stop}"
+  let b := ({} : StringBuilder).appendSubstring ("hello world".toSubstring.drop 6)
+  unless b.toString == "world" && b.length == 5 do throw <| IO.userError "appendSubstring"
+
+#eval show IO Unit from do
+  -- a shared string is not modified
+  let s := "abc"
+  let t := s.pushn '∀' 3
+  let u := (StringBuilder.mk s).appendExtract s ⟨0⟩ ⟨2⟩
+  unless s == "abc" && t == "abc∀∀∀" && t.length == 6 && u.toString == "abcab" do throw <| IO.userError "shared"
+  unless "".pushn 'a' 0 == "" && ("a".pushn 'b' 3).length == 4 do throw <| IO.userError "pushn"
+
+#guard (Std.Format.nest 2 ("a" ++ Std.Format.line ++ "b")).pretty 1 == "a\n  b"
@@ -0,0 +1,72 @@
+import Lean.Util.Path
+
+/-! `System.FilePath.walkDirEntries` and the module discovery built on it. -/
+
+open System
+
+#eval show IO Unit from do
+  let root : FilePath := "walkDirEntries.tmp"
+  if ← root.pathExists then IO.FS.removeDirAll root
+  for d in ["A/B/C", "A/D", "E"] do
+    IO.FS.createDirAll (root / d)
+  for f in ["A/B/C/X.lean", "A/B/Y.lean", "A/D/z.txt", "E/F.lean", "G.lean"] do
+    IO.FS.writeFile (root / f) f
+  try
+    let expected := ((← root.walkDir).map (·.toString)).qsort (· < ·)
+    for threads in [0, 1, 4] do
+      let es ← root.walkDirEntries (threads := threads)
+      unless es.map (·.path.toString) == expected do
+        throw <| IO.userError s!"walkDirEntries {threads}: {es.map (·.path)}"
+      unless es.all (·.metadata?.isNone) do throw <| IO.userError "unrequested metadata"
+    let es ← root.walkDirEntries (metadata := true)
+    for e in es do
+      let md ← e.path.metadata
+      unless e.type == md.type && e.metadata?.map (·.byteSize) == some md.byteSize do
+        throw <| IO.userError s!"metadata of {e.path}"
+    let act : StateT (Array String) IO Unit := Lean.forEachModuleInDir root fun n => modify (·.push n.toString)
+    let ((), mods) ← act.run #[]
+    unless mods.qsort (· < ·) == #["A.B.C.X", "A.B.Y", "E.F", "G"] do
+      throw <| IO.userError s!"forEachModuleInDir: {mods}"
+    try
+      discard <| (root / "missing").walkDirEntries
+      throw <| IO.userError "missing root"
+    catch
+      | .noFileOrDirectory .. => pure ()
+      | e => throw e
+  finally
+    IO.FS.removeDirAll root
+
+-- entries below linked directories are reported below the link, as by `walkDir`
+#eval show IO Unit from do
+  unless System.Platform.isWindows do
+    let root : FilePath := "walkDirEntriesLinks.tmp"
+    let lib := root / "lib"
+    let links := [lib / "linked", root / "src" / "A" / "up"]
+    -- `removeDirAll` follows links, so remove them first
+    let cleanup : IO Unit := do
+      for l in links do
+        try IO.FS.removeFile l catch _ => pure ()
+      if ← root.pathExists then IO.FS.removeDirAll root
+    cleanup
+    IO.FS.createDirAll (root / "src" / "A")
+    IO.FS.writeFile (root / "src" / "A" / "X.ilean") ""
+    IO.FS.createDirAll lib
+    -- a link to a sibling directory and a link back to an ancestor
+    for (target, l) in ["../src", ".."].zip links do
+      discard <| IO.Process.run { cmd := "ln", args := #["-s", target, l.toString] }
+    try
+      let linked := lib / "linked" / "A" / "X.ilean"
+      let es ← lib.walkDirEntries (followSymlinks := true)
+      unless (es.map (·.path)).contains linked do
+        throw <| IO.userError s!"walkDirEntries: {es.map (·.path)}"
+      unless (← IO.FS.realPath linked) == (← IO.FS.realPath (root / "src" / "A" / "X.ilean")) do
+        throw <| IO.userError "link target"
+      let found ← Lean.SearchPath.findAllWithExt [lib] "ilean"
+      unless found == #[linked] do
+        throw <| IO.userError s!"findAllWithExt: {found}"
+      -- without following links, the link is a leaf
+      let es ← lib.walkDirEntries
+      unless es.map (fun e => (e.path, e.type)) == #[(lib / "linked", .symlink)] do
+        throw <| IO.userError s!"walkDirEntries without links: {es.map (·.path)}"
+    finally
+      cleanup
@@ -0,0 +1,5 @@
+import ShareClosedTerms.Reuse
+
+def main : IO Unit := do
+  IO.println (greet 1)
+  IO.println (greet' 2)
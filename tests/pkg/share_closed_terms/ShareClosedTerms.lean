@@ -0,0 +1,13 @@
+import Lean
+import ShareClosedTerms.Reuse
+
+open Lean Elab Command
+
+#eval show CommandElabM Unit from do
+  let env ← getEnv
+  let some decl := IR.findEnvDecl env ``greet' | throwError "no IR for `greet'`"
+  let used := IR.collectUsedDecls env decl
+  unless used.contains `greet._closed_1 do
+    throwError "`greet'` should use the imported `greet._closed_1`, but it uses {used.toList}"
+  if (IR.findEnvDecl env `greet'._closed_1).isSome then
+    throwError "`greet'` should not have its own copy of the closed term"
@@ -0,0 +1,3 @@
+set_option compiler.share_closed_terms true in
+def greet (n : Nat) : String :=
+  "hello from a shared closed term " ++ toString n
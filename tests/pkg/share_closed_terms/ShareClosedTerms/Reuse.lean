@@ -0,0 +1,6 @@
+import ShareClosedTerms.Basic
+
+/-! The closed term of `greet'` is the one of `greet` in the imported module, so it must be reused. -/
+
+def greet' (n : Nat) : String :=
+  "hello from a shared closed term " ++ toString n
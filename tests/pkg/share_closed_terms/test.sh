@@ -0,0 +1,10 @@
+#!/usr/bin/env bash
+set -e
+
+# We need a package test because the closed term must come from an imported module.
+# The executable checks that the exported closed term links and is initialized.
+
+rm -rf .lake/build
+lake build
+test "$(lake exe main)" = "hello from a shared closed term 1
+hello from a shared closed term 2"